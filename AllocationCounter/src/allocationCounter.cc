@@ -0,0 +1,67 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    allocationCounter                                                    //
+//                                                                         //
+//    Replaces the global operator new/delete with versions that count     //
+//    allocations, for LD_PRELOADing into benchmark jobs. Read the count   //
+//    with uwvv::allocationCounter::count() (in                            //
+//    UWVV/Utilities/interface/AllocationCounter.h).                       //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace
+{
+  std::atomic<unsigned long long> nAllocations(0);
+
+  void* countedAlloc(std::size_t n)
+  {
+    nAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(n ? n : 1);
+  }
+}
+
+
+extern "C" unsigned long long uwvvAllocationCount()
+{
+  return nAllocations.load(std::memory_order_relaxed);
+}
+
+
+void* operator new(std::size_t n)
+{
+  void* p = countedAlloc(n);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t n)
+{
+  void* p = countedAlloc(n);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+  return countedAlloc(n);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+  return countedAlloc(n);
+}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept {std::free(p);}
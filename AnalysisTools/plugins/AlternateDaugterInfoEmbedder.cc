@@ -6,6 +6,11 @@
 //    CompositeCandidates, embeds some information about the alternate       //
 //    dilepton pairings.                                                     //
 //                                                                           //
+//    The mass (with and without FSR), deltaR and charges of every pair are  //
+//    stored together as one DaughterPairKinematics userData labeled         //
+//    "pairKinematics" (where the ntuplizer looks for it), indexed by the    //
+//    daughter names.                                                        //
+//                                                                           //
 //    Nate Woods, U. Wisconsin                                               //
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
@@ -29,6 +34,8 @@
 #include "DataFormats/Common/interface/View.h"
 #include "DataFormats/Math/interface/deltaR.h"
 
+#include "UWVV/DataFormats/interface/DaughterPairKinematics.h"
+
 
 typedef pat::CompositeCandidate CCand;
 
@@ -44,13 +51,9 @@ public:
 private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
-  const std::vector<std::string> 
-  makePairNames(const std::vector<std::string>& names) const;
-
   const edm::EDGetTokenT<edm::View<CCand> > srcToken;
 
   const std::vector<std::string> names;
-  const std::vector<std::string> pairNames;
   const size_t nDaughters;
   
   const std::string fsrLabel;
@@ -69,7 +72,6 @@ private:
 AlternateDaughterInfoEmbedder::AlternateDaughterInfoEmbedder(const edm::ParameterSet& iConfig) :
   srcToken(consumes<edm::View<CCand> >(iConfig.getParameter<edm::InputTag>("src"))),
   names(iConfig.getParameter<std::vector<std::string> >("names")),
-  pairNames(makePairNames(names)),
   nDaughters(names.size()),
   fsrLabel(iConfig.exists("fsrLabel") ? 
            iConfig.getParameter<std::string>("fsrLabel") :
@@ -147,7 +149,11 @@ void AlternateDaughterInfoEmbedder::produce(edm::Event& iEvent,
           daughters.at(nDaughters-1) = cand->daughter(nDaughters/2-1)->daughter(1);
         }
 
-      size_t iName = 0;
+      DaughterPairKinematics pairs(names);
+
+      for(size_t d1 = 0; d1 < nDaughters; ++d1)
+        pairs.setCharge(d1, daughters.at(d1)->charge());
+
       for(size_t d1 = 0; d1 < nDaughters - 1; ++d1)
         {
           edm::Ptr<reco::Candidate> d1FSR = fsrGetters.at(d1)(daughters.at(d1));
@@ -155,57 +161,23 @@ void AlternateDaughterInfoEmbedder::produce(edm::Event& iEvent,
             {
               edm::Ptr<reco::Candidate> d2FSR = fsrGetters.at(d2)(daughters.at(d2));
 
-              const std::string& name = pairNames.at(iName);
-              iName++;
-
               auto p4 = daughters.at(d1)->p4() + daughters.at(d2)->p4();
+              float massNoFSR = p4.M();
 
-              if(fsrLabel.empty())
-                {
-                  out->back().addUserFloat(name+"Mass", p4.M());
-                }
-              else
-                {
-                  out->back().addUserFloat(name+"MassNoFSR", p4.M());
-
-                  if(d1FSR.isNonnull())
-                    p4 += d1FSR->p4();
-                  if(d2FSR.isNonnull())
-                    p4 += d2FSR->p4();
-
-                  out->back().addUserFloat(name+"Mass", p4.M());
-                }
+              if(d1FSR.isNonnull())
+                p4 += d1FSR->p4();
+              if(d2FSR.isNonnull())
+                p4 += d2FSR->p4();
 
-              out->back().addUserFloat(name+"DR",  deltaR(daughters.at(d1)->p4(), daughters.at(d2)->p4()));
-              out->back().addUserFloat(name+"SS",  (daughters.at(d1)->charge() == daughters.at(d2)->charge() ? 1. : 0.));
+              pairs.setPair(d1, d2, p4.M(), massNoFSR,
+                            deltaR(daughters.at(d1)->p4(), daughters.at(d2)->p4()));
             }
         }
-    }
 
-  iEvent.put(std::move(out));
-}
-
-
-const std::vector<std::string> 
-AlternateDaughterInfoEmbedder::makePairNames(const std::vector<std::string>& daughterNames) const
-{
-  if(daughterNames.size() < 2)
-    return daughterNames;
-
-  std::vector<std::string> out;
-
-  for(size_t n1 = 0; n1 < daughterNames.size()-1; ++n1)
-    {
-      for(size_t n2 = n1+1; n2 < daughterNames.size(); ++n2)
-        {
-          if(daughterNames.at(n2) < daughterNames.at(n1))
-            out.push_back(daughterNames.at(n2) + "_" + daughterNames.at(n1) + "_");
-          else
-            out.push_back(daughterNames.at(n1) + "_" + daughterNames.at(n2) + "_");
-        }
+      out->back().addUserData("pairKinematics", pairs);
     }
 
-  return out;
+  iEvent.put(std::move(out));
 }
 
 
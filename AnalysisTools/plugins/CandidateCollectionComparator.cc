@@ -0,0 +1,147 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    CandidateCollectionComparator                                        //
+//                                                                         //
+//    Checks that two collections of composite candidates are the same:    //
+//    same number of candidates, in the same order, made from the same     //
+//    daughters with the same four-momenta. Throws on the first mismatch,  //
+//    so a cmsRun job using it fails if the collections ever differ.       //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+// STL
+#include <memory>
+#include <iostream>
+#include <cmath>
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+
+
+
+class CandidateCollectionComparator : public edm::one::EDAnalyzer<>
+{
+
+  typedef pat::CompositeCandidate CCand;
+
+public:
+  explicit CandidateCollectionComparator(const edm::ParameterSet& config);
+  ~CandidateCollectionComparator() {;}
+
+private:
+  virtual void analyze(edm::Event const& evt,
+                       edm::EventSetup const& setup);
+  virtual void endJob();
+
+  // empty string if they match, otherwise what's different
+  std::string compare(const reco::Candidate& c1,
+                      const reco::Candidate& c2) const;
+
+  const edm::EDGetTokenT<edm::View<CCand> > token1;
+  const edm::EDGetTokenT<edm::View<CCand> > token2;
+  const std::string label;
+
+  unsigned long long nEvents;
+  unsigned long long nCands;
+};
+
+
+CandidateCollectionComparator::CandidateCollectionComparator(const edm::ParameterSet& config) :
+  token1(consumes<edm::View<CCand> >(config.getParameter<edm::InputTag>("src1"))),
+  token2(consumes<edm::View<CCand> >(config.getParameter<edm::InputTag>("src2"))),
+  label(config.getParameter<edm::InputTag>("src1").encode() + " vs " +
+        config.getParameter<edm::InputTag>("src2").encode()),
+  nEvents(0),
+  nCands(0)
+{
+}
+
+
+void CandidateCollectionComparator::analyze(edm::Event const& event,
+                                            edm::EventSetup const& setup)
+{
+  edm::Handle<edm::View<CCand> > cands1;
+  event.getByToken(token1, cands1);
+  edm::Handle<edm::View<CCand> > cands2;
+  event.getByToken(token2, cands2);
+
+  ++nEvents;
+
+  if(cands1->size() != cands2->size())
+    throw cms::Exception("CandidateMismatch")
+      << label << ": event " << event.id() << " has " << cands1->size()
+      << " and " << cands2->size() << " candidates" << std::endl;
+
+  for(size_t i = 0; i < cands1->size(); ++i)
+    {
+      std::string problem = compare(cands1->at(i), cands2->at(i));
+      if(!problem.empty())
+        throw cms::Exception("CandidateMismatch")
+          << label << ": event " << event.id() << ", candidate " << i
+          << ": " << problem << std::endl;
+    }
+
+  nCands += cands1->size();
+}
+
+
+std::string
+CandidateCollectionComparator::compare(const reco::Candidate& c1,
+                                       const reco::Candidate& c2) const
+{
+  if(c1.pdgId() != c2.pdgId())
+    return "different PDG ID";
+  if(c1.charge() != c2.charge())
+    return "different charge";
+  if(std::abs(c1.px() - c2.px()) > 1.e-4 * (1. + std::abs(c1.px())) ||
+     std::abs(c1.py() - c2.py()) > 1.e-4 * (1. + std::abs(c1.py())) ||
+     std::abs(c1.pz() - c2.pz()) > 1.e-4 * (1. + std::abs(c1.pz())) ||
+     std::abs(c1.energy() - c2.energy()) > 1.e-4 * (1. + c1.energy()))
+    return "different four-momentum";
+  if(c1.numberOfDaughters() != c2.numberOfDaughters())
+    return "different number of daughters";
+
+  for(size_t d = 0; d < c1.numberOfDaughters(); ++d)
+    {
+      const reco::Candidate* d1 = c1.daughter(d);
+      const reco::Candidate* d2 = c2.daughter(d);
+
+      if(d1->hasMasterClone() != d2->hasMasterClone())
+        return "daughters are different kinds of candidate";
+
+      if(d1->hasMasterClone())
+        {
+          if(d1->masterClone() != d2->masterClone())
+            return "daughters come from different objects";
+        }
+      else
+        {
+          std::string problem = compare(*d1, *d2);
+          if(!problem.empty())
+            return problem;
+        }
+    }
+
+  return "";
+}
+
+
+void CandidateCollectionComparator::endJob()
+{
+  std::cout << label << ": " << nCands << " candidates in " << nEvents
+            << " events, all identical" << std::endl;
+}
+
+
+DEFINE_FWK_MODULE(CandidateCollectionComparator);
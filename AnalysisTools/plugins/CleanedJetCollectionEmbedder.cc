@@ -6,6 +6,13 @@
 //      Overlap is defined as dR(lepton candidate, jet) < DR_input. Default
 //      overlap value is 0.4.Collection is named cleanedJets by default.
 //
+//      Jet systematic variations come from a single collection (systJetSrc)
+//      whose jets carry per-variation p4 scale factors as userFloats (see
+//      uwvv::helpers::jetVariationLabel()). For each variation, the jets
+//      passing variationPtCut after scaling are stored, ordered by scaled
+//      pt, as cleanedJets_<variation>. variationPtCut is required with
+//      systJetSrc, and should be the nominal jet pt cut.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -14,6 +21,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 // CMS includes
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -39,9 +47,29 @@ public:
 private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
-  edm::PtrVector<pat::Jet> getCleanedJetCollection(edm::Event& iEvent,
-      const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, 
-      const reco::CompositeCandidate& initialState);
+  // Jets and their eta/phi buffer, loaded once per event
+  struct JetInput
+  {
+    edm::Handle<edm::View<pat::Jet> > jets;
+    uwvv::deltaR::EtaPhiBuffer etaPhi;
+  };
+
+  void loadJets(edm::Event& iEvent,
+      const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, JetInput& addTo) const;
+
+  // Flags jets overlapping any of the leptons
+  void markOverlaps(const JetInput& jets,
+      const uwvv::deltaR::EtaPhiBuffer& leptons,
+      std::vector<unsigned char>& overlaps) const;
+
+  edm::PtrVector<pat::Jet> getCleanedJetCollection(const JetInput& jets,
+      const uwvv::deltaR::EtaPhiBuffer& leptons) const;
+
+  // Non-overlapping jets passing the pt cut with this variation applied,
+  // ordered by their shifted pt
+  edm::PtrVector<pat::Jet> getCleanedJetCollection(const JetInput& jets,
+      const std::vector<unsigned char>& overlaps,
+      const std::string& variation) const;
 
   const edm::EDGetTokenT<edm::View<CCand> > srcToken;
   const edm::EDGetTokenT<edm::View<pat::Jet> > jetSrcToken;
@@ -49,14 +77,10 @@ private:
   const std::string collectionName;
   const double deltaR;
 
-  edm::EDGetTokenT<edm::View<pat::Jet> > jesUpJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jesDownJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jerUpJetSrcToken;
-  edm::EDGetTokenT<edm::View<pat::Jet> > jerDownJetSrcToken;
-  bool jesUpTagExists;
-  bool jesDownTagExists;
-  bool jerUpTagExists;
-  bool jerDownTagExists;
+  const bool doVariations;
+  edm::EDGetTokenT<edm::View<pat::Jet> > systJetSrcToken;
+  const std::vector<std::string> variations;
+  const double variationPtCut;
 
   typedef const edm::Ptr<reco::Candidate> (FType) (const reco::Candidate* const);
 };
@@ -67,19 +91,15 @@ CleanedJetCollectionEmbedder::CleanedJetCollectionEmbedder(const edm::ParameterS
   jetSrcToken(consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jetSrc"))),
   collectionName(iConfig.getUntrackedParameter<std::string>("collectionName", "cleanedJets")),
   deltaR(iConfig.getUntrackedParameter<double>("deltaR", 0.4)),
-  jesUpTagExists(iConfig.existsAs<edm::InputTag>("jesUpJetSrc")),
-  jesDownTagExists(iConfig.existsAs<edm::InputTag>("jesDownJetSrc")),
-  jerUpTagExists(iConfig.existsAs<edm::InputTag>("jerUpJetSrc")),
-  jerDownTagExists(iConfig.existsAs<edm::InputTag>("jerDownJetSrc"))
+  doVariations(iConfig.existsAs<edm::InputTag>("systJetSrc")),
+  variations(iConfig.exists("variations") ?
+             iConfig.getParameter<std::vector<std::string> >("variations") :
+             std::vector<std::string>({"jesUp", "jesDown", "jerUp", "jerDown"})),
+  variationPtCut(doVariations ?
+                 iConfig.getParameter<double>("variationPtCut") : 0.)
 {
-  if (jesUpTagExists) 
-      jesUpJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jesUpJetSrc"));
-  if (jesDownTagExists) 
-      jesDownJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jesDownJetSrc"));
-  if (jerUpTagExists) 
-      jerUpJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jerUpJetSrc"));
-  if (jerDownTagExists) 
-      jerDownJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jerDownJetSrc"));
+  if(doVariations)
+    systJetSrcToken = consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("systJetSrc"));
   produces<std::vector<CCand> >();
 }
 
@@ -92,56 +112,103 @@ void CleanedJetCollectionEmbedder::produce(edm::Event& iEvent,
 
   iEvent.getByToken(srcToken, in);
 
+  JetInput jets, systJets;
+  loadJets(iEvent, jetSrcToken, jets);
+  if(doVariations)
+    loadJets(iEvent, systJetSrcToken, systJets);
+
+  uwvv::deltaR::EtaPhiBuffer leptons;
+  std::vector<unsigned char> systOverlaps;
+
   for(size_t i = 0; i < in->size(); ++i)
     {
-      edm::PtrVector<pat::Jet> cleanedJesUpJets;
       edm::Ptr<CCand> cand = in->ptrAt(i);
 
+      leptons.clear();
+      uwvv::helpers::finalDaughterEtaPhi(*cand, leptons);
+
       out->push_back(*cand);
-      edm::PtrVector<pat::Jet> cleanedJets = getCleanedJetCollection(iEvent, jetSrcToken, *cand);
+      edm::PtrVector<pat::Jet> cleanedJets = getCleanedJetCollection(jets, leptons);
       out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName, cleanedJets);
-      
-      if(jesUpTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJesUpJets = getCleanedJetCollection(iEvent, jesUpJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jesUp", cleanedJesUpJets);
-        }
-      if(jesDownTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJesDownJets = getCleanedJetCollection(iEvent, jesDownJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jesDown", cleanedJesDownJets);
-        }
-      if(jerUpTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJerUpJets = getCleanedJetCollection(iEvent, jerUpJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jerUp", cleanedJerUpJets);
-        }
-      if(jerDownTagExists) 
-        { 
-          edm::PtrVector<pat::Jet> cleanedJerDownJets = getCleanedJetCollection(iEvent, jerDownJetSrcToken, *cand);
-          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_jerDown", cleanedJerDownJets);
+
+      if(!doVariations)
+        continue;
+
+      // Variations only change the energy scale, so the overlaps are the
+      // same for all of them
+      markOverlaps(systJets, leptons, systOverlaps);
+
+      for(const auto& variation : variations)
+        {
+          edm::PtrVector<pat::Jet> cleanedVarJets = getCleanedJetCollection(systJets, systOverlaps,
+                                                                             variation);
+          out->back().addUserData<edm::PtrVector<pat::Jet>>(collectionName+"_"+variation,
+                                                            cleanedVarJets);
         }
     }
       
   iEvent.put(std::move(out));
 }
 
-edm::PtrVector<pat::Jet> CleanedJetCollectionEmbedder::getCleanedJetCollection(edm::Event& iEvent,
-    const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, 
-    const reco::CompositeCandidate& initialState) 
+void CleanedJetCollectionEmbedder::loadJets(edm::Event& iEvent,
+    const edm::EDGetTokenT<edm::View<pat::Jet>>& jetToken, JetInput& addTo) const
+{
+  iEvent.getByToken(jetToken, addTo.jets);
+  addTo.etaPhi.addAll(*addTo.jets);
+}
+
+void CleanedJetCollectionEmbedder::markOverlaps(const JetInput& jets,
+    const uwvv::deltaR::EtaPhiBuffer& leptons,
+    std::vector<unsigned char>& overlaps) const
+{
+  overlaps.assign(jets.etaPhi.size(), 0);
+  for(size_t iLep = 0; iLep < leptons.size(); ++iLep)
+    uwvv::deltaR::markWithinDeltaR(leptons.eta()[iLep], leptons.phi()[iLep],
+                                   jets.etaPhi, deltaR, overlaps);
+}
+
+edm::PtrVector<pat::Jet> CleanedJetCollectionEmbedder::getCleanedJetCollection(const JetInput& jets,
+    const uwvv::deltaR::EtaPhiBuffer& leptons) const
 {
-  edm::Handle<edm::View<pat::Jet> > uncleanedJets;
   edm::PtrVector<pat::Jet> cleanedJets; 
 
-  iEvent.getByToken(jetToken, uncleanedJets);
+  std::vector<unsigned char> overlaps;
+  markOverlaps(jets, leptons, overlaps);
 
-  for(size_t j = 0; j < uncleanedJets->size(); ++j)
+  for(size_t j = 0; j < overlaps.size(); ++j)
     {
-      if(!uwvv::helpers::overlapWithAnyDaughter(uncleanedJets->at(j), initialState, deltaR)) 
-          cleanedJets.push_back(uncleanedJets->ptrAt(j));
+      if(!overlaps[j]) 
+          cleanedJets.push_back(jets.jets->ptrAt(j));
     }
     return cleanedJets;
 }
 
+edm::PtrVector<pat::Jet> CleanedJetCollectionEmbedder::getCleanedJetCollection(const JetInput& jets,
+    const std::vector<unsigned char>& overlaps, const std::string& variation) const
+{
+  std::vector<std::pair<float, size_t> > ptAndIndex;
+  for(size_t j = 0; j < overlaps.size(); ++j)
+    {
+      if(overlaps[j])
+        continue;
+
+      float pt = jets.jets->at(j).pt() * uwvv::helpers::jetVariationScale(jets.jets->at(j),
+                                                                           variation);
+      if(pt > variationPtCut)
+        ptAndIndex.push_back(std::make_pair(pt, j));
+    }
+
+  // highest pt first; stable so ties keep the input order
+  std::stable_sort(ptAndIndex.begin(), ptAndIndex.end(),
+                   [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b)
+                   {return a.first > b.first;});
+
+  edm::PtrVector<pat::Jet> cleanedJets;
+  for(const auto& pj : ptAndIndex)
+    cleanedJets.push_back(jets.jets->ptrAt(pj.second));
+
+  return cleanedJets;
+}
+
 DEFINE_FWK_MODULE(CleanedJetCollectionEmbedder);
 
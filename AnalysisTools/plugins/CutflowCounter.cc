@@ -0,0 +1,221 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//   CutflowCounter.cc                                                      //
+//                                                                          //
+//   Counts the objects going into and coming out of every module of an     //
+//       analysis flow, so we can see where objects (and events) are lost.  //
+//       The flow sets it up (see AnalysisFlowBase, cutflow=True) with one  //
+//       PSet in 'counters' per module and collection: the step, module,    //
+//       and object names and the input tags of the collection before and   //
+//       after the module. It runs in an EndPath, after the whole flow, so  //
+//       every collection is already in the event; a collection that isn't  //
+//       (because a filter stopped the path first) counts as empty.         //
+//                                                                          //
+//   Counts are kept per stream with no locking and summed at the end of    //
+//       the job, when they are written to the output file as a tree (one   //
+//       row per module and collection). The text table, which also says    //
+//       which modules prune the most and which cuts drop objects that      //
+//       several earlier modules already worked on (candidates to move      //
+//       earlier), is made from the tree by uwvvPrintCutflow, so it is      //
+//       right for merged files too. With printTable=cms.bool(True), this   //
+//       job's table is also printed.                                       //
+//                                                                          //
+//   Author: Nate Woods, U. Wisconsin                                       //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+
+// system includes
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// CMS includes
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/Common/interface/View.h"
+
+// ROOT
+#include "TTree.h"
+
+#include "UWVV/Utilities/interface/CutflowTable.h"
+
+
+namespace
+{
+  typedef uwvv::cutflow::Counts Counts;
+
+  struct StreamCounts
+  {
+    std::vector<Counts> rows;
+    std::vector<int> sizes; // this event's collection sizes, -1 if missing
+  };
+
+  struct Row
+  {
+    std::string step;
+    std::string module;
+    std::string object;
+    int input;  // index into the tokens, -1 if the module makes the object
+    int output;
+  };
+}
+
+
+class CutflowCounter : public edm::global::EDAnalyzer<edm::StreamCache<StreamCounts> >
+{
+public:
+  explicit CutflowCounter(const edm::ParameterSet&);
+  ~CutflowCounter() {}
+
+private:
+  virtual std::unique_ptr<StreamCounts> beginStream(edm::StreamID) const override;
+  virtual void analyze(edm::StreamID, const edm::Event& iEvent,
+                       const edm::EventSetup& iSetup) const override;
+  virtual void endStream(edm::StreamID) const override;
+  virtual void endJob() override;
+
+  int tokenFor(const std::string& tag);
+
+  std::vector<Row> rows;
+  std::map<std::string, int> tokenIndices;
+  std::vector<edm::EDGetTokenT<edm::View<reco::Candidate> > > tokens;
+
+  const bool printTable;
+
+  mutable std::mutex totalsMutex;
+  mutable std::vector<Counts> totals;
+};
+
+
+CutflowCounter::CutflowCounter(const edm::ParameterSet& iConfig) :
+  printTable(iConfig.exists("printTable") ?
+             iConfig.getParameter<bool>("printTable") : false)
+{
+  for(const auto& pset : iConfig.getParameter<std::vector<edm::ParameterSet> >("counters"))
+    {
+      const std::string input = pset.getParameter<std::string>("input");
+      const std::string output = pset.getParameter<std::string>("output");
+      if(output.empty())
+        throw cms::Exception("InvalidParams")
+          << "Cutflow counter for module "
+          << pset.getParameter<std::string>("module") << " has no output"
+          << std::endl;
+
+      rows.push_back(Row{pset.getParameter<std::string>("step"),
+                         pset.getParameter<std::string>("module"),
+                         pset.getParameter<std::string>("object"),
+                         input.empty() ? -1 : tokenFor(input),
+                         tokenFor(output)});
+    }
+
+  totals.resize(rows.size());
+}
+
+
+int CutflowCounter::tokenFor(const std::string& tag)
+{
+  auto found = tokenIndices.find(tag);
+  if(found != tokenIndices.end())
+    return found->second;
+
+  tokens.push_back(consumes<edm::View<reco::Candidate> >(edm::InputTag(tag)));
+  tokenIndices[tag] = tokens.size() - 1;
+
+  return tokens.size() - 1;
+}
+
+
+std::unique_ptr<StreamCounts> CutflowCounter::beginStream(edm::StreamID) const
+{
+  std::unique_ptr<StreamCounts> out(new StreamCounts());
+  out->rows.resize(rows.size());
+  out->sizes.resize(tokens.size());
+
+  return out;
+}
+
+
+void CutflowCounter::analyze(edm::StreamID stream, const edm::Event& iEvent,
+                             const edm::EventSetup& iSetup) const
+{
+  StreamCounts& counts = *streamCache(stream);
+
+  edm::Handle<edm::View<reco::Candidate> > coll;
+  for(size_t i = 0; i < tokens.size(); ++i)
+    {
+      iEvent.getByToken(tokens[i], coll);
+      counts.sizes[i] = coll.isValid() ? int(coll->size()) : -1;
+    }
+
+  for(size_t i = 0; i < rows.size(); ++i)
+    {
+      Counts& c = counts.rows[i];
+      ++c.nEvents;
+
+      const int nIn = rows[i].input < 0 ? 0 :
+        std::max(counts.sizes[rows[i].input], 0);
+      int nOut = counts.sizes[rows[i].output];
+      if(nOut < 0)
+        {
+          ++c.nMissing;
+          nOut = 0;
+        }
+
+      c.nIn += nIn;
+      c.nOut += nOut;
+      c.nEventsIn += (nIn > 0);
+      c.nEventsOut += (nOut > 0);
+    }
+}
+
+
+void CutflowCounter::endStream(edm::StreamID stream) const
+{
+  const StreamCounts& counts = *streamCache(stream);
+
+  std::lock_guard<std::mutex> lock(totalsMutex);
+  for(size_t i = 0; i < rows.size(); ++i)
+    totals[i].add(counts.rows[i]);
+}
+
+
+void CutflowCounter::endJob()
+{
+  edm::Service<TFileService> FS;
+
+  uwvv::cutflow::Row row;
+  TTree* tree = FS->make<TTree>("cutflow", "cutflow");
+  uwvv::cutflow::branchTree(*tree, row);
+
+  std::vector<uwvv::cutflow::Row> filled;
+  for(size_t i = 0; i < rows.size(); ++i)
+    {
+      row.step = rows[i].step;
+      row.module = rows[i].module;
+      row.object = rows[i].object;
+      row.newObject = (rows[i].input < 0);
+      row.counts = totals[i];
+      tree->Fill();
+
+      filled.push_back(row);
+    }
+
+  if(printTable)
+    std::cout << "CutflowCounter:" << std::endl
+              << uwvv::cutflow::makeTable(filled) << std::endl;
+}
+
+
+DEFINE_FWK_MODULE(CutflowCounter);
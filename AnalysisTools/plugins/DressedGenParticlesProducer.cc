@@ -5,6 +5,7 @@
 #include "FWCore/Framework/interface/EDProducer.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
 #include "CommonTools/Utils/interface/PtComparator.h"
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
 
 class DressedGenParticlesProducer : public edm::EDProducer {
     public:
@@ -42,9 +43,23 @@ void DressedGenParticlesProducer::produce(edm::Event& event, const edm::EventSet
     edm::Handle<reco::GenParticleCollection> associates;
     event.getByToken(associatesToken_, associates);
 
+    uwvv::deltaR::EtaPhiBuffer associatesEtaPhi;
+    associatesEtaPhi.addAll(*associates);
+
+    std::vector<unsigned char> inCone;
     for (const auto& base_particle : *baseCollection) {
+        inCone.assign(associates->size(), 0);
+        uwvv::deltaR::markWithinDeltaR(base_particle.eta(), base_particle.phi(),
+            associatesEtaPhi, dRmax_, inCone);
+
+        reco::GenParticleCollection matched;
+        for (size_t i = 0; i < inCone.size(); i++) {
+            if (inCone[i])
+                matched.push_back(associates->at(i));
+        }
+
         DressedGenParticle dressed_part = DressedGenParticle(base_particle,
-            *associates, dRmax_);
+            matched);
         dressedCollection->push_back(dressed_part);
     }
     //std::cout << "All associates were unique? " << allUniqueAssociates(*dressedCollection)
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+//    MultiLeptonCandidateBuilder                                            //
+//                                                                           //
+//    Builds 4l (Z+Z) or 3l (Z+l) pat::CompositeCandidates made of shallow   //
+//    clones of existing Z candidates and leptons. Produces the same output  //
+//    as PATCandViewShallowCloneCombiner with mass cuts on the Zs, but does  //
+//    all the selection on indices first (Z mass window, OSSF, lepton ID     //
+//    flags and lepton overlap are each evaluated once per input object,     //
+//    not once per combination), so only the survivors are ever built.       //
+//                                                                           //
+//    Nate Woods, U. Wisconsin                                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+
+// system includes
+#include <memory>
+#include <vector>
+#include <string>
+#include <cmath>
+
+// CMS includes
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
+#include "DataFormats/Candidate/interface/ShallowCloneCandidate.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Common/interface/RefToBase.h"
+#include "CommonTools/CandUtils/interface/AddFourMomenta.h"
+#include "CommonTools/CandUtils/interface/OverlapChecker.h"
+
+
+typedef reco::Candidate Cand;
+typedef reco::CandidateBaseRef CandRef;
+typedef pat::CompositeCandidate CCand;
+
+
+// n = 4 means src2 is a second Z collection, n = 3 means it is leptons
+template<size_t n>
+class MultiLeptonCandidateBuilder : public edm::stream::EDProducer<>
+{
+
+public:
+  explicit MultiLeptonCandidateBuilder(const edm::ParameterSet& iConfig);
+  virtual ~MultiLeptonCandidateBuilder() {;}
+
+private:
+  // What we need to know about each input object to decide whether a
+  // combination survives, computed once per object
+  struct ObjInfo
+  {
+    size_t index;
+    CandRef ref;
+    std::vector<CandRef> leptons;
+  };
+
+  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+
+  // Objects from coll passing the per-object cuts, in input order
+  std::vector<ObjInfo> selectObjects(const edm::View<Cand>& coll,
+                                     bool isZ) const;
+
+  bool passZ(const Cand& z) const;
+  bool passLeptonFlags(const Cand& lep) const;
+  float leptonUserFloat(const Cand& lep, const std::string& label) const;
+
+  bool shareLepton(const ObjInfo& a, const ObjInfo& b) const;
+
+  void build(const ObjInfo& a, const ObjInfo& b,
+             std::vector<CCand>& out) const;
+
+  const edm::EDGetTokenT<edm::View<Cand> > src1Token;
+  const edm::EDGetTokenT<edm::View<Cand> > src2Token;
+  const bool sameSource;
+
+  const std::vector<std::string> roles;
+
+  const double zMassMin;
+  const double zMassMax;
+  const double leadingZMassMin;
+  const bool requireOSSF;
+  const std::vector<std::string> leptonFlags;
+  const bool checkOverlap;
+  const int pdgId;
+
+  OverlapChecker overlap;
+  AddFourMomenta addP4;
+};
+
+
+template<size_t n>
+MultiLeptonCandidateBuilder<n>::MultiLeptonCandidateBuilder(const edm::ParameterSet& iConfig) :
+  src1Token(consumes<edm::View<Cand> >(iConfig.getParameter<edm::InputTag>("src1"))),
+  src2Token(consumes<edm::View<Cand> >(iConfig.getParameter<edm::InputTag>("src2"))),
+  sameSource(iConfig.getParameter<edm::InputTag>("src1") ==
+             iConfig.getParameter<edm::InputTag>("src2")),
+  roles(iConfig.exists("roles") ?
+        iConfig.getParameter<std::vector<std::string> >("roles") :
+        std::vector<std::string>()),
+  zMassMin(iConfig.exists("zMassMin") ?
+           iConfig.getParameter<double>("zMassMin") : 0.),
+  zMassMax(iConfig.exists("zMassMax") ?
+           iConfig.getParameter<double>("zMassMax") : 999999.),
+  leadingZMassMin(iConfig.exists("leadingZMassMin") ?
+                  iConfig.getParameter<double>("leadingZMassMin") : 0.),
+  requireOSSF(iConfig.exists("requireOSSF") ?
+              iConfig.getParameter<bool>("requireOSSF") : true),
+  leptonFlags(iConfig.exists("leptonFlags") ?
+              iConfig.getParameter<std::vector<std::string> >("leptonFlags") :
+              std::vector<std::string>()),
+  checkOverlap(iConfig.exists("checkOverlap") ?
+               iConfig.getParameter<bool>("checkOverlap") : true),
+  pdgId(iConfig.exists("setPdgId") ?
+        iConfig.getParameter<int>("setPdgId") : 25)
+{
+  if(!roles.empty() && roles.size() != 2)
+    throw cms::Exception("InvalidParameter")
+      << "MultiLeptonCandidateBuilder needs exactly two roles (got "
+      << roles.size() << ")" << std::endl;
+
+  produces<std::vector<CCand> >();
+}
+
+
+template<size_t n>
+void MultiLeptonCandidateBuilder<n>::produce(edm::Event& iEvent,
+                                             const edm::EventSetup& iSetup)
+{
+  edm::Handle<edm::View<Cand> > src1;
+  iEvent.getByToken(src1Token, src1);
+
+  std::unique_ptr<std::vector<CCand> > out(new std::vector<CCand>);
+
+  std::vector<ObjInfo> objs1 = selectObjects(*src1, true);
+
+  std::vector<ObjInfo> objs2;
+  if(!(sameSource && n == 4))
+    {
+      edm::Handle<edm::View<Cand> > src2;
+      iEvent.getByToken(src2Token, src2);
+      objs2 = selectObjects(*src2, n == 4);
+    }
+
+  if(sameSource && n == 4)
+    {
+      // Unordered pairs, same order CandCombiner uses
+      for(size_t i1 = 0; i1 < objs1.size(); ++i1)
+        {
+          for(size_t i2 = i1 + 1; i2 < objs1.size(); ++i2)
+            build(objs1[i1], objs1[i2], *out);
+        }
+    }
+  else
+    {
+      for(const auto& obj1 : objs1)
+        {
+          for(const auto& obj2 : objs2)
+            build(obj1, obj2, *out);
+        }
+    }
+
+  iEvent.put(std::move(out));
+}
+
+
+template<size_t n>
+std::vector<typename MultiLeptonCandidateBuilder<n>::ObjInfo>
+MultiLeptonCandidateBuilder<n>::selectObjects(const edm::View<Cand>& coll,
+                                              bool isZ) const
+{
+  std::vector<ObjInfo> out;
+  out.reserve(coll.size());
+
+  for(size_t i = 0; i < coll.size(); ++i)
+    {
+      const Cand& obj = coll.at(i);
+
+      ObjInfo info;
+      info.index = i;
+      info.ref = coll.refAt(i);
+
+      if(isZ)
+        {
+          if(!passZ(obj))
+            continue;
+
+          info.leptons.push_back(obj.daughter(0)->masterClone());
+          info.leptons.push_back(obj.daughter(1)->masterClone());
+        }
+      else
+        {
+          if(!passLeptonFlags(obj))
+            continue;
+
+          info.leptons.push_back(info.ref);
+        }
+
+      out.push_back(info);
+    }
+
+  return out;
+}
+
+
+template<size_t n>
+bool MultiLeptonCandidateBuilder<n>::passZ(const Cand& z) const
+{
+  if(z.numberOfDaughters() != 2)
+    throw cms::Exception("InvalidObject")
+      << "MultiLeptonCandidateBuilder expects Z candidates with two daughters"
+      << std::endl;
+
+  if(z.mass() < zMassMin || z.mass() > zMassMax)
+    return false;
+
+  const Cand* l1 = z.daughter(0);
+  const Cand* l2 = z.daughter(1);
+
+  if(requireOSSF && (l1->charge() != -1 * l2->charge() ||
+                     std::abs(l1->pdgId()) != std::abs(l2->pdgId())))
+    return false;
+
+  return (passLeptonFlags(*(l1->masterClone())) &&
+          passLeptonFlags(*(l2->masterClone())));
+}
+
+
+template<size_t n>
+bool MultiLeptonCandidateBuilder<n>::passLeptonFlags(const Cand& lep) const
+{
+  for(const auto& flag : leptonFlags)
+    {
+      if(leptonUserFloat(lep, flag) < 0.5)
+        return false;
+    }
+
+  return true;
+}
+
+
+template<size_t n>
+float MultiLeptonCandidateBuilder<n>::leptonUserFloat(const Cand& lep,
+                                                      const std::string& label) const
+{
+  const pat::Electron* e = dynamic_cast<const pat::Electron*>(&lep);
+  if(e)
+    return e->userFloat(label);
+
+  const pat::Muon* m = dynamic_cast<const pat::Muon*>(&lep);
+  if(m)
+    return m->userFloat(label);
+
+  throw cms::Exception("InvalidObject")
+    << "MultiLeptonCandidateBuilder: lepton ID flags only work for PAT "
+    << "electrons and muons" << std::endl;
+}
+
+
+template<size_t n>
+bool MultiLeptonCandidateBuilder<n>::shareLepton(const ObjInfo& a,
+                                                 const ObjInfo& b) const
+{
+  for(const auto& la : a.leptons)
+    {
+      for(const auto& lb : b.leptons)
+        {
+          if(la == lb)
+            return true;
+        }
+    }
+
+  return false;
+}
+
+
+template<size_t n>
+void MultiLeptonCandidateBuilder<n>::build(const ObjInfo& a, const ObjInfo& b,
+                                           std::vector<CCand>& out) const
+{
+  if(leadingZMassMin > 0. && n == 4 &&
+     a.ref->mass() <= leadingZMassMin && b.ref->mass() <= leadingZMassMin)
+    return;
+
+  if(checkOverlap)
+    {
+      // sharing a lepton is the common case and doesn't need the full check
+      if(shareLepton(a, b))
+        return;
+      // catches leptons sharing a track or supercluster, same as CandCombiner
+      if(overlap(*a.ref, *b.ref))
+        return;
+    }
+
+  CCand cand;
+  if(roles.empty())
+    {
+      cand.addDaughter(reco::ShallowCloneCandidate(a.ref));
+      cand.addDaughter(reco::ShallowCloneCandidate(b.ref));
+    }
+  else
+    {
+      cand.addDaughter(reco::ShallowCloneCandidate(a.ref), roles.at(0));
+      cand.addDaughter(reco::ShallowCloneCandidate(b.ref), roles.at(1));
+    }
+
+  addP4.set(cand);
+  cand.setPdgId(pdgId);
+
+  out.push_back(cand);
+}
+
+
+typedef MultiLeptonCandidateBuilder<3> MultiLeptonCandidateBuilder3L;
+typedef MultiLeptonCandidateBuilder<4> MultiLeptonCandidateBuilder4L;
+
+DEFINE_FWK_MODULE(MultiLeptonCandidateBuilder3L);
+DEFINE_FWK_MODULE(MultiLeptonCandidateBuilder4L);
@@ -1,7 +1,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 //                                                                           //
 //    Plugin to combine PAT objects into pat::CompositeCandidates made of    //
-//    reco::ShallowCloneCandidates of the originals                          //
+//    reco::ShallowCloneCandidates of the originals. The cut is compiled     //
+//    with uwvv::CompiledCutSelector when it can be.                         //
 //                                                                           //
 //    Nate Woods, U. Wisconsin                                               //
 //                                                                           //
@@ -12,7 +13,7 @@
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "CommonTools/CandAlgos/interface/CandCombiner.h"
 #include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
-#include "CommonTools/UtilAlgos/interface/StringCutObjectSelector.h"
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
 
 
 namespace reco 
@@ -21,7 +22,7 @@ namespace reco
   {
 
     typedef CandCombiner<
-      StringCutObjectSelector<reco::Candidate, true>,
+      uwvv::CompiledCutSelector<reco::Candidate, true>,
       AnyPairSelector,
       combiner::helpers::ShallowClone,
       pat::CompositeCandidateCollection
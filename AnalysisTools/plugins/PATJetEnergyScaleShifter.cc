@@ -2,8 +2,9 @@
 //                                                                          //
 //    PATJetEnergyScaleShifter.cc                                           //
 //                                                                          //
-//    Copies a jet collection to two new collections with the energy scale  //
-//    shifted up and down by 1sigma.                                        //
+//    Embeds the factors that shift a jet's energy scale up and down by     //
+//    1sigma as userFloats (see uwvv::helpers::jetVariationLabel()), so     //
+//    the shifted jets don't need their own collections.                    //
 //                                                                          //
 //    Author: Nate Woods, U. Wisconsin                                      //
 //                                                                          //
@@ -26,6 +27,8 @@
 #include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
 #include "FWCore/Framework/interface/ESHandle.h"
 
+#include "UWVV/Utilities/interface/helpers.h"
+
 typedef pat::Jet Jet;
 typedef std::vector<Jet> VJet;
 typedef edm::View<Jet> JetView;
@@ -41,14 +44,18 @@ class PATJetEnergyScaleShifter : public edm::stream::EDProducer<>
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
   edm::EDGetTokenT<JetView> srcToken;
+
+  const std::string upLabel;
+  const std::string dnLabel;
 };
 
 
 PATJetEnergyScaleShifter::PATJetEnergyScaleShifter(const edm::ParameterSet& pset) :
-  srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src")))
+  srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src"))),
+  upLabel(uwvv::helpers::jetVariationLabel("jesUp")),
+  dnLabel(uwvv::helpers::jetVariationLabel("jesDown"))
 {
-  produces<VJet>("jesUp");
-  produces<VJet>("jesDown");
+  produces<VJet>();
 }
 
 
@@ -63,27 +70,23 @@ void PATJetEnergyScaleShifter::produce(edm::Event& iEvent,
   const JetCorrectorParameters & param = (*jecParams)["Uncertainty"];
   JetCorrectionUncertainty jecUnc(param);
 
-  std::unique_ptr<VJet> outUp(new VJet());
-  std::unique_ptr<VJet> outDn(new VJet());
+  std::unique_ptr<VJet> out(new VJet());
+  out->reserve(in->size());
 
   for(size_t i = 0; i < in->size(); ++i)
     {
       const Jet& jet = in->at(i);
-      outUp->push_back(jet); // copies, transfers ownership
-      outDn->push_back(jet);
+      out->push_back(jet); // copies, transfers ownership
 
       jecUnc.setJetEta(jet.eta());
       jecUnc.setJetPt(jet.pt());
       float unc = jecUnc.getUncertainty(true);
 
-      outUp->back().setP4(math::PtEtaPhiMLorentzVector(jet.pt()*(1.+unc), jet.eta(),
-                                                       jet.phi(), jet.mass()));
-      outDn->back().setP4(math::PtEtaPhiMLorentzVector(jet.pt()*(1.-unc), jet.eta(),
-                                                       jet.phi(), jet.mass()));
+      out->back().addUserFloat(upLabel, 1. + unc);
+      out->back().addUserFloat(dnLabel, 1. - unc);
     }
 
-  iEvent.put(std::move(outUp), "jesUp");
-  iEvent.put(std::move(outDn), "jesDown");
+  iEvent.put(std::move(out));
 }
 
 
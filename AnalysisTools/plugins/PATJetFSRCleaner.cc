@@ -24,7 +24,9 @@
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/Common/interface/View.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
 
 
 typedef reco::Candidate Cand;
@@ -66,8 +68,8 @@ private:
   edm::EDGetTokenT<MuonView> collectionTokenM;
 
   // Consider fsr from leptons passing these selections
-  StringCutObjectSelector<Elec> fsrElecSelection;
-  StringCutObjectSelector<Muon> fsrMuonSelection;
+  uwvv::CompiledCutSelector<Elec> fsrElecSelection;
+  uwvv::CompiledCutSelector<Muon> fsrMuonSelection;
 
   // Label of FSR userCand
   const std::string fsrLabel;
@@ -116,21 +118,19 @@ void PATJetFSRCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSetup
 
   std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
 
+  uwvv::deltaR::EtaPhiBuffer fsrEtaPhi(fsr.size());
+  for(const auto& pho : fsr)
+    fsrEtaPhi.add(*pho);
+
   std::auto_ptr<std::vector<Jet> > out = 
     std::auto_ptr<std::vector<Jet> >(new std::vector<Jet>);
 
   for(size_t iJ = 0; iJ < jetsIn->size(); ++iJ)
     {
-      JetPtr jet = jetsIn->ptrAt(iJ);
-
-      bool rejected = false;
-      for(size_t iFSR = 0; iFSR < fsr.size(); ++iFSR)
-        {
-          rejected = reco::deltaR(fsr.at(iFSR)->p4(), jet->p4()) < coneDR;
-          if(rejected) break;
-        }
-      if(!rejected)
-        out->push_back(*jet);
+      const Jet& jet = jetsIn->at(iJ);
+
+      if(!uwvv::deltaR::anyWithinDeltaR(jet.eta(), jet.phi(), fsrEtaPhi, coneDR))
+        out->push_back(jet);
     }
 
   iEvent.put(out);
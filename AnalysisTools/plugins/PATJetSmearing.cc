@@ -9,9 +9,25 @@
 //        jet.p4() * jet.userFloat("jerCorrInverse")                        //
 //                                                                          //
 //    If systematic shifts are also requested (systematics=cms.bool(True),  //
-//    also produces one collection with the smearing shifted up by one      //
-//    sigma, and another with the smearing shifted down by one sigma, for   //
-//    systematics. Labels for these are "jerUp" and "jerDown".              //
+//    the factors that take the smeared p4 to the p4 with the smearing      //
+//    shifted up and down by one sigma are stored as userFloats for the     //
+//    "jerUp" and "jerDown" variations (see                                 //
+//    uwvv::helpers::jetVariationLabel()).                                  //
+//                                                                          //
+//    Variations listed in scaledVariations (e.g. "jesUp") must already be  //
+//    stored as scale factors on the input jets. The shifted jets are       //
+//    smeared as if they were separate jets, and the factors are replaced   //
+//    with ones relative to the smeared nominal jet.                        //
+//                                                                          //
+//    The random numbers for unmatched jets come from a counter-based       //
+//    generator keyed on run, lumi, event and the jet's index, so they are  //
+//    reproducible regardless of threading and event order. Change "seed"   //
+//    to get an independent set.                                            //
+//                                                                          //
+//    The resolution and scale factor payloads are only read from the       //
+//    EventSetup when their IOV changes (see                                //
+//    uwvv::jer::JetResolutionCache), and are evaluated for all of an       //
+//    event's jets and variations together.                                 //
 //                                                                          //
 //    Obviously, this only makes sense for MC                               //
 //                                                                          //
@@ -23,7 +39,7 @@
 #include<memory>
 #include<string>
 #include<vector>
-#include<cmath> // std::sqrt, std::abs, std::sin
+#include<cmath> // std::sqrt, std::abs
 #include<algorithm> // std::max
 
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -32,11 +48,11 @@
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
-#include "JetMETCorrections/Modules/interface/JetResolution.h"
-#include "CondFormats/JetMETObjects/interface/JetResolutionObject.h"
 #include "DataFormats/Math/interface/LorentzVector.h"
 
-#include "TRandom3.h"
+#include "UWVV/Utilities/interface/helpers.h"
+#include "UWVV/Utilities/interface/CounterRNG.h"
+#include "UWVV/Utilities/interface/JetResolutionCache.h"
 
 
 typedef pat::Jet Jet;
@@ -52,10 +68,31 @@ class PATJetSmearing : public edm::stream::EDProducer<>
  private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
+  // Ratio of smeared to unsmeared pt for a jet with transverse momentum pt
+  // (which is not jet.pt() for energy scale variations)
+  float smearFactor(const Jet& jet, float pt, float relPtErr, float sf,
+                    float smear) const;
+
   edm::EDGetTokenT<JetView> srcToken;
   edm::EDGetTokenT<double> rhoToken;
 
   const bool systematics;
+  const unsigned seed;
+  const std::string jerUpLabel;
+  const std::string jerDnLabel;
+  std::vector<std::string> scaledVariationLabels;
+
+  // Payloads are only fetched again when their IOV changes
+  uwvv::jer::JetResolutionCache jerCache;
+
+  // Per-event working space, kept to avoid reallocating
+  std::vector<float> pts;
+  std::vector<float> etas;
+  std::vector<float> relPtErrs;
+  std::vector<float> sfs;
+  std::vector<float> sfsDn;
+  std::vector<float> sfsUp;
+  std::vector<float> smears;
 };
 
 
@@ -63,14 +100,20 @@ PATJetSmearing::PATJetSmearing(const edm::ParameterSet& pset) :
   srcToken(consumes<JetView>(pset.getParameter<edm::InputTag>("src"))),
   rhoToken(consumes<double>(pset.getParameter<edm::InputTag>("rhoSrc"))),
   systematics(pset.exists("systematics") ?
-              pset.getParameter<bool>("systematics") : false)
+              pset.getParameter<bool>("systematics") : false),
+  seed(pset.exists("seed") ?
+       pset.getParameter<unsigned>("seed") : 0),
+  jerUpLabel(uwvv::helpers::jetVariationLabel("jerUp")),
+  jerDnLabel(uwvv::helpers::jetVariationLabel("jerDown")),
+  jerCache("AK4PFchs_pt", "AK4PFchs")
 {
-  produces<VJet>();
-  if(systematics)
+  if(pset.exists("scaledVariations"))
     {
-      produces<VJet>("jerUp");
-      produces<VJet>("jerDown");
+      for(const auto& v : pset.getParameter<std::vector<std::string> >("scaledVariations"))
+        scaledVariationLabels.push_back(uwvv::helpers::jetVariationLabel(v));
     }
+
+  produces<VJet>();
 }
 
 
@@ -83,87 +126,125 @@ void PATJetSmearing::produce(edm::Event& iEvent,
   iEvent.getByToken(rhoToken, rho);
 
   std::unique_ptr<VJet> out(new VJet());
-  std::unique_ptr<VJet> outUp(new VJet());
-  std::unique_ptr<VJet> outDn(new VJet());
+  out->reserve(in->size());
 
-  JME::JetResolutionScaleFactor resSF =
-    JME::JetResolutionScaleFactor::get(iSetup, "AK4PFchs");
-  JME::JetResolution resPt = JME::JetResolution::get(iSetup, "AK4PFchs_pt");
+  jerCache.update(iSetup);
 
-  for(size_t i = 0; i < in->size(); ++i)
+  const size_t nJets = in->size();
+  const size_t nScaled = scaledVariationLabels.size();
+
+  // Everything the resolution and scale factors depend on, for all jets
+  // (and their scaled variations) at once
+  pts.resize(nJets * (1 + nScaled));
+  etas.resize(nJets * (1 + nScaled));
+  for(size_t i = 0; i < nJets; ++i)
     {
       const Jet& jet = in->at(i);
+      pts[i] = jet.pt();
+      etas[i] = jet.eta();
 
-      float pt = jet.pt();
-      float eta = jet.eta();
-      float phi = jet.phi();
+      for(size_t v = 0; v < nScaled; ++v)
+        {
+          pts[nJets * (v + 1) + i] = jet.userFloat(scaledVariationLabels[v]) * pts[i];
+          etas[nJets * (v + 1) + i] = etas[i];
+        }
+    }
 
-      JME::JetParameters params;
-      params.setJetPt(pt).setJetEta(eta).setRho(*rho);
+  relPtErrs.resize(pts.size());
+  jerCache.resolutions(pts.size(), pts.data(), etas.data(), *rho,
+                       relPtErrs.data());
 
-      float relPtErr = resPt.getResolution(params);
+  sfs.resize(nJets);
+  sfsDn.resize(nJets);
+  sfsUp.resize(nJets);
+  jerCache.scaleFactors(nJets, etas.data(), *rho,
+                        sfs.data(), sfsDn.data(), sfsUp.data());
 
-      JME::JetParameters paramsSF;
-      paramsSF.setJetEta(eta).setRho(*rho);
+  // One random number per jet, shared by the nominal jet and its variations
+  uwvv::random::EventRandom rng(iEvent.id().run(), iEvent.id().luminosityBlock(),
+                                iEvent.id().event(), seed);
+  smears.resize(nJets);
+  rng.gaussians(smears.size(), smears.data());
 
-      float sf = resSF.getScaleFactor(paramsSF);
-      float sfUp = systematics ? resSF.getScaleFactor(paramsSF, Variation::UP) : 0.;
-      float sfDn = systematics ? resSF.getScaleFactor(paramsSF, Variation::DOWN) : 0.;
+  for(size_t i = 0; i < nJets; ++i)
+    {
+      const Jet& jet = in->at(i);
 
-      double ptJER, ptJERUp, ptJERDn;
-      const reco::GenJet* gen = jet.genJet();
-      if(gen && reco::deltaR(eta, phi, gen->eta(), gen->phi()) < 0.2 &&
-         (std::abs(pt - gen->pt()) < 3. * relPtErr * pt))
-        {
-          float genPt = gen->pt();
+      float pt = pts[i];
+      float relPtErr = relPtErrs[i];
+      float sf = sfs[i];
+      float smear = smears[i];
 
-          ptJER = std::max(float(0.), genPt + sf * (pt - genPt));
-          ptJERUp = std::max(float(0.), genPt + sfUp * (pt - genPt));
-          ptJERDn = std::max(float(0.), genPt + sfDn * (pt - genPt));
-        }
-      else
-        {
-          TRandom3 rand;
-          rand.SetSeed(std::abs(static_cast<int>(std::sin(phi)*100000)));
-          float smear = rand.Gaus(0.,1.);
-          float sig = std::sqrt(sf * sf - 1.) * relPtErr * pt;
-          float sigUp = std::sqrt(sfUp * sfUp - 1.) * relPtErr * pt;
-          float sigDn = std::sqrt(sfDn * sfDn - 1.) * relPtErr * pt;
-          ptJER = std::max(float(0.), smear * sig + pt);
-          ptJERUp = std::max(float(0.), smear * sigUp + pt);
-          ptJERDn = std::max(float(0.), smear * sigDn + pt);
-        }
+      float jerCorr = smearFactor(jet, pt, relPtErr, sf, smear);
 
-      float jerCorr = ptJER / pt;
-      float jerCorrUp = ptJERUp / pt;
-      float jerCorrDn = ptJERDn / pt;
+      out->push_back(jet);
+      out->back().setP4(jerCorr * jet.p4());
 
-      math::XYZTLorentzVector p4JER = jerCorr * jet.p4();
-      math::XYZTLorentzVector p4JERUp = jerCorrUp * jet.p4();
-      math::XYZTLorentzVector p4JERDn = jerCorrDn * jet.p4();
+      // A jet smeared down to nothing has no p4 left to scale, so it can't
+      // be un-smeared and stays at zero in every variation
+      if(jerCorr <= 0.)
+        {
+          out->back().addUserFloat("jerCorrInverse", 0.);
+          if(systematics)
+            {
+              out->back().addUserFloat(jerUpLabel, 0.);
+              out->back().addUserFloat(jerDnLabel, 0.);
+            }
+          for(size_t v = 0; v < nScaled; ++v)
+            out->back().addUserFloat(scaledVariationLabels[v], 0., true);
+
+          continue;
+        }
 
-      out->push_back(jet);
-      out->back().setP4(p4JER);
-      out->back().addUserFloat("jerCorrInverse", 1./jerCorr);
+      float jerCorrInv = 1. / jerCorr;
+      out->back().addUserFloat("jerCorrInverse", jerCorrInv);
 
       if(systematics)
         {
-          outUp->push_back(jet);
-          outUp->back().setP4(p4JERUp);
-          outUp->back().addUserFloat("jerCorrInverse", 1./jerCorrUp);
+          out->back().addUserFloat(jerUpLabel,
+                                   smearFactor(jet, pt, relPtErr, sfsUp[i], smear) * jerCorrInv);
+          out->back().addUserFloat(jerDnLabel,
+                                   smearFactor(jet, pt, relPtErr, sfsDn[i], smear) * jerCorrInv);
+        }
+
+      for(size_t v = 0; v < nScaled; ++v)
+        {
+          float scale = jet.userFloat(scaledVariationLabels[v]);
+          float ptVar = pts[nJets * (v + 1) + i];
+          float relPtErrVar = relPtErrs[nJets * (v + 1) + i];
+
+          float jerCorrVar = smearFactor(jet, ptVar, relPtErrVar, sf, smear);
 
-          outDn->push_back(jet);
-          outDn->back().setP4(p4JERDn);
-          outDn->back().addUserFloat("jerCorrInverse", 1./jerCorrDn);
+          out->back().addUserFloat(scaledVariationLabels[v],
+                                   scale * jerCorrVar * jerCorrInv, true);
         }
     }
 
   iEvent.put(std::move(out));
-  if(systematics)
+}
+
+
+float PATJetSmearing::smearFactor(const Jet& jet, float pt, float relPtErr,
+                                  float sf, float smear) const
+{
+  if(pt <= 0.)
+    return 0.;
+
+  double ptJER;
+  const reco::GenJet* gen = jet.genJet();
+  if(gen && reco::deltaR(jet.eta(), jet.phi(), gen->eta(), gen->phi()) < 0.2 &&
+     (std::abs(pt - gen->pt()) < 3. * relPtErr * pt))
+    {
+      float genPt = gen->pt();
+      ptJER = std::max(float(0.), genPt + sf * (pt - genPt));
+    }
+  else
     {
-      iEvent.put(std::move(outUp), "jerUp");
-      iEvent.put(std::move(outDn), "jerDown");
+      float sig = std::sqrt(sf * sf - 1.) * relPtErr * pt;
+      ptJER = std::max(float(0.), smear * sig + pt);
     }
+
+  return ptJER / pt;
 }
 
 
@@ -6,6 +6,18 @@
 //       (1 for true, 0 for false) for use in other modules, using          //
 //       HZZ4l2015 definitions.                                             //
 //                                                                          //
+//   Works in two passes: first the kinematics, isolation sums and cone     //
+//       definitions of all electrons and muons and the kinematics of all   //
+//       FSR photons are gathered into flat arrays, then every lepton's     //
+//       FSR-subtracted isolation is computed from them at once. The FSR    //
+//       cone test uses the p4 directions and double-precision deltaR, as   //
+//       the per-lepton calculation always has, so the results don't move.  //
+//       With checkReference=cms.bool(True), each value is also computed    //
+//       one lepton at a time the old way and the job fails if they are not //
+//       bit-for-bit identical. With reportTiming=cms.bool(True), the mean  //
+//       and maximum time per event are printed for each stream when it     //
+//       ends.                                                              //
+//                                                                          //
 //   Author: Nate Woods, U. Wisconsin                                       //
 //                                                                          //
 //////////////////////////////////////////////////////////////////////////////
@@ -15,21 +27,26 @@
 #include <memory>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <cstring>
 
 // CMS includes
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/EDProducer.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
 #include "DataFormats/PatCandidates/interface/Electron.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/Common/interface/ValueMap.h"
 #include "DataFormats/Common/interface/View.h"
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "DataFormats/MuonReco/interface/MuonPFIsolation.h"
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
 
 
 typedef reco::Candidate Cand;
@@ -52,32 +69,45 @@ public:
 private:
   //// Methods
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+  virtual void endStream();
+
+  // Pass 1: add the leptons' kinematics, isolation sums and FSR cones to
+  // the arrays below
+  template<typename Lep>
+  void gatherLeptons(const edm::Handle<edm::View<Lep> >& leps);
+  // Pass 2: isolation for every lepton gathered
+  void computeIsolation();
 
-  // Make collection to output. Heap allocation done here.
+  // Make collection to output, using the isolation values starting at
+  // position offset. Heap allocation done here.
   template<typename Lep>
   std::auto_ptr<std::vector<Lep> >
   makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
-                 const std::vector<CandPtr>& fsrs) const;
+                 size_t offset) const;
 
-  // Actual isolation calculation
-  template<typename Lep>
-  float relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                    const std::vector<CandPtr>& fsrs) const;
-  float isoPUCorrection(const ElecPtr& e) const;
-  float isoPUCorrection(const MuonPtr& m) const;
+  // Isolation calculated for one lepton at a time, to check against
   template<typename Lep>
-  float isoFSRCorrection(const edm::Ptr<Lep>& lep,
-                         const std::vector<CandPtr>& fsr) const;
+  float relPFIsoFSRReference(const edm::Ptr<Lep>& lep,
+                             const std::vector<CandPtr>& fsrs) const;
+  float isoPUCorrection(const Elec& e) const;
+  float isoPUCorrection(const Muon& m) const;
   bool fsrInIsoCone(const ElecPtr& e,
                     const CandPtr& fsr) const;
   bool fsrInIsoCone(const MuonPtr& m,
                     const CandPtr& fsr) const;
-  
+
   // Isolation variables for e and mu (why isn't this standard???)
   const reco::GsfElectron::PflowIsolationVariables& 
-  isolationVariables(const ElecPtr&) const;
+  isolationVariables(const Elec&) const;
   const reco::MuonPFIsolation& 
-  isolationVariables(const MuonPtr&) const;
+  isolationVariables(const Muon&) const;
+
+  // Cone for FSR subtraction for e or mu. The veto cone is only used if
+  // useVeto comes back true.
+  void isoCone(const Elec& e, double& dRMax, double& dRMin,
+               bool& useVeto) const;
+  void isoCone(const Muon& m, double& dRMax, double& dRMin,
+               bool& useVeto) const;
 
   // Get all FSR photons
   std::vector<CandPtr> getFSR(const edm::Handle<ElecView>& elecs,
@@ -90,8 +120,8 @@ private:
   bool selectFSRLep(const MuonPtr& m) const;
 
   // Helper to get cut value for e or mu
-  const float getIsoCut(const ElecPtr& e) const {return isoCutE;}
-  const float getIsoCut(const MuonPtr& m) const {return isoCutM;}
+  const float getIsoCut(const Elec& e) const {return isoCutE;}
+  const float getIsoCut(const Muon& m) const {return isoCutM;}
 
   //// Data
   edm::EDGetTokenT<ElecView> collectionTokenE;
@@ -124,11 +154,42 @@ private:
   const double isoConeDRMinM;
 
   // Consider fsr from leptons passing these selections
-  StringCutObjectSelector<Elec> fsrElecSelection;
-  StringCutObjectSelector<Muon> fsrMuonSelection;
+  uwvv::CompiledCutSelector<Elec> fsrElecSelection;
+  uwvv::CompiledCutSelector<Muon> fsrMuonSelection;
 
   // Label of FSR userCand
   const std::string fsrLabel;
+
+  const bool checkReference;
+  const bool reportTiming;
+
+  //// Per-event arrays, electrons first then muons. Types match what the
+  //// per-lepton calculation used so the results are identical; the
+  //// directions are p4().eta() and p4().phi(), which is what
+  //// reco::deltaR(fsr->p4(), lep->p4()) uses.
+  std::vector<double> lepEta;
+  std::vector<double> lepPhi;
+  std::vector<double> lepPt;
+  std::vector<float> chHadIso;
+  std::vector<float> nHadIso;
+  std::vector<float> phoIso;
+  std::vector<float> puCorrection;
+  std::vector<double> coneDRMax;
+  std::vector<double> coneDRMin;
+  std::vector<unsigned char> coneUseVeto;
+  std::vector<float> isoCut;
+
+  std::vector<double> fsrEta;
+  std::vector<double> fsrPhi;
+  std::vector<double> fsrPt;
+
+  std::vector<float> isoValues;
+  std::vector<unsigned char> isoDecisions;
+
+  // Timing
+  unsigned long long nEvents;
+  double totalTime; // seconds
+  double maxTime;
 };
 
 
@@ -176,7 +237,14 @@ PATLeptonZZIsoEmbedder::PATLeptonZZIsoEmbedder(const edm::ParameterSet& iConfig)
                    ""),
   fsrLabel(iConfig.exists("fsrLabel") ?
            iConfig.getParameter<std::string>("fsrLabel") :
-           std::string("dretFSRCand"))
+           std::string("dretFSRCand")),
+  checkReference(iConfig.exists("checkReference") ?
+                 iConfig.getParameter<bool>("checkReference") : false),
+  reportTiming(iConfig.exists("reportTiming") ?
+               iConfig.getParameter<bool>("reportTiming") : false),
+  nEvents(0),
+  totalTime(0.),
+  maxTime(0.)
 {
   produces<std::vector<Elec> >("electrons");
   produces<std::vector<Muon> >("muons");
@@ -185,6 +253,8 @@ PATLeptonZZIsoEmbedder::PATLeptonZZIsoEmbedder(const edm::ParameterSet& iConfig)
 
 void PATLeptonZZIsoEmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 {
+  auto start = std::chrono::steady_clock::now();
+
   edm::Handle<ElecView> elecsIn;
   edm::Handle<MuonView> muonsIn;
 
@@ -193,40 +263,157 @@ void PATLeptonZZIsoEmbedder::produce(edm::Event& iEvent, const edm::EventSetup&
 
   std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
 
-  outE = makeCollection(elecsIn, fsr);
-  outM = makeCollection(muonsIn, fsr);
+  fsrEta.clear();
+  fsrPhi.clear();
+  fsrPt.clear();
+  for(const auto& pho : fsr)
+    {
+      fsrEta.push_back(pho->p4().eta());
+      fsrPhi.push_back(pho->p4().phi());
+      fsrPt.push_back(pho->pt());
+    }
+
+  lepEta.clear();
+  lepPhi.clear();
+  lepPt.clear();
+  chHadIso.clear();
+  nHadIso.clear();
+  phoIso.clear();
+  puCorrection.clear();
+  coneDRMax.clear();
+  coneDRMin.clear();
+  coneUseVeto.clear();
+  isoCut.clear();
+
+  gatherLeptons(elecsIn);
+  gatherLeptons(muonsIn);
+
+  computeIsolation();
+
+  if(checkReference)
+    {
+      for(size_t i = 0; i < lepPt.size(); ++i)
+        {
+          if(lepPt[i] <= 0.)
+            continue;
+
+          float ref = (i < elecsIn->size() ?
+                       relPFIsoFSRReference(elecsIn->ptrAt(i), fsr) :
+                       relPFIsoFSRReference(muonsIn->ptrAt(i - elecsIn->size()), fsr));
+          if(std::memcmp(&ref, &isoValues[i], sizeof(float)))
+            throw cms::Exception("IsolationMismatch")
+              << "Lepton " << i << " in event " << iEvent.id()
+              << " has isolation " << isoValues[i]
+              << " but the per-lepton calculation gives " << ref
+              << std::endl;
+        }
+    }
+
+  outE = makeCollection(elecsIn, 0);
+  outM = makeCollection(muonsIn, elecsIn->size());
 
   iEvent.put(outE, "electrons");
   iEvent.put(outM, "muons");
+
+  if(reportTiming)
+    {
+      double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      ++nEvents;
+      totalTime += t;
+      if(t > maxTime)
+        maxTime = t;
+    }
+}
+
+
+void PATLeptonZZIsoEmbedder::endStream()
+{
+  if(reportTiming && nEvents)
+    std::cout << "PATLeptonZZIsoEmbedder: " << nEvents << " events, "
+              << 1.e6 * totalTime / nEvents << " us/event on average, "
+              << 1.e6 * maxTime << " us max" << std::endl;
+}
+
+
+template<typename Lep>
+void
+PATLeptonZZIsoEmbedder::gatherLeptons(const edm::Handle<edm::View<Lep> >& leps)
+{
+  for(const Lep& lep : *leps)
+    {
+      lepEta.push_back(lep.p4().eta());
+      lepPhi.push_back(lep.p4().phi());
+      lepPt.push_back(lep.pt());
+
+      const auto& isoVars = isolationVariables(lep);
+      chHadIso.push_back(isoVars.sumChargedHadronPt);
+      nHadIso.push_back(isoVars.sumNeutralHadronEt);
+      phoIso.push_back(isoVars.sumPhotonEt);
+      puCorrection.push_back(lep.pt() > 0. ? isoPUCorrection(lep) : 0.);
+
+      double dRMax = 0.;
+      double dRMin = 0.;
+      bool useVeto = true;
+      if(!fsrPt.empty())
+        isoCone(lep, dRMax, dRMin, useVeto);
+      coneDRMax.push_back(dRMax);
+      coneDRMin.push_back(dRMin);
+      coneUseVeto.push_back(useVeto);
+
+      isoCut.push_back(getIsoCut(lep));
+    }
+}
+
+
+void PATLeptonZZIsoEmbedder::computeIsolation()
+{
+  const size_t nLep = lepPt.size();
+  const size_t nFSR = fsrPt.size();
+
+  isoValues.assign(nLep, 9999.);
+  isoDecisions.assign(nLep, 0);
+
+  for(size_t i = 0; i < nLep; ++i)
+    {
+      // Something about the HZZ electron energy corrections causes
+      // some electrons to have pt of 0; do this to avoid an infinity
+      if(!(lepPt[i] > 0.))
+        continue;
+
+      float fsrCorrection = 0.;
+      for(size_t j = 0; j < nFSR; ++j)
+        {
+          // Same argument order and precision as the per-lepton version
+          float dR = reco::deltaR(fsrEta[j], fsrPhi[j], lepEta[i], lepPhi[i]);
+          if(dR < coneDRMax[i] && (!coneUseVeto[i] || dR > coneDRMin[i]))
+            fsrCorrection += fsrPt[j];
+        }
+
+      float neutralIso = nHadIso[i] + phoIso[i] - puCorrection[i] - fsrCorrection;
+      if(neutralIso < 0.)
+        neutralIso = 0.;
+
+      isoValues[i] = ((chHadIso[i] + neutralIso) / lepPt[i]);
+      isoDecisions[i] = (isoValues[i] < isoCut[i]);
+    }
 }
     
 
 template<typename Lep>
 std::auto_ptr<std::vector<Lep> >
 PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
-                                       const std::vector<CandPtr>& fsrs) const
+                                       size_t offset) const
 {
   std::auto_ptr<std::vector<Lep> > out = 
     std::auto_ptr<std::vector<Lep> >(new std::vector<Lep>);
+  out->reserve(lepsIn->size());
 
   for(size_t iLep = 0; iLep < lepsIn->size(); ++iLep)
     {
-      const edm::Ptr<Lep> lep = lepsIn->ptrAt(iLep);
-
-      out->push_back(*lep); // copy lepton to save correctly in event
-
-      // Something about the HZZ electron energy corrections causes
-      // some electrons to have pt of 0; do this to avoid an infinity
-      float iso = 9999.;
-      bool decision  = false;
-      if(out->back().pt() > 0.)
-        {
-          iso = relPFIsoFSR(lep, fsrs);
-          decision = (iso < getIsoCut(lep));
-        }
-      out->back().addUserFloat(isoValueLabel, iso);
-      out->back().addUserFloat(isoDecisionLabel, float(decision)); // 1 for true, 0 for false
+      out->push_back(lepsIn->at(iLep)); // copy lepton to save correctly in event
 
+      out->back().addUserFloat(isoValueLabel, isoValues[offset + iLep]);
+      out->back().addUserFloat(isoDecisionLabel, float(isoDecisions[offset + iLep])); // 1 for true, 0 for false
     }
 
   return out;
@@ -235,15 +422,20 @@ PATLeptonZZIsoEmbedder::makeCollection(const edm::Handle<edm::View<Lep> >& lepsI
 
 template<typename Lep>
 float 
-PATLeptonZZIsoEmbedder::relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                                    const std::vector<CandPtr>& fsrs) const
+PATLeptonZZIsoEmbedder::relPFIsoFSRReference(const edm::Ptr<Lep>& lep,
+                                             const std::vector<CandPtr>& fsrs) const
 {
-  float chHadIso = isolationVariables(lep).sumChargedHadronPt;
-  float nHadIso = isolationVariables(lep).sumNeutralHadronEt;
-  float phoIso = isolationVariables(lep).sumPhotonEt;
-  float puCorrection = isoPUCorrection(lep);
+  float chHadIso = isolationVariables(*lep).sumChargedHadronPt;
+  float nHadIso = isolationVariables(*lep).sumNeutralHadronEt;
+  float phoIso = isolationVariables(*lep).sumPhotonEt;
+  float puCorrection = isoPUCorrection(*lep);
 
-  float fsrCorrection = isoFSRCorrection(lep, fsrs);
+  float fsrCorrection = 0.;
+  for(auto iFSR = fsrs.begin(); iFSR != fsrs.end(); iFSR++)
+    {
+      if(fsrInIsoCone(lep, *iFSR))
+         fsrCorrection += (*iFSR)->pt();
+    }
   
   float neutralIso = nHadIso + phoIso - puCorrection - fsrCorrection;
   if(neutralIso < 0.)
@@ -254,49 +446,52 @@ PATLeptonZZIsoEmbedder::relPFIsoFSR(const edm::Ptr<Lep>& lep,
 
 
 float
-PATLeptonZZIsoEmbedder::isoPUCorrection(const ElecPtr& e) const
+PATLeptonZZIsoEmbedder::isoPUCorrection(const Elec& e) const
 {
-  return (e->userFloat(rhoLabel) * 
-          e->userFloat(eaLabel) * 
+  return (e.userFloat(rhoLabel) * 
+          e.userFloat(eaLabel) * 
           eaScaleFactor);
 }
 
 
 float
-PATLeptonZZIsoEmbedder::isoPUCorrection(const MuonPtr& m) const
+PATLeptonZZIsoEmbedder::isoPUCorrection(const Muon& m) const
 {
   return 0.5 * isolationVariables(m).sumPUPt;
 }
 
 
 const reco::GsfElectron::PflowIsolationVariables&
-PATLeptonZZIsoEmbedder::isolationVariables(const ElecPtr& e) const
+PATLeptonZZIsoEmbedder::isolationVariables(const Elec& e) const
 {
-  return e->pfIsolationVariables();
+  return e.pfIsolationVariables();
 }
 
 
 const reco::MuonPFIsolation&
-PATLeptonZZIsoEmbedder::isolationVariables(const MuonPtr& m) const
+PATLeptonZZIsoEmbedder::isolationVariables(const Muon& m) const
 {
-  return m->pfIsolationR03();
+  return m.pfIsolationR03();
 }
 
 
-template<typename Lep>
-float
-PATLeptonZZIsoEmbedder::isoFSRCorrection(const edm::Ptr<Lep>& lep,
-                                             const std::vector<CandPtr>& fsrs) const
+void
+PATLeptonZZIsoEmbedder::isoCone(const Elec& e, double& dRMax,
+                                double& dRMin, bool& useVeto) const
 {
-  float corr = 0.;
+  dRMax = isoConeDRMaxE;
+  dRMin = isoConeDRMinE;
+  useVeto = !(e.superCluster()->eta() < isoConeVetoEtaThresholdE);
+}
 
-  for(auto iFSR = fsrs.begin(); iFSR != fsrs.end(); iFSR++)
-    {
-      if(fsrInIsoCone(lep, *iFSR))
-         corr += (*iFSR)->pt();
-    }
 
-  return corr;
+void
+PATLeptonZZIsoEmbedder::isoCone(const Muon& m, double& dRMax,
+                                double& dRMin, bool& useVeto) const
+{
+  dRMax = isoConeDRMaxM;
+  dRMin = isoConeDRMinM;
+  useVeto = true;
 }
 
 
@@ -304,7 +499,6 @@ bool
 PATLeptonZZIsoEmbedder::fsrInIsoCone(const ElecPtr& e,
                                      const CandPtr& fsr) const
 {
-  // float fsrDR = reco::deltaR(*fsr, *(e->superCluster()));
   float fsrDR = reco::deltaR(fsr->p4(), e->p4());
 
   bool inCone = (fsrDR < isoConeDRMaxE && 
@@ -371,11 +565,3 @@ PATLeptonZZIsoEmbedder::selectFSRLep(const MuonPtr& m) const
 
 //define this as a plug-in
 DEFINE_FWK_MODULE(PATLeptonZZIsoEmbedder);
-
-
-
-
-
-
-
-
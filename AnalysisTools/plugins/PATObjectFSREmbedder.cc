@@ -7,9 +7,11 @@
 ///        electron supercluster, and pair it to its closest lepton.       ///
 ///        For each lepton, embed the photon with the smallest deltaR/eT   ///
 ///        as a usercand. Cut strings may be supplied for all three types  ///
-///        of objects, and parameters for calculating isolation from       ///
-///        packed PF candidates (which can also have a cut string) can be  ///
-///        specified.                                                      ///
+///        of objects, and parameters for calculating isolation can be     ///
+///        specified. The neutral and charged PF candidates for the        ///
+///        isolation sum are only selected (and sorted by eta, so each     ///
+///        cone only looks at a narrow eta window) if a photon gets as     ///
+///        far as the isolation requirement.                               ///
 ///                                                                        ///
 ///    Author: Nate Woods, U. Wisconsin                                    ///
 ///                                                                        ///
@@ -35,9 +37,12 @@
 #include "DataFormats/PatCandidates/interface/PackedCandidate.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/PatCandidates/interface/Electron.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "DataFormats/Common/interface/RefToPtr.h"
 
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
+#include "UWVV/Utilities/interface/EtaSortedCandidates.h"
+
 
 typedef reco::Candidate Cand;
 typedef edm::Ptr<Cand> CandPtr;
@@ -60,16 +65,27 @@ public:
 
 private:
   virtual void produce(edm::Event&, const edm::EventSetup&);
+
+  // PF candidates used in the isolation sum, only filled when the first
+  // photon needs them
+  struct IsoCands
+  {
+    IsoCands() : filled(false) {;}
+
+    bool filled;
+    uwvv::EtaSortedCandidates neutral;
+    uwvv::EtaSortedCandidates charged;
+  };
   
   // check if pho is in PF supercluster of any passing electron
   bool candInSuperCluster(const PCandRef& pho, 
-                          const edm::Handle<edm::View<Elec> >& elecs) const;
+                          const edm::Handle<edm::View<Elec> >& elecs,
+                          const std::vector<bool>& elecPass) const;
   
-  // Compute relative isolation for pho from the cands in nIsoCands and chIsoCands
-  // If those vectors are empty, they are filled from allCands
+  // Compute relative isolation for pho from the cands in isoCands
+  // If those haven't been filled yet, they are filled from allCands
   bool passIso(const PCandRef& pho,
-               std::vector<PCandRef>& nIsoCands,
-               std::vector<PCandRef>& chIsoCands,
+               IsoCands& isoCands,
                const edm::Handle<edm::View<PCand> >& allCands) const;
 
   edm::EDGetTokenT<PCandView> cands_;
@@ -77,11 +93,11 @@ private:
   edm::EDGetTokenT<MuonView> muons_;
   
 
-  StringCutObjectSelector<PCand> phoSelection_;
-  StringCutObjectSelector<PCand> nIsoSelection_;
-  StringCutObjectSelector<PCand> chIsoSelection_;
-  StringCutObjectSelector<Elec> eSelection_;
-  StringCutObjectSelector<Muon> mSelection_;
+  uwvv::CompiledCutSelector<PCand> phoSelection_;
+  uwvv::CompiledCutSelector<PCand> nIsoSelection_;
+  uwvv::CompiledCutSelector<PCand> chIsoSelection_;
+  uwvv::CompiledCutSelector<Elec> eSelection_;
+  uwvv::CompiledCutSelector<Muon> mSelection_;
 
   std::string fsrLabel_;
   
@@ -176,6 +192,27 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
   iEvent.getByToken(muons_, mus);
 
   
+  // evaluate lepton selections once, and collect lepton positions so
+  // each photon can be checked against all of them at once
+  std::vector<bool> elecPass(elecs->size());
+  uwvv::deltaR::EtaPhiBuffer elecEtaPhi(elecs->size());
+  for(size_t iE = 0; iE < elecs->size(); ++iE)
+    {
+      elecPass[iE] = eSelection_(elecs->at(iE));
+      elecEtaPhi.add(elecs->at(iE));
+    }
+
+  std::vector<bool> muPass(mus->size());
+  uwvv::deltaR::EtaPhiBuffer muEtaPhi(mus->size());
+  for(size_t iM = 0; iM < mus->size(); ++iM)
+    {
+      muPass[iM] = mSelection_(mus->at(iM));
+      muEtaPhi.add(mus->at(iM));
+    }
+
+  std::vector<float> phoElecDR;
+  std::vector<float> phoMuDR;
+
   // associate photons to their closest leptons
   std::vector<std::vector<PCandRef> > phosByEle = std::vector<std::vector<PCandRef> >(elecs->size());
   std::vector<std::vector<PCandRef> > phosByMu = std::vector<std::vector<PCandRef> >(mus->size());
@@ -191,11 +228,14 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
       std::list<std::pair<size_t, float> > closeEles;
       std::list<std::pair<size_t, float> > closeMus;
 
+      uwvv::deltaR::deltaROneToMany(pho->eta(), pho->phi(), elecEtaPhi, phoElecDR);
+      uwvv::deltaR::deltaROneToMany(pho->eta(), pho->phi(), muEtaPhi, phoMuDR);
+
       for(size_t iE = 0; iE < elecs->size(); ++iE)
         {
-          float deltaR = reco::deltaR(pho->p4(), elecs->at(iE).p4());
+          float deltaR = phoElecDR[iE];
 
-          if(deltaR > maxDR_ || !eSelection_(elecs->at(iE)))
+          if(deltaR > maxDR_ || !elecPass[iE])
             continue;
 
           if(closeEles.empty() || deltaR < closeEles.front().second)
@@ -212,9 +252,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
       for(size_t iM = 0; iM < mus->size(); ++iM)
         {
-          float deltaR = reco::deltaR(pho->p4(), mus->at(iM).p4());
+          float deltaR = phoMuDR[iM];
 
-          if(deltaR > maxDR_ || !mSelection_(mus->at(iM)))
+          if(deltaR > maxDR_ || !muPass[iM])
             continue;
 
           if(closeMus.empty() || deltaR < closeMus.front().second)
@@ -314,8 +354,7 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
   
   // Will be filled in isolation calculation function if needed
-  std::vector<PCandRef> nIsoCands;
-  std::vector<PCandRef> chIsoCands;
+  IsoCands isoCands;
 
   for(size_t iE = 0; iE < elecs->size(); ++iE)
     {
@@ -332,9 +371,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
           if(drEt > cut_ || drEt > dREtBestPho) continue;
 
-          if(candInSuperCluster(pho, elecs)) continue;
+          if(candInSuperCluster(pho, elecs, elecPass)) continue;
 
-          if(!passIso(pho, nIsoCands, chIsoCands, cands)) continue;
+          if(!passIso(pho, isoCands, cands)) continue;
 
           dREtBestPho = drEt;
           bestPho = pho;
@@ -364,9 +403,9 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
           if(drEt > cut_ || drEt > dREtBestPho) continue;
 
-          if(candInSuperCluster(pho, elecs)) continue;
+          if(candInSuperCluster(pho, elecs, elecPass)) continue;
 
-          if(!passIso(pho, nIsoCands, chIsoCands, cands)) continue;
+          if(!passIso(pho, isoCands, cands)) continue;
 
           dREtBestPho = drEt;
           bestPho = pho;
@@ -387,13 +426,14 @@ void PATObjectFSREmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iS
 
 
 bool PATObjectFSREmbedder::candInSuperCluster(const PCandRef& pho, 
-                                              const edm::Handle<edm::View<Elec> >& elecs) const
+                                              const edm::Handle<edm::View<Elec> >& elecs,
+                                              const std::vector<bool>& elecPass) const
 {
   for(size_t iE = 0; iE < elecs->size(); ++iE)
     {
-      ElecPtr elec = elecs->ptrAt(iE);
-      if(eSelection_(*elec))
+      if(elecPass[iE])
         {
+          ElecPtr elec = elecs->ptrAt(iE);
           for(auto& cand : elec->associatedPackedPFCandidates())
             {
               if(pho == cand)
@@ -407,37 +447,26 @@ bool PATObjectFSREmbedder::candInSuperCluster(const PCandRef& pho,
 
 
 bool PATObjectFSREmbedder::passIso(const PCandRef& pho,
-                                   std::vector<PCandRef>& nIsoCands,
-                                   std::vector<PCandRef>& chIsoCands,
+                                   IsoCands& isoCands,
                                    const edm::Handle<edm::View<PCand> >& allCands) const
 {
-  // fill iso cand lists if needed
-  if(nIsoCands.size() == 0 && chIsoCands.size() == 0)
+  // get iso cands if needed
+  if(!isoCands.filled)
     {
-      for(size_t i = 0; i < allCands->size(); ++i)
+      for(const auto& cand : *allCands)
         {
-          if(nIsoSelection_(allCands->at(i)))
-            nIsoCands.push_back(allCands->refAt(i).castTo<PCandRef>());
-          else if(chIsoSelection_(allCands->at(i)))
-            chIsoCands.push_back(allCands->refAt(i).castTo<PCandRef>());
+          if(nIsoSelection_(cand))
+            isoCands.neutral.add(cand.eta(), cand.phi(), cand.pt());
+          else if(chIsoSelection_(cand))
+            isoCands.charged.add(cand.eta(), cand.phi(), cand.pt());
         }
+      isoCands.neutral.sort();
+      isoCands.charged.sort();
+      isoCands.filled = true;
     }
 
-  double iso = 0.;
-
-  for(auto& cand : nIsoCands)
-    {
-      double dR = reco::deltaR(pho->p4(), cand->p4());
-      if(dR < isoDR_ && dR > nIsoVetoDR_)
-        iso += cand->pt();
-    }
-
-  for(auto& cand : chIsoCands)
-    {
-      double dR = reco::deltaR(pho->p4(), cand->p4());
-      if(dR < isoDR_ && dR > chIsoVetoDR_)
-        iso += cand->pt();
-    }
+  double iso = (isoCands.neutral.sumPtInCone(pho->eta(), pho->phi(), isoDR_, nIsoVetoDR_) +
+                isoCands.charged.sumPtInCone(pho->eta(), pho->phi(), isoDR_, chIsoVetoDR_));
 
   return iso / pho->pt() < relIsoCut_;
 }
@@ -26,7 +26,8 @@
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/PatCandidates/interface/CompositeCandidate.h"
 #include "DataFormats/Candidate/interface/Candidate.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
 
 
 typedef reco::Candidate Cand;
@@ -34,6 +35,17 @@ typedef pat::CompositeCandidate CCand;
 typedef pat::CompositeCandidateRef CCandRef;
 
 
+namespace
+{
+  std::string tightLepCut(const edm::ParameterSet& iConfig)
+  {
+    return (iConfig.exists("tightLepCut") ?
+            iConfig.getParameter<std::string>("tightLepCut") :
+            std::string("userFloat(\"ZZIDPassTight\") > 0.5 && userFloat(\"ZZIsoPass\") > 0.5"));
+  }
+}
+
+
 class ZZCategoryEmbedder : public edm::stream::EDProducer<> 
 {
  public:
@@ -59,8 +71,9 @@ class ZZCategoryEmbedder : public edm::stream::EDProducer<>
   edm::EDGetTokenT<edm::View<pat::Electron> > electronToken;
   edm::EDGetTokenT<edm::View<pat::Muon> > muonToken;
 
-  // To select tight leptons
-  const StringCutObjectSelector<Cand, true> leptonSelector;
+  // To select tight leptons (same cut for both)
+  const uwvv::CompiledCutSelector<pat::Electron> electronSelector;
+  const uwvv::CompiledCutSelector<pat::Muon> muonSelector;
 
   // B discriminator to use
   const std::string bDiscrimLabel;
@@ -75,9 +88,8 @@ ZZCategoryEmbedder::ZZCategoryEmbedder(const edm::ParameterSet& iConfig) :
   jetToken(consumes<edm::View<pat::Jet> >(iConfig.getParameter<edm::InputTag>("jetSrc"))),
   electronToken(consumes<edm::View<pat::Electron> >(iConfig.getParameter<edm::InputTag>("electronSrc"))),
   muonToken(consumes<edm::View<pat::Muon> >(iConfig.getParameter<edm::InputTag>("muonSrc"))),
-  leptonSelector(iConfig.exists("tightLepCut") ?
-                 iConfig.getParameter<std::string>("tightLepCut") :
-                 std::string("userFloat(\"ZZIDPassTight\") > 0.5 && userFloat(\"ZZIsoPass\") > 0.5")),
+  electronSelector(tightLepCut(iConfig)),
+  muonSelector(tightLepCut(iConfig)),
   bDiscrimLabel(iConfig.exists("bDiscriminator") ?
                  iConfig.getParameter<std::string>("bDiscriminator") :
                  std::string("pfCombinedInclusiveSecondaryVertexV2BJetTags")),
@@ -99,7 +111,7 @@ void ZZCategoryEmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iSet
 
   for(size_t i = 0; i < elecs->size(); ++i)
     {
-      if(leptonSelector(elecs->at(i)))
+      if(electronSelector(elecs->at(i)))
         {
           if(elecs->at(i).charge() > 0)
             ++nep;
@@ -113,7 +125,7 @@ void ZZCategoryEmbedder::produce(edm::Event& iEvent, const edm::EventSetup& iSet
 
   for(size_t i = 0; i < mus->size(); ++i)
     {
-      if(leptonSelector(mus->at(i)))
+      if(muonSelector(mus->at(i)))
         {
           if(mus->at(i).charge() > 0)
             ++nmp;
@@ -3,20 +3,35 @@
 
 import FWCore.ParameterSet.Config as cms
 
-from UWVV.AnalysisTools.AnalysisStep import AnalysisStep
+from UWVV.AnalysisTools.AnalysisStep import AnalysisStep, nMergedModules
 
 from collections import OrderedDict
 
 
 
 class AnalysisFlowBase(object):
+    # Merge producers identical to ones already in the process (see
+    # AnalysisStep.makeSequence); off unless the flow is made with
+    # dedupModules=True
+    dedupModules = False
+
+    # Collections the cutflow counter skips: not candidates, or not worth
+    # counting
+    nonCutflowObjects = set(['v', 'pfCands'])
+
     def __init__(self, name, process=None, suffix='', *args, **initialInputs):
         '''
         Keyword arguments are interpreted as changes from the default
-        initial object input tags.
+        initial object input tags, except cutflow, which if True adds a
+        CutflowCounter counting the objects into and out of every module,
+        and dedupModules, which if True merges producers identical to ones
+        already in the process.
         '''
         self.name = name
         self.suffix = suffix
+        self.cutflow = initialInputs.pop('cutflow', False)
+        self.dedupModules = initialInputs.pop('dedupModules',
+                                              self.dedupModules)
 
         self.inputs = self.getInitialInputs(**initialInputs)
         self.outputs = []
@@ -93,16 +108,65 @@ class AnalysisFlowBase(object):
         return it
         '''
         p = cms.Path()
-        for stepName, step in self.steps.iteritems():
-            p *= step.makeSequence(self.process)
+        pathModules = set()
+        nMergedBefore = nMergedModules(self.process)
+        for iStep, (stepName, step) in enumerate(self.steps.iteritems()):
+            p *= step.makeSequence(self.process, pathModules,
+                                   self.dedupModules)
+            # the step's output tags may now point at merged modules
+            self.outputs[iStep] = step.outputs.copy()
+
+        nMerged = nMergedModules(self.process) - nMergedBefore
+        if nMerged:
+            print ("{}: merged {} module(s) into identical ones already in "
+                   "the process, {} left in the path").format(
+                self.name, nMerged, len(pathModules))
 
 
         self.process.schedule.append(p)
         setattr(self.process, self.name+'FlowPath', p)
 
+        if self.cutflow:
+            self.addCutflowCounter()
+
         return p
 
 
+    def addCutflowCounter(self, printTable=False):
+        '''
+        Add a CutflowCounter for every collection every module in the flow
+        makes or replaces. It goes in an EndPath so it sees every event,
+        including those a filter in the flow rejected.
+        '''
+        counters = []
+        for stepName, step in self.steps.iteritems():
+            for modName, obj, before, after in step.history:
+                if obj in self.nonCutflowObjects:
+                    continue
+                # the label of the module that really made it, which is
+                # not modName if that was merged into another module
+                counters.append(cms.PSet(
+                        step = cms.string(stepName),
+                        module = cms.string(after.split(':')[0]),
+                        object = cms.string(obj),
+                        input = cms.string(before),
+                        output = cms.string(after),
+                        ))
+
+        counter = cms.EDAnalyzer(
+            'CutflowCounter',
+            counters = cms.VPSet(*counters),
+            printTable = cms.bool(printTable),
+            )
+        setattr(self.process, self.name+'Cutflow', counter)
+
+        endPath = cms.EndPath(counter)
+        setattr(self.process, self.name+'CutflowPath', endPath)
+        self.process.schedule.append(endPath)
+
+        return counter
+
+
     def getProcess(self):
         return self.process
 
@@ -7,6 +7,8 @@ from FWCore.ParameterSet.SequenceTypes import _ModuleSequenceType
 from UWVV.Utilities.helpers import getObjTypes, getObjName
 
 from collections import OrderedDict
+from hashlib import sha1
+import weakref
 
 
 
@@ -21,6 +23,10 @@ class AnalysisStep(object):
         self.outputs = initialInputTags.copy()
 
         self.modules = OrderedDict()
+
+        # (module name, object, tag before, tag after) for every collection
+        # a module replaced or made, in order, for cutflow counting
+        self.history = []
     
 
     def getObjTag(self, obj):
@@ -50,6 +56,8 @@ class AnalysisStep(object):
         assert name not in self.modules, "Module {} already exists.".format(name)
         self.modules[name] = module
 
+        before = self.outputs.copy()
+
         if isinstance(module, _ModuleSequenceType):
             newTag = module._seq._collection[-1].__str__()
         else:
@@ -60,20 +68,68 @@ class AnalysisStep(object):
         for obj, suffix in tagSuffixes.iteritems():
             self.outputs[obj] = ':'.join([self.outputs[obj], suffix])
 
+        for obj in objectsOutput:
+            self.history.append((name, obj, before.get(obj, ''),
+                                 self.outputs[obj]))
 
-    def makeSequence(self, process):
+
+    def makeSequence(self, process, pathModules=None, dedup=False):
         '''
         Add all modules, and a Sequence that calls them, to the process, and
-        return the Sequence
+        return the Sequence.
+        If dedup is True, an EDProducer that is identical (same type,
+        parameters, and input tags after earlier merges) to one already
+        added to the process by any step is not added again. The existing
+        one is used in its place, and input tags and module labels in string
+        parameters of later modules, and the step's outputs, are pointed at
+        it. Filters, analyzers, and producers with a string parameter naming
+        another module are never merged. The merged module's label doesn't
+        exist in the process, so anything customized by label afterwards
+        won't find it. pathModules, if given, is the set of labels already
+        in the path this sequence will go in, so a merged module isn't put
+        in the same path twice; it is updated.
         '''
         seq = cms.Sequence()
         setattr(process, self.name+"Sequence", seq)
 
+        registry = _dedupRegistry(process)
+        if pathModules is None:
+            pathModules = set()
+
         for name, mod in self.modules.iteritems():
-            if not hasattr(process, name+self.suffix):
-                setattr(process, name+self.suffix, mod)
+            label = name+self.suffix
+
+            if dedup and isinstance(mod, (cms.EDProducer, cms.EDFilter,
+                                          cms.EDAnalyzer)):
+                _rewireInputTags(mod, registry.aliases)
+
+                if (isinstance(mod, cms.EDProducer) and
+                    not hasattr(process, label) and
+                    not _namesModules(mod, process)):
+                    signature = _moduleSignature(mod)
+                    original = registry.signatures.get(signature)
+                    if original is not None and original != label:
+                        registry.aliases[label] = original
+                        registry.nMerged += 1
+                        self.modules[name] = getattr(process, original)
+                        if original not in pathModules:
+                            seq *= getattr(process, original)
+                            pathModules.add(original)
+                        continue
+                    registry.signatures[signature] = label
+
+            if not hasattr(process, label):
+                setattr(process, label, mod)
             if not isinstance(mod, cms.ESSource):
                 seq *= mod
+                pathModules.add(label)
+
+        if dedup:
+            for obj, tag in self.outputs.iteritems():
+                self.outputs[obj] = _resolveTagString(tag, registry.aliases)
+            self.history = [(name, obj, _resolveTagString(before, registry.aliases),
+                             _resolveTagString(after, registry.aliases))
+                            for name, obj, before, after in self.history]
 
         return seq
 
@@ -153,3 +209,105 @@ class AnalysisStep(object):
 
         self.addModule(''.join([obj, name if name else 'crossCleaning', 
                                 self.name]).replace('_',''), mod, obj)
+
+
+
+class _DedupRegistry(object):
+    '''
+    Modules added to one process, by signature, and the labels of modules
+    that were merged into them
+    '''
+    def __init__(self):
+        self.signatures = {}
+        self.aliases = {}
+        self.nMerged = 0
+
+
+_registries = weakref.WeakKeyDictionary()
+
+def _dedupRegistry(process):
+    if process not in _registries:
+        _registries[process] = _DedupRegistry()
+    return _registries[process]
+
+
+def nMergedModules(process):
+    '''
+    Number of modules AnalysisStep.makeSequence has merged into identical
+    ones in this process so far
+    '''
+    return _dedupRegistry(process).nMerged
+
+
+def _moduleSignature(mod):
+    '''
+    Hash of the module's type and full configuration
+    '''
+    return sha1(mod.type_() + mod.dumpPython()).hexdigest()
+
+
+def _resolveTagString(tag, aliases):
+    parts = tag.split(':')
+    if parts[0] in aliases:
+        parts[0] = aliases[parts[0]]
+    return ':'.join(parts)
+
+
+def _namesModules(pset, process):
+    '''
+    True if any string parameter in pset (recursively) is the label of a
+    module in the process, e.g. a producer that reads another module's
+    output by name, which a merge could silently break
+    '''
+    for name in pset.parameterNames_():
+        param = getattr(pset, name)
+
+        if isinstance(param, cms.string):
+            if hasattr(process, param.value().split(':')[0]):
+                return True
+        elif isinstance(param, cms.vstring):
+            for v in param:
+                if hasattr(process, v.split(':')[0]):
+                    return True
+        elif isinstance(param, cms.PSet):
+            if _namesModules(param, process):
+                return True
+        elif isinstance(param, cms.VPSet):
+            for p in param:
+                if _namesModules(p, process):
+                    return True
+
+    return False
+
+
+def _rewireInputTags(pset, aliases):
+    '''
+    Point any input tag or module label string in pset (recursively) at a
+    merged module's replacement
+    '''
+    if not aliases:
+        return
+
+    for name in pset.parameterNames_():
+        param = getattr(pset, name)
+
+        if isinstance(param, cms.InputTag):
+            if param.getModuleLabel() in aliases:
+                param.setModuleLabel(aliases[param.getModuleLabel()])
+        elif isinstance(param, cms.VInputTag):
+            for i, tag in enumerate(param):
+                if isinstance(tag, cms.InputTag):
+                    if tag.getModuleLabel() in aliases:
+                        tag.setModuleLabel(aliases[tag.getModuleLabel()])
+                else:
+                    param[i] = _resolveTagString(tag, aliases)
+        elif isinstance(param, cms.string):
+            param.setValue(_resolveTagString(param.value(), aliases))
+        elif isinstance(param, cms.vstring):
+            for i, v in enumerate(param):
+                param[i] = _resolveTagString(v, aliases)
+        elif isinstance(param, cms.PSet):
+            _rewireInputTags(param, aliases)
+        elif isinstance(param, cms.VPSet):
+            for p in param:
+                _rewireInputTags(p, aliases)
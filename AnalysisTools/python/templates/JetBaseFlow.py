@@ -3,6 +3,8 @@ from UWVV.AnalysisTools.AnalysisFlowBase import AnalysisFlowBase
 import FWCore.ParameterSet.Config as cms
 from PhysicsTools.PatAlgos.tools.jetTools import updateJetCollection
 
+from UWVV.Utilities.helpers import jetVariationLabel
+
 class JetBaseFlow(AnalysisFlowBase):
     def __init__(self, *args, **kwargs):
         if not hasattr(self, 'isMC'):
@@ -50,13 +52,13 @@ class JetBaseFlow(AnalysisFlowBase):
                            'j')
 
             if self.isMC:
-                # shift corrections up and down for systematics
+                # embed factors to shift the energy scale up and down for
+                # systematics (the jets themselves are unchanged)
                 jesShifts = cms.EDProducer(
                     "PATJetEnergyScaleShifter",
                     src = step.getObjTag('j'),
                     )
-                step.addModule('jesShifts', jesShifts, 'j_jesUp', 'j_jesDown',
-                               j_jesUp='jesUp', j_jesDown='jesDown')
+                step.addModule('jesShifts', jesShifts, 'j')
 
             jetIDEmbedding = cms.EDProducer(
                 "PATJetIDEmbedder",
@@ -65,62 +67,16 @@ class JetBaseFlow(AnalysisFlowBase):
             step.addModule('jetIDEmbedding', jetIDEmbedding, 'j')
 
             if self.isMC:
-                jetIDEmbedding_jesUp = cms.EDProducer(
-                    "PATJetIDEmbedder",
-                    src = step.getObjTag('j_jesUp'),
-                    )
-                step.addModule('jetIDEmbeddingJESUp', jetIDEmbedding_jesUp, 'j_jesUp')
-                jetIDEmbedding_jesDown = cms.EDProducer(
-                    "PATJetIDEmbedder",
-                    src = step.getObjTag('j_jesDown'),
-                    )
-                step.addModule('jetIDEmbeddingJESDown', jetIDEmbedding_jesDown, 'j_jesDown')
-
-
+                # smears the nominal jets, stores the JER up/down factors
+                # and re-derives the JES factors for smeared jets
                 jetSmearing = cms.EDProducer(
                     "PATJetSmearing",
                     src = step.getObjTag('j'),
                     rhoSrc = cms.InputTag("fixedGridRhoFastjetAll"),
                     systematics = cms.bool(True),
+                    scaledVariations = cms.vstring('jesUp', 'jesDown'),
                     )
-                step.addModule("jetSmearing", jetSmearing, 'j', 'j_jerUp',
-                               'j_jerDown', j_jerUp='jerUp', j_jerDown='jerDown')
-
-                jetSmearing_jesUp = jetSmearing.clone(src = step.getObjTag('j_jesUp'),
-                                                      systematics = cms.bool(False))
-                step.addModule("jetSmearingJESUp", jetSmearing_jesUp, 'j_jesUp')
-                jetSmearing_jesDown = jetSmearing.clone(src = step.getObjTag('j_jesDown'),
-                                                      systematics = cms.bool(False))
-                step.addModule("jetSmearingJESDown", jetSmearing_jesDown, 'j_jesDown')
-
-                # need to re-sort now that we're calibrated
-                jSort_jesUp = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jesUp'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJESUp', jSort_jesUp, 'j_jesUp')
-
-                jSort_jesDn = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jesDown'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJESDn', jSort_jesDn, 'j_jesDown')
-
-                jSort_jerUp = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jerUp'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJERUp', jSort_jerUp, 'j_jerUp')
-
-                jSort_jerDn = cms.EDProducer(
-                    "PATJetCollectionSorter",
-                    src = step.getObjTag('j_jerDown'),
-                    function = cms.string('pt'),
-                    )
-                step.addModule('jetSortingJERDn', jSort_jerDn, 'j_jerDown')
+                step.addModule("jetSmearing", jetSmearing, 'j')
 
             # need to re-sort now that we're calibrated
             jSort = cms.EDProducer(
@@ -133,8 +89,9 @@ class JetBaseFlow(AnalysisFlowBase):
         if stepName == 'preselection':
             # For now, we're not using the PU ID, but we'll store it in the
             # ntuples later
-            selectionString = ('pt > 30. && abs(eta) < 4.7 && '
-                               'userFloat("idLoose") > 0.5')
+            ptCut = 'pt > {}'.format(self.jetPtCut())
+            otherCuts = 'abs(eta) < 4.7 && userFloat("idLoose") > 0.5'
+            selectionString = ' && '.join([ptCut, otherCuts])
 
             # # use medium PU ID
             # # PU IDs are stored as a userInt where the first three digits are
@@ -143,17 +100,31 @@ class JetBaseFlow(AnalysisFlowBase):
             #                    'userFloat("idLoose") > 0.5 && '
             #                    'userInt("{}") >= 6').format(step.getObjTagString('puID'))
 
-            step.addBasicSelector('j', selectionString)
             if self.isMC:
-                step.addBasicSelector('j_jesUp', selectionString)
-                step.addBasicSelector('j_jesDown', selectionString)
-                step.addBasicSelector('j_jerUp', selectionString)
-                step.addBasicSelector('j_jerDown', selectionString)
-
-        return step
+                # Systematic variations are scale factors stored in the
+                # nominal jets, so j_syst is all jets that pass the
+                # selection for any variation. Must come before the nominal
+                # selection, which replaces j.
+                anyPtCut = ' || '.join([ptCut] +
+                                       ['pt * userFloat("{}") > {}'.format(jetVariationLabel(v),
+                                                                           self.jetPtCut())
+                                        for v in self.jetVariations()])
+                step.addBasicSelector('j', '({}) && {}'.format(anyPtCut, otherCuts),
+                                      newCollection='syst')
 
+            step.addBasicSelector('j', selectionString)
 
+        return step
 
 
+    def jetPtCut(self):
+        return 30.
 
 
+    def jetVariations(self):
+        '''
+        Systematic variations stored in the jets (as p4 scale factors) for MC
+        '''
+        if not self.isMC:
+            return []
+        return ['jesUp', 'jesDown', 'jerUp', 'jerDown']
@@ -27,11 +27,9 @@ class ZPlusXInitialStateBaseFlow(ZPlusXBaseFlow):
         '''
         for chan in parseChannels('zl'):
             mod = cms.EDProducer(
-                'PATCandViewShallowCloneCombiner',
-                decay = cms.string('{0} {1}'.format(step.getObjTagString('ee' if chan.count('e') > 1 else 'mm'),
-                                                    step.getObjTagString('e' if chan.count('e') in [1,3] else 'm'))),
-                cut = cms.string(""),
-                checkCharge = cms.bool(False),
+                'MultiLeptonCandidateBuilder3L',
+                src1 = step.getObjTag('ee' if chan.count('e') > 1 else 'mm'),
+                src2 = step.getObjTag('e' if chan.count('e') in [1,3] else 'm'),
                 setPdgId = cms.int32(25),
                 )
             
@@ -62,10 +60,9 @@ class ZPlusXInitialStateBaseFlow(ZPlusXBaseFlow):
                     'CleanedJetCollectionEmbedder',
                     src = step.getObjTag(chan),
                     jetSrc = step.getObjTag('j'),
-                    jesUpJetSrc = step.getObjTag('j_jesUp'),
-                    jesDownJetSrc = step.getObjTag('j_jesDown'),
-                    jerUpJetSrc = step.getObjTag('j_jerUp'),
-                    jerDownJetSrc = step.getObjTag('j_jerDown'),
+                    systJetSrc = step.getObjTag('j_syst'),
+                    variations = cms.vstring(*self.jetVariations()),
+                    variationPtCut = cms.double(self.jetPtCut()),
                 )
             except KeyError:
                 mod = cms.EDProducer(
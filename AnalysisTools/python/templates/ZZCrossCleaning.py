@@ -41,56 +41,9 @@ class ZZCrossCleaning(AnalysisFlowBase):
                 )
 
             if self.isMC:
+                # jets for systematic variations (all in one collection)
                 step.addCrossSelector(
-                    'j_jesUp',
-                    '', # no further basic selection here
-                    e={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    m={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    )
-                step.addCrossSelector(
-                    'j_jesDown',
-                    '', # no further basic selection here
-                    e={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    m={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    )
-                step.addCrossSelector(
-                    'j_jerUp',
-                    '', # no further basic selection here
-                    e={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    m={
-                        'deltaR' : 0.4,
-                        'selection' : ('userFloat("{}Tight") > 0.5 && '
-                                       'userFloat("{}") > 0.5').format(self.getZZIDLabel(),
-                                                                       self.getZZIsoLabel()),
-                        },
-                    )
-                step.addCrossSelector(
-                    'j_jerDown',
+                    'j_syst',
                     '', # no further basic selection here
                     e={
                         'deltaR' : 0.4,
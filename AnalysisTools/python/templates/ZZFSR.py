@@ -49,14 +49,8 @@ class ZZFSR(AnalysisFlowBase):
             step.addModule('jetFSRCleaner', jetFSRCleaner, 'j')
             
             if self.isMC:
-                jetFSRCleaner_jesUp = jetFSRCleaner.clone(src = step.getObjTag('j_jesUp'))
-                step.addModule('jetFSRCleanerJESUp', jetFSRCleaner_jesUp, 'j_jesUp')
-                jetFSRCleaner_jesDown = jetFSRCleaner.clone(src = step.getObjTag('j_jesDown'))
-                step.addModule('jetFSRCleanerJESDown', jetFSRCleaner_jesDown, 'j_jesDown')
-                jetFSRCleaner_jerUp = jetFSRCleaner.clone(src = step.getObjTag('j_jerUp'))
-                step.addModule('jetFSRCleanerJERUp', jetFSRCleaner_jerUp, 'j_jerUp')
-                jetFSRCleaner_jerDown = jetFSRCleaner.clone(src = step.getObjTag('j_jerDown'))
-                step.addModule('jetFSRCleanerJERDown', jetFSRCleaner_jerDown, 'j_jerDown')
+                jetFSRCleaner_syst = jetFSRCleaner.clone(src = step.getObjTag('j_syst'))
+                step.addModule('jetFSRCleanerSyst', jetFSRCleaner_syst, 'j_syst')
 
         if stepName == 'intermediateStateEmbedding':
             if isinstance(self, ZPlusXBaseFlow):
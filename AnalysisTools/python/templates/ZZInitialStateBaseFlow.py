@@ -29,19 +29,27 @@ class ZZInitialStateBaseFlow(ZPlusXBaseFlow):
             z1Name = 'z{}1'.format(chan[0])
             z2Name = 'z{}{}'.format(chan[2], 2 if chan[0] == chan[2] else 1)
             mod = cms.EDProducer(
-                'PATCandViewShallowCloneCombiner',
-                decay = cms.string('{0} {1}'.format(step.getObjTagString(chan[:2]),
-                                                    step.getObjTagString(chan[2:]))),
+                'MultiLeptonCandidateBuilder4L',
+                src1 = step.getObjTag(chan[:2]),
+                src2 = step.getObjTag(chan[2:]),
                 roles = cms.vstring(z1Name, z2Name),
-                cut = cms.string(('daughter("{}").masterClone.mass < 150. && '
-                                  'daughter("{}").masterClone.mass < 150.').format(z1Name, z2Name)),
-                checkCharge = cms.bool(False),
                 setPdgId = cms.int32(25),
+                **self.getZZCreationCuts()
                 )
             
             step.addModule(chan+'Producer', mod, chan)
 
 
+    def getZZCreationCuts(self):
+        '''
+        Cuts the 4l builder applies before making any candidates. Flows that
+        cut harder later on can add to this so fewer candidates get made.
+        '''
+        return {
+            'zMassMax' : cms.double(150.),
+            }
+
+
     def addAlternatePairInfo(self, step):
         '''
         Add modules to embed alternate lepton pair (e.g. e1+m1) info.
@@ -66,10 +74,9 @@ class ZZInitialStateBaseFlow(ZPlusXBaseFlow):
                     'CleanedJetCollectionEmbedder',
                     src = step.getObjTag(chan),
                     jetSrc = step.getObjTag('j'),
-                    jesUpJetSrc = step.getObjTag('j_jesUp'),
-                    jesDownJetSrc = step.getObjTag('j_jesDown'),
-                    jerUpJetSrc = step.getObjTag('j_jerUp'),
-                    jerDownJetSrc = step.getObjTag('j_jerDown'),
+                    systJetSrc = step.getObjTag('j_syst'),
+                    variations = cms.vstring(*self.jetVariations()),
+                    variationPtCut = cms.double(self.jetPtCut()),
                 )
             except KeyError:
                 mod = cms.EDProducer(
@@ -30,3 +30,12 @@ class ZZSkim(AnalysisFlowBase):
         return step
 
 
+    def getZZCreationCuts(self):
+        '''
+        Apply the Z1 mass cut when the 4l candidates are built, so the ones
+        that fail never go through the initial state embedding. The selector
+        above stays as a safety net.
+        '''
+        cuts = super(ZZSkim, self).getZZCreationCuts()
+        cuts['leadingZMassMin'] = cms.double(40.)
+        return cuts
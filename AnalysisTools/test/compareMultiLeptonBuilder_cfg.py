@@ -0,0 +1,135 @@
+import FWCore.ParameterSet.Config as cms
+import FWCore.ParameterSet.VarParsing as VarParsing
+
+from UWVV.AnalysisTools.analysisFlowMaker import createFlow
+from UWVV.Utilities.helpers import parseChannels
+
+################################################################################
+#   Checks that MultiLeptonCandidateBuilder makes exactly the same 4l and 3l   #
+#   candidates as the generic PATCandViewShallowCloneCombiner + string cut     #
+#   chain it replaced. The job fails if any event differs.                     #
+#       cmsRun compareMultiLeptonBuilder_cfg.py maxEvents=1000 [inputFiles=...]#
+################################################################################
+
+process = cms.Process("COMPARE")
+
+options = VarParsing.VarParsing('analysis')
+
+options.inputFiles = '/store/mc/RunIIFall15MiniAODv2/GluGluHToZZTo4L_M2500_13TeV_powheg2_JHUgenV6_pythia8/MINIAODSIM/PU25nsData2015v1_76X_mcRun2_asymptotic_v12-v1/60000/02C0EC1D-F3E4-E511-ADCA-AC162DA603B4.root'
+options.maxEvents = 1000
+
+options.register('isMC', 1,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "1 if simulation, 0 if data")
+
+options.parseArguments()
+
+process.load("Configuration.StandardSequences.GeometryRecoDB_cff")
+process.load("Configuration.StandardSequences.FrontierConditions_GlobalTag_cff")
+from Configuration.AlCa.GlobalTag import GlobalTag
+process.GlobalTag = GlobalTag(process.GlobalTag,
+                              'auto:run2_mc' if options.isMC else 'auto:run2_data')
+
+process.load("FWCore.MessageLogger.MessageLogger_cfi")
+process.MessageLogger.cerr.FwkReport.reportEvery = 100
+process.schedule = cms.Schedule()
+
+process.source = cms.Source(
+    "PoolSource",
+    fileNames = cms.untracked.vstring(options.inputFiles),
+    )
+
+process.maxEvents = cms.untracked.PSet(
+    input=cms.untracked.int32(options.maxEvents)
+    )
+
+
+FlowSteps = []
+
+from UWVV.AnalysisTools.templates.VertexCleaning import VertexCleaning
+FlowSteps.append(VertexCleaning)
+from UWVV.AnalysisTools.templates.ElectronBaseFlow import ElectronBaseFlow
+FlowSteps.append(ElectronBaseFlow)
+from UWVV.AnalysisTools.templates.MuonBaseFlow import MuonBaseFlow
+FlowSteps.append(MuonBaseFlow)
+from UWVV.AnalysisTools.templates.RecomputeElectronID import RecomputeElectronID
+FlowSteps.append(RecomputeElectronID)
+from UWVV.AnalysisTools.templates.JetBaseFlow import JetBaseFlow
+FlowSteps.append(JetBaseFlow)
+from UWVV.AnalysisTools.templates.ZZFlow import ZZFlow
+FlowSteps.append(ZZFlow)
+from UWVV.AnalysisTools.templates.ZZInitialStateBaseFlow import ZZInitialStateBaseFlow
+FlowSteps.append(ZZInitialStateBaseFlow)
+
+FlowClass = createFlow(*FlowSteps)
+flow = FlowClass('flow', process, initialstate_chans=parseChannels('zz'),
+                 isMC=bool(options.isMC))
+
+# Everything below works on the Zs and leptons the flow's 4l builders use
+creation = flow.steps['initialStateCreation']
+zzInputs = creation.inputs
+
+process.compareSequence = cms.Sequence()
+
+for chan in parseChannels('zz'):
+    z1Name = 'z{}1'.format(chan[0])
+    z2Name = 'z{}{}'.format(chan[2], 2 if chan[0] == chan[2] else 1)
+
+    ref = cms.EDProducer(
+        'PATCandViewShallowCloneCombiner',
+        decay = cms.string('{0} {1}'.format(zzInputs[chan[:2]], zzInputs[chan[2:]])),
+        roles = cms.vstring(z1Name, z2Name),
+        cut = cms.string(('daughter("{}").masterClone.mass < 150. && '
+                          'daughter("{}").masterClone.mass < 150.').format(z1Name, z2Name)),
+        checkCharge = cms.bool(False),
+        setPdgId = cms.int32(25),
+        )
+    setattr(process, chan+'Reference', ref)
+
+    cmp = cms.EDAnalyzer(
+        'CandidateCollectionComparator',
+        src1 = cms.InputTag(chan+'Reference'),
+        src2 = creation.getObjTag(chan),
+        )
+    setattr(process, chan+'Compare', cmp)
+
+    process.compareSequence += ref
+    process.compareSequence += cmp
+
+# 3l candidates from the same inputs
+for chan in parseChannels('zl'):
+    zTag = zzInputs['ee' if chan.count('e') > 1 else 'mm']
+    lTag = zzInputs['e' if chan.count('e') in [1,3] else 'm']
+
+    ref = cms.EDProducer(
+        'PATCandViewShallowCloneCombiner',
+        decay = cms.string('{0} {1}'.format(zTag, lTag)),
+        cut = cms.string(""),
+        checkCharge = cms.bool(False),
+        setPdgId = cms.int32(25),
+        )
+    setattr(process, chan+'Reference', ref)
+
+    new = cms.EDProducer(
+        'MultiLeptonCandidateBuilder3L',
+        src1 = cms.InputTag(zTag),
+        src2 = cms.InputTag(lTag),
+        setPdgId = cms.int32(25),
+        )
+    setattr(process, chan+'Builder', new)
+
+    cmp = cms.EDAnalyzer(
+        'CandidateCollectionComparator',
+        src1 = cms.InputTag(chan+'Reference'),
+        src2 = cms.InputTag(chan+'Builder'),
+        )
+    setattr(process, chan+'Compare', cmp)
+
+    process.compareSequence += ref
+    process.compareSequence += new
+    process.compareSequence += cmp
+
+p = flow.getPath()
+p += process.compareSequence
+process.schedule.append(p)
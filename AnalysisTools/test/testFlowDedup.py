@@ -0,0 +1,129 @@
+'''
+Check which modules a flow made with dedupModules=True merges: identical
+producers are merged and everything that used them is pointed at the one
+that's kept, while filters, producers that name other modules in string
+parameters, and flows made without dedupModules are left alone.
+
+Run with python in a CMSSW environment (or through scram b runtests).
+'''
+
+import FWCore.ParameterSet.Config as cms
+
+from UWVV.AnalysisTools.AnalysisFlowBase import AnalysisFlowBase
+
+import unittest
+
+
+
+def _copier(step):
+    return cms.EDProducer(
+        'PATElectronCopier',
+        src = step.getObjTag('e'),
+        minPt = cms.double(5.),
+        )
+
+def _selector(step):
+    return cms.EDFilter(
+        'PATElectronRefSelector',
+        src = step.getObjTag('e'),
+        cut = cms.string('pt > 7'),
+        filter = cms.bool(False),
+        )
+
+def _namer(step):
+    return cms.EDProducer(
+        'PATElectronUserDataEmbedder',
+        src = step.getObjTag('e'),
+        helperModule = cms.string('eCopyPreselection'),
+        )
+
+
+class DuplicatingFlow(AnalysisFlowBase):
+    '''
+    Adds the same modules in the preselection and embedding steps. The
+    electrons are never replaced, so the copies really are identical.
+    '''
+    def makeAnalysisStep(self, stepName, **inputs):
+        step = super(DuplicatingFlow, self).makeAnalysisStep(stepName, **inputs)
+
+        if stepName in ('preselection', 'embedding'):
+            suffix = stepName.capitalize()
+            step.addModule('eCopy'+suffix, _copier(step),
+                           'eCopy'+suffix)
+            step.addModule('eSelect'+suffix, _selector(step),
+                           'eSelect'+suffix)
+            step.addModule('eNamer'+suffix, _namer(step),
+                           'eNamer'+suffix)
+
+        if stepName == 'embedding':
+            user = cms.EDProducer(
+                'PATElectronUserDataEmbedder',
+                src = step.getObjTag('eCopyEmbedding'),
+                helperModule = cms.string('eCopyEmbedding'),
+                )
+            step.addModule('eCopyUser', user, 'eCopyUser')
+
+        return step
+
+
+
+class TestFlowDedup(unittest.TestCase):
+    def makeFlow(self, **kwargs):
+        process = cms.Process('TEST')
+        process.schedule = cms.Schedule()
+        return DuplicatingFlow('flow', process, **kwargs)
+
+
+    def testIdenticalProducersMerged(self):
+        flow = self.makeFlow(dedupModules=True)
+        pathModules = flow.getPath().moduleNames()
+
+        self.assertIn('eCopyPreselection', pathModules)
+        self.assertNotIn('eCopyEmbedding', pathModules)
+        self.assertFalse(hasattr(flow.process, 'eCopyEmbedding'))
+        self.assertEqual(flow.finalObjTagString('eCopyEmbedding'),
+                         'eCopyPreselection')
+
+
+    def testUsersRewired(self):
+        flow = self.makeFlow(dedupModules=True)
+        user = flow.process.eCopyUser
+
+        self.assertEqual(user.src.getModuleLabel(), 'eCopyPreselection')
+        self.assertEqual(user.helperModule.value(), 'eCopyPreselection')
+
+
+    def testFiltersAndNamersKept(self):
+        flow = self.makeFlow(dedupModules=True)
+        pathModules = flow.getPath().moduleNames()
+
+        for label in ('eSelectPreselection', 'eSelectEmbedding',
+                      'eNamerPreselection', 'eNamerEmbedding'):
+            self.assertIn(label, pathModules)
+
+
+    def testCutflowNamesKeptModule(self):
+        flow = self.makeFlow(dedupModules=True, cutflow=True)
+        modules = dict((c.object.value(), c.module.value())
+                       for c in flow.process.flowCutflow.counters)
+
+        self.assertEqual(modules['eCopyEmbedding'], 'eCopyPreselection')
+        self.assertEqual(modules['eCopyUser'], 'eCopyUser')
+
+
+    def testOffByDefault(self):
+        flow = self.makeFlow()
+        pathModules = flow.getPath().moduleNames()
+
+        for label in ('eCopyPreselection', 'eCopyEmbedding',
+                      'eSelectPreselection', 'eSelectEmbedding',
+                      'eNamerPreselection', 'eNamerEmbedding',
+                      'eCopyUser'):
+            self.assertIn(label, pathModules)
+        self.assertEqual(flow.process.eCopyUser.src.getModuleLabel(),
+                         'eCopyEmbedding')
+
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,43 @@
+#ifndef DaughterPairKinematics_h
+#define DaughterPairKinematics_h
+
+#include <string>
+#include <vector>
+
+// Di-object quantities for every pair of final state objects in a
+// multi-object candidate (e.g. e1+m2 in a 2e2mu candidate), stored as
+// upper-triangle arrays with one entry per pair so they can be embedded as a
+// single userData instead of dozens of named userFloats.
+class DaughterPairKinematics {
+    public:
+        DaughterPairKinematics() {}
+        DaughterPairKinematics(const std::vector<std::string>& names);
+        virtual ~DaughterPairKinematics() {}
+
+        size_t nObjects() const {return names_.size();}
+        const std::vector<std::string>& names() const {return names_;}
+
+        // Position of the object with this name, or -1 if there isn't one
+        int index(const std::string& name) const;
+
+        // Position of pair (i, j) in the triangle arrays, in either order
+        size_t pairIndex(size_t i, size_t j) const;
+
+        void setPair(size_t i, size_t j, float mass, float massNoFSR,
+                     float deltaR);
+        void setCharge(size_t i, int charge) {charges_.at(i) = charge;}
+
+        float mass(size_t i, size_t j) const {return masses_.at(pairIndex(i,j));}
+        float massNoFSR(size_t i, size_t j) const {return massesNoFSR_.at(pairIndex(i,j));}
+        float deltaR(size_t i, size_t j) const {return deltaRs_.at(pairIndex(i,j));}
+        bool sameSign(size_t i, size_t j) const {return charges_.at(i) == charges_.at(j);}
+
+    private:
+        std::vector<std::string> names_;
+        std::vector<int> charges_;
+        std::vector<float> masses_;
+        std::vector<float> massesNoFSR_;
+        std::vector<float> deltaRs_;
+};
+
+#endif
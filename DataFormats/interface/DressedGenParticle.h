@@ -15,6 +15,9 @@ class DressedGenParticle : public reco::GenParticle {
         DressedGenParticle(const reco::GenParticle & cand, 
             //const reco::GenParticleRefVector associates, float dRmax);
             const reco::GenParticleCollection associates, float dRmax);
+        // Dress with all of the given particles (already matched to cand)
+        DressedGenParticle(const reco::GenParticle & cand,
+            const reco::GenParticleCollection & matchedAssociates);
         DressedGenParticle(Charge q, const LorentzVector & p4, const Point & vtx, 
             int pdgId, int status, bool integerCharge);
         DressedGenParticle(Charge q, const PolarLorentzVector & p4, const Point & vtx, 
@@ -0,0 +1,39 @@
+#include "UWVV/DataFormats/interface/DaughterPairKinematics.h"
+
+#include <algorithm>
+
+
+DaughterPairKinematics::DaughterPairKinematics(const std::vector<std::string>& names) :
+    names_(names),
+    charges_(names.size(), 0),
+    masses_(names.size() * (names.size() - 1) / 2, -999.),
+    massesNoFSR_(names.size() * (names.size() - 1) / 2, -999.),
+    deltaRs_(names.size() * (names.size() - 1) / 2, -999.)
+{
+}
+
+int DaughterPairKinematics::index(const std::string& name) const
+{
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == name)
+            return i;
+    }
+    return -1;
+}
+
+size_t DaughterPairKinematics::pairIndex(size_t i, size_t j) const
+{
+    if (j < i)
+        std::swap(i, j);
+    // pairs (0,1), (0,2), ..., (0,n-1), (1,2), ...
+    return i * (2 * names_.size() - i - 1) / 2 + (j - i - 1);
+}
+
+void DaughterPairKinematics::setPair(size_t i, size_t j, float mass,
+                                     float massNoFSR, float deltaR)
+{
+    size_t k = pairIndex(i, j);
+    masses_.at(k) = mass;
+    massesNoFSR_.at(k) = massNoFSR;
+    deltaRs_.at(k) = deltaR;
+}
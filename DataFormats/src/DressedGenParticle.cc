@@ -31,6 +31,12 @@ DressedGenParticle::DressedGenParticle(const reco::GenParticle& cand,
         }
     }
 }
+DressedGenParticle::DressedGenParticle(const reco::GenParticle& cand, 
+    const reco::GenParticleCollection& matchedAssociates) :
+        reco::GenParticle(cand), associates(matchedAssociates),
+        p4_undressed(cand.p4()) {
+    dressParticle();
+}
 DressedGenParticle* DressedGenParticle::clone() const {
     return new DressedGenParticle( * this );
 }
@@ -1,5 +1,6 @@
 #include "UWVV/DataFormats/interface/DressedGenParticleFwd.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
+#include "UWVV/DataFormats/interface/DaughterPairKinematics.h"
 
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
@@ -17,5 +18,8 @@ namespace {
 
         edm::PtrVector<pat::Jet> dummyPtrVectorPatJet;
         pat::UserHolder<edm::PtrVector<pat::Jet>> dummyPtrUserHolderPtrVectorPatJet; 
+
+        DaughterPairKinematics dummyPairKinematics;
+        pat::UserHolder<DaughterPairKinematics> dummyUserHolderPairKinematics;
     };
 }
@@ -44,9 +44,17 @@ namespace uwvv
 
     const std::string& getName() const {return name;}
 
+    // Everything these branches (and their daughters' branches) read
+    // from the event through EventInfo
+    const EventProducts& eventProductsUsed() const {return productsUsed;}
+
+    size_t nBranches() const;
+
    protected:
     edm::Ptr<T> extractMasterPtr(const reco::Candidate* const);
 
+    EventProducts productsUsed;
+
    private:
     template<typename B> void
       addBranchesFromPSet(std::vector<std::unique_ptr<BranchHolder<B, T> > >& addTo,
@@ -84,6 +92,9 @@ namespace uwvv
     void fill(const reco::Candidate* const obj, EventInfo& evt);
     void fill(const edm::Ptr<pat::CompositeCandidate> & obj, EventInfo& evt);
 
+    // Including the daughters' branches
+    size_t nBranches() const;
+
    private:
     const std::string& extractDaughterName(const size_t i,
                                            const std::vector<std::string>& names) const;
@@ -155,9 +166,13 @@ namespace uwvv
     FunctionLibrary<B,T> fLib = FunctionLibrary<B,T>();
 
     for(const auto& b : toAdd.getParameterNames())
-      addTo.push_back(std::unique_ptr<BranchHolder<B, T> >(new BranchHolder<B, T>(getName()+b,
-                                                                                  tree,
-                                                                                  fLib.getFunction(toAdd.getParameter<std::string>(b)))));
+      {
+        const std::string f = toAdd.getParameter<std::string>(b);
+        fLib.addProductsUsed(f, productsUsed);
+        addTo.push_back(std::unique_ptr<BranchHolder<B, T> >(new BranchHolder<B, T>(getName()+b,
+                                                                                    tree,
+                                                                                    fLib.getFunction(f))));
+      }
   }
 
 
@@ -170,9 +185,13 @@ namespace uwvv
     FunctionLibrary<std::vector<B>,T> fLib = FunctionLibrary<std::vector<B>,T>();
 
     for(const auto& b : toAdd.getParameterNames())
-      addTo.push_back(std::unique_ptr<BranchHolder<std::vector<B>, T> >(new BranchHolder<std::vector<B>, T>(getName()+b,
-                                                                                                            tree,
-                                                                                                            fLib.getFunction(toAdd.getParameter<std::vector<std::string> >(b)))));
+      {
+        const std::vector<std::string> fs = toAdd.getParameter<std::vector<std::string> >(b);
+        fLib.addProductsUsed(fs, productsUsed);
+        addTo.push_back(std::unique_ptr<BranchHolder<std::vector<B>, T> >(new BranchHolder<std::vector<B>, T>(getName()+b,
+                                                                                                              tree,
+                                                                                                              fLib.getFunction(fs))));
+      }
   }
 
 
@@ -215,6 +234,15 @@ namespace uwvv
   }
 
 
+  template<class T> size_t
+  BranchManager<T>::nBranches() const
+  {
+    return (floatBranches.size() + boolBranches.size() + intBranches.size() +
+            uintBranches.size() + ullBranches.size() + vFloatBranches.size() +
+            vIntBranches.size() + vUIntBranches.size());
+  }
+
+
   template<class T>
   edm::Ptr<T> BranchManager<T>::extractMasterPtr(const reco::Candidate* const obj)
   {
@@ -253,6 +281,9 @@ namespace uwvv
       std::unique_ptr<BranchManager<T2> >(new BranchManager<T2>(daughterName2,
                                                                 tree,
                                                                 daughterParams.at(1)));
+
+    productsUsed.add(daughterBranches1->eventProductsUsed());
+    productsUsed.add(daughterBranches2->eventProductsUsed());
   }
 
 
@@ -309,6 +340,15 @@ namespace uwvv
   }
 
 
+  template<>
+  template<class T1, class T2> size_t
+  BranchManager<CompositeDaughter<T1, T2> >::nBranches() const
+  {
+    return (BranchManager<pat::CompositeCandidate>::nBranches() +
+            daughterBranches1->nBranches() + daughterBranches2->nBranches());
+  }
+
+
   // Most things don't need to be reordered
   template<>
   template<class T1, class T2> bool
@@ -1,6 +1,12 @@
 #ifndef UWVV_Ntuplizer_EventInfo_h
 #define UWVV_Ntuplizer_EventInfo_h
 
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+
 #include "FWCore/Framework/interface/ConsumesCollector.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/Frameworkfwd.h"
@@ -23,17 +29,66 @@
 #include "SimDataFormats/GeneratorProducts/interface/LHEEventProduct.h"
 #include "DataFormats/JetReco/interface/GenJet.h"
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/Utilities/interface/InputTag.h"
 
 
 
 namespace uwvv
 {
 
+  // The event products something (usually a set of ntuple branches) reads
+  // through EventInfo. Only these are consumed, so nothing upstream has to
+  // run for a product no branch looks at. A collection name of "" means the
+  // primary (xxxSrc) tag, anything else is the name in the xxxExtra PSet.
+  class EventProducts
+  {
+   public:
+    enum Type {Vertices, Electrons, Muons, Taus, Photons, Jets, PFCands,
+               METs, PUInfo, GenEventInfo, LHEEventInfo, GenJets,
+               GenParticles, InitialStates, GenInitialStates, nTypes};
+
+    EventProducts() : all_(false) {;}
+    ~EventProducts() {;}
+
+    // Every configured tag, for users that don't know what they need
+    static EventProducts everything()
+    {
+      EventProducts out;
+      out.all_ = true;
+      return out;
+    }
+
+    void add(Type type, const std::string& collection = "")
+    {
+      needed_[type].insert(collection);
+    }
+    void add(const EventProducts& other)
+    {
+      all_ = all_ || other.all_;
+      for(size_t i = 0; i < nTypes; ++i)
+        needed_[i].insert(other.needed_[i].begin(), other.needed_[i].end());
+    }
+
+    bool needs(Type type, const std::string& collection) const
+    {
+      return all_ || needed_[type].count(collection);
+    }
+
+   private:
+    bool all_;
+    std::set<std::string> needed_[nTypes];
+  };
+
+
   template<class T> class EventDatum
   {
    public:
-    EventDatum(edm::ConsumesCollector& cc, const edm::InputTag& tag) :
-      token_(cc.consumes<T>(tag)),
+    EventDatum(edm::ConsumesCollector& cc, const edm::InputTag& tag,
+               bool needed) :
+      tag_(tag),
+      token_(needed ? cc.consumes<T>(tag) : edm::EDGetTokenT<T>()),
+      consumed_(needed),
       isValid_(false)
         {;}
     ~EventDatum() {;}
@@ -49,13 +104,25 @@ namespace uwvv
       if(isValid_)
         return handle_;
 
+      if(!consumed_)
+        throw cms::Exception("ProductNotConsumed")
+          << "Something asked EventInfo for " << tag_.encode()
+          << ", which nothing declared it would use, so it was never "
+          << "consumed. Add the function that reads it to "
+          << "productsUsedByFunctions() in FunctionLibrary.h." << std::endl;
+
       currentEvent_->getByToken(token_, handle_);
       isValid_ = true;
       return handle_;
     }
 
+    const edm::InputTag& tag() const {return tag_;}
+    bool consumed() const {return consumed_;}
+
    private:
+    const edm::InputTag tag_;
     const edm::EDGetTokenT<T> token_;
+    const bool consumed_;
     edm::Handle<T> handle_;
     const edm::Event* currentEvent_;
     bool isValid_;
@@ -66,8 +133,10 @@ namespace uwvv
   template<class T> class EventInfoHolder
   {
    public:
-    EventInfoHolder(edm::ConsumesCollector& cc, const edm::InputTag& primaryTag,
-                    const edm::ParameterSet& moreTags);
+    // Tags are taken from label+"Src" and the optional label+"Extra" PSet
+    EventInfoHolder(edm::ConsumesCollector& cc, const edm::ParameterSet& config,
+                    const std::string& label, EventProducts::Type type,
+                    const EventProducts& needed);
     ~EventInfoHolder() {;}
 
     void setEvent(const edm::Event& event);
@@ -75,11 +144,16 @@ namespace uwvv
     const edm::Handle<T>& get() {return primary_->get();}
     const edm::Handle<T>& get(const std::string& item) {return data_.at(item)->get();}
 
+    // One line per consumed tag
+    void printConsumed(std::ostream& out) const;
+
    private:
     DatumPtr<T>& setupData(edm::ConsumesCollector& cc,
-                           const edm::InputTag& primaryTag,
-                           const edm::ParameterSet& moreTags);
+                           const edm::ParameterSet& config,
+                           EventProducts::Type type,
+                           const EventProducts& needed);
 
+    const std::string label_;
     std::map<std::string, DatumPtr<T> > data_;
     DatumPtr<T>& primary_;
   };
@@ -88,11 +162,15 @@ namespace uwvv
   class EventInfo
   {
    public:
-    EventInfo(edm::ConsumesCollector cc, const edm::ParameterSet& config);
+    EventInfo(edm::ConsumesCollector cc, const edm::ParameterSet& config,
+              const EventProducts& needed = EventProducts::everything());
     ~EventInfo() {;}
 
     void setEvent(const edm::Event& event);
 
+    // List the tags that were actually consumed
+    void printConsumed(std::ostream& out) const;
+
     const edm::EventID id() const {return currentEvent_->id();}
 
     const edm::Ptr<reco::Vertex> pv()
@@ -11,6 +11,7 @@
 #include "UWVV/Ntuplizer/interface/StringFunctionMaker.h"
 #include "UWVV/Utilities/interface/helpers.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
+#include "UWVV/DataFormats/interface/DaughterPairKinematics.h"
 
 #include "DataFormats/PatCandidates/interface/Electron.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
@@ -23,6 +24,64 @@
 
 namespace
 {
+  //// What each library function reads from the event through EventInfo,
+  //// so EventInfo only consumes products some branch actually uses.
+  //// Functions not listed here only look at the object (and maybe the
+  //// event ID). If you add a function that reads an event product, add it
+  //// here too, or EventInfo will complain the first time it's filled.
+
+  struct ProductUse
+  {
+    uwvv::EventProducts::Type type;
+    bool optionIsCollection; // "f::x" reads collection x instead of the primary
+  };
+
+  const std::unordered_map<std::string, std::vector<ProductUse> >&
+  productsUsedByFunctions()
+  {
+    typedef uwvv::EventProducts P;
+
+    static const std::unordered_map<std::string, std::vector<ProductUse> > uses =
+      {
+        {"pvZ",                 {{P::Vertices, false}}},
+        {"pvndof",              {{P::Vertices, false}}},
+        {"pvRho",               {{P::Vertices, false}}},
+        {"pvIsValid",           {{P::Vertices, false}}},
+        {"pvIsFake",            {{P::Vertices, false}}},
+        {"nvtx",                {{P::Vertices, false}}},
+        {"PVDZ",                {{P::Vertices, false}}},
+        {"PVDXY",               {{P::Vertices, false}}},
+        {"nTruePU",             {{P::PUInfo, false}}},
+        {"type1_pfMETEt",       {{P::METs, false}}},
+        {"type1_pfMETPhi",      {{P::METs, false}}},
+        {"mtToMET",             {{P::METs, false}}},
+        {"genWeight",           {{P::GenEventInfo, false}}},
+        {"lheWeights",          {{P::LHEEventInfo, false}}},
+        {"minLHEWeight",        {{P::LHEEventInfo, false}}},
+        {"maxLHEWeight",        {{P::LHEEventInfo, false}}},
+        {"genInitialStateMass", {{P::InitialStates, false}}},
+        {"genInitialStatePt",   {{P::InitialStates, false}}},
+        {"genInitialStateEta",  {{P::InitialStates, false}}},
+        {"genInitialStatePhi",  {{P::InitialStates, false}}},
+        {"genJetPt",            {{P::GenJets, true}}},
+        {"genJetEta",           {{P::GenJets, true}}},
+        {"genJetPhi",           {{P::GenJets, true}}},
+        {"genJetRapidity",      {{P::GenJets, true}}},
+        {"nGenJets",            {{P::GenJets, true}}},
+        {"mjjGen",              {{P::GenJets, true}}},
+        {"ptjjGen",             {{P::GenJets, true}}},
+        {"etajjGen",            {{P::GenJets, true}}},
+        {"phijjGen",            {{P::GenJets, true}}},
+        {"deltaEtajjGen",       {{P::GenJets, true}}},
+        {"zeppenfeldGen",       {{P::GenJets, true}}},
+        {"zeppenfeldj3Gen",     {{P::GenJets, true}}},
+        {"deltaPhiTojjGen",     {{P::GenJets, true}}},
+      };
+
+    return uses;
+  }
+
+
   //// Separate templates to allow easier partial specialization
 
   template<typename B>
@@ -46,11 +105,9 @@ namespace
                                {
                                  std::vector<float> out;
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).pt());
-                                   }
+                                 const edm::View<reco::GenJet>& genJets = *evt.genJets(option);
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(genJets, *obj, 0.4))
+                                   out.push_back(genJets.at(i).pt());
 
                                  return out;
                                });
@@ -60,11 +117,9 @@ namespace
                                {
                                  std::vector<float> out;
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).eta());
-                                   }
+                                 const edm::View<reco::GenJet>& genJets = *evt.genJets(option);
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(genJets, *obj, 0.4))
+                                   out.push_back(genJets.at(i).eta());
 
                                  return out;
                                });
@@ -74,11 +129,9 @@ namespace
                                {
                                  std::vector<float> out;
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).phi());
-                                   }
+                                 const edm::View<reco::GenJet>& genJets = *evt.genJets(option);
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(genJets, *obj, 0.4))
+                                   out.push_back(genJets.at(i).phi());
 
                                  return out;
                                });
@@ -88,11 +141,9 @@ namespace
                                {
                                  std::vector<float> out;
 
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out.push_back(evt.genJets(option)->at(i).rapidity());
-                                   }
+                                 const edm::View<reco::GenJet>& genJets = *evt.genJets(option);
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(genJets, *obj, 0.4))
+                                   out.push_back(genJets.at(i).rapidity());
 
                                  return out;
                                });
@@ -216,16 +267,13 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).mass();
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return (j1->p4()+j.p4()).mass();
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -238,16 +286,13 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).pt();
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return (j1->p4()+j.p4()).pt();
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -260,16 +305,13 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).eta();
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return (j1->p4()+j.p4()).eta();
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -282,16 +324,13 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return (j1->p4()+j.p4()).phi();
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return (j1->p4()+j.p4()).phi();
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -304,16 +343,13 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return std::abs(j1->eta() - j.eta());
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return std::abs(j1->eta() - j.eta());
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -326,19 +362,16 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j1)
-                                           return std::abs(obj->rapidity() -
-                                                           (j1->rapidity() +
-                                                            j.rapidity()) / 2.
-                                                           );
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j1)
+                                       return std::abs(obj->rapidity() -
+                                                       (j1->rapidity() +
+                                                        j.rapidity()) / 2.
+                                                       );
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -352,21 +385,18 @@ namespace
 
                                  const reco::GenJet* j1 = 0;
                                  const reco::GenJet* j2 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
-                                       {
-                                         if(j2)
-                                           return std::abs(j.rapidity() -
-                                                           (j1->rapidity() +
-                                                            j2->rapidity()) / 2.
-                                                           );
-                                         else if(j1)
-                                           j2 = &j;
-                                         else
-                                           j1 = &j;
-                                       }
+                                     if(j2)
+                                       return std::abs(j.rapidity() -
+                                                       (j1->rapidity() +
+                                                        j2->rapidity()) / 2.
+                                                       );
+                                     else if(j1)
+                                       j2 = &j;
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -379,19 +409,16 @@ namespace
                                    return -999.;
 
                                  const reco::GenJet* j1 = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
+                                 for(size_t i : uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4))
                                    {
                                      const reco::GenJet& j = evt.genJets(option)->at(i);
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(j, *obj, 0.4))
+                                     if(j1)
                                        {
-                                         if(j1)
-                                           {
-                                             float phiJJ = (j1->p4() + j.p4()).phi();
-                                             return std::abs(deltaPhi(obj->phi(), phiJJ));
-                                           }
-                                         else
-                                           j1 = &j;
+                                         float phiJJ = (j1->p4() + j.p4()).phi();
+                                         return std::abs(deltaPhi(obj->phi(), phiJJ));
                                        }
+                                     else
+                                       j1 = &j;
                                    }
 
                                  return -999.;
@@ -610,14 +637,7 @@ namespace
         addTo["nGenJets"] =
           std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
                                {
-                                 unsigned out = 0;
-                                 for(size_t i = 0; i < evt.genJets(option)->size(); ++i)
-                                   {
-                                     if(!uwvv::helpers::overlapWithAnyDaughter(evt.genJets(option)->at(i), *obj, 0.4))
-                                       out++;
-                                   }
-
-                                 return out;
+                                 return uwvv::helpers::nonOverlappingIndices(*evt.genJets(option), *obj, 0.4).size();
                                });
       }
     };
@@ -808,6 +828,55 @@ namespace
       }
     };
 
+  // Finds the DaughterPairKinematics embedded in a candidate by
+  // AlternateDaughterInfoEmbedder and the positions in it of the two objects
+  // named in a pair function's option (e.g. "e1,m2"). The option is split
+  // and the names looked up only in the first candidate that has the pairs:
+  // each pair function is copied into its own branch, and a branch only
+  // sees one channel's candidates, whose daughters always have the same
+  // names in the same order. Not thread safe, which is fine for the
+  // TreeGenerator's one:: module.
+  class PairIndices
+  {
+   public:
+    PairIndices() : found(false), i(-1), j(-1) {;}
+
+    // The pairs, or null if there aren't any or they don't have both objects
+    const DaughterPairKinematics* get(const pat::CompositeCandidate& cand,
+                                      const std::string& option,
+                                      int& iOut, int& jOut)
+    {
+      const DaughterPairKinematics* pairs = cand.userData<DaughterPairKinematics>("pairKinematics");
+      if(!pairs)
+        return 0;
+
+      if(!found)
+        {
+          size_t sep = option.find(',');
+          if(sep == std::string::npos)
+            throw cms::Exception("InvalidOption")
+              << "Pair functions need two object names, e.g. \"e1,m2\" (got \""
+              << option << "\")" << std::endl;
+
+          i = pairs->index(option.substr(0, sep));
+          j = pairs->index(option.substr(sep+1));
+          found = true;
+        }
+
+      if(i < 0 || j < 0 || i == j)
+        return 0;
+
+      iOut = i;
+      jOut = j;
+      return pairs;
+    }
+
+   private:
+    bool found;
+    int i;
+    int j;
+  };
+
   math::XYZTLorentzVector getUndressedP4(const edm::Ptr<pat::CompositeCandidate>& cand)
     {
       math::XYZTLorentzVector out;
@@ -869,7 +938,8 @@ namespace
                                  if(cleanedJets->size() < 2)
                                    return -999.;
                                     
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).mass();
+                                 return (uwvv::helpers::jetP4(*(*cleanedJets)[0], option) +
+                                         uwvv::helpers::jetP4(*(*cleanedJets)[1], option)).mass();
                                });
         addTo["ptjj"] =
           std::function<FType>([](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option)
@@ -878,7 +948,8 @@ namespace
                                  if(cleanedJets->size() < 2)
                                    return -999.;
                                     
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).pt();
+                                 return (uwvv::helpers::jetP4(*(*cleanedJets)[0], option) +
+                                         uwvv::helpers::jetP4(*(*cleanedJets)[1], option)).pt();
                                });
 
         addTo["etajj"] =
@@ -888,7 +959,8 @@ namespace
                                  if(cleanedJets->size() < 2)
                                    return -999.;
                                     
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).eta();
+                                 return (uwvv::helpers::jetP4(*(*cleanedJets)[0], option) +
+                                         uwvv::helpers::jetP4(*(*cleanedJets)[1], option)).eta();
                                });
 
         addTo["phijj"] =
@@ -898,7 +970,8 @@ namespace
                                  if(cleanedJets->size() < 2)
                                    return -999.;
                                     
-                                 return ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).phi();
+                                 return (uwvv::helpers::jetP4(*(*cleanedJets)[0], option) +
+                                         uwvv::helpers::jetP4(*(*cleanedJets)[1], option)).phi();
                                });
 
         addTo["deltaEtajj"] =
@@ -944,7 +1017,8 @@ namespace
                                  if(cleanedJets->size() < 2)
                                    return -999.;
                                     
-                                 float phiJJ = ((*cleanedJets)[0]->p4() + (*cleanedJets)[1]->p4()).phi();
+                                 float phiJJ = (uwvv::helpers::jetP4(*(*cleanedJets)[0], option) +
+                                                uwvv::helpers::jetP4(*(*cleanedJets)[1], option)).phi();
                                  return std::abs(deltaPhi(obj->phi(), phiJJ));
                                });
 
@@ -1010,6 +1084,33 @@ namespace
                                  return ::getUndressedP4(obj).phi();
                                });
 
+        // Copied into each branch's function, which keeps its own indices
+        ::PairIndices pairIndices;
+
+        addTo["pairMass"] =
+          std::function<FType>([pairIndices](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) mutable
+                               {
+                                 int i, j;
+                                 const DaughterPairKinematics* pairs = pairIndices.get(*obj, option, i, j);
+                                 return pairs ? pairs->mass(i, j) : -999.;
+                               });
+
+        addTo["pairMassNoFSR"] =
+          std::function<FType>([pairIndices](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) mutable
+                               {
+                                 int i, j;
+                                 const DaughterPairKinematics* pairs = pairIndices.get(*obj, option, i, j);
+                                 return pairs ? pairs->massNoFSR(i, j) : -999.;
+                               });
+
+        addTo["pairDR"] =
+          std::function<FType>([pairIndices](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) mutable
+                               {
+                                 int i, j;
+                                 const DaughterPairKinematics* pairs = pairIndices.get(*obj, option, i, j);
+                                 return pairs ? pairs->deltaR(i, j) : -999.;
+                               });
+
       }
     };
 
@@ -1075,7 +1176,7 @@ namespace
 
                                  for(auto& jet : *uwvv::helpers::getCleanedJetCollection(*obj, option))
                                    {
-                                     out.push_back(jet->pt());
+                                     out.push_back(jet->pt() * uwvv::helpers::jetVariationScale(*jet, option));
                                    }
 
                                  return out;
@@ -1176,6 +1277,17 @@ namespace
                                {
                                  return obj->daughter(0)->charge() == obj->daughter(1)->charge();
                                });
+
+        // Copied into each branch's function, which keeps its own indices
+        ::PairIndices pairIndices;
+
+        addTo["pairSS"] =
+          std::function<FType>([pairIndices](const edm::Ptr<T>& obj, uwvv::EventInfo& evt, const std::string& option) mutable
+                               {
+                                 int i, j;
+                                 const DaughterPairKinematics* pairs = pairIndices.get(*obj, option, i, j);
+                                 return pairs ? pairs->sameSign(i, j) : false;
+                               });
       }
     };
 
@@ -1223,6 +1335,29 @@ namespace uwvv
                          std::placeholders::_2, option);
       }
 
+    // Add whatever event products f (same format as for getFunction())
+    // reads to needed. String functions only see the object.
+    void
+    addProductsUsed(const std::string& f, EventProducts& needed) const
+      {
+        size_t sepStart = f.find("::");
+        std::string fname = f.substr(0, sepStart);
+
+        if(functions.find(fname) == functions.end())
+          return;
+
+        auto uses = ::productsUsedByFunctions().find(fname);
+        if(uses == ::productsUsedByFunctions().end())
+          return;
+
+        std::string option = "";
+        if(sepStart != std::string::npos && sepStart+2 < f.size())
+          option = f.substr(sepStart+2);
+
+        for(const auto& use : uses->second)
+          needed.add(use.type, use.optionIsCollection ? option : "");
+      }
+
     // for testing purposes
     // const std::unordered_map<std::string, std::function<FType> >&
     //   getAllFunctions() const {return functions;}
@@ -1246,6 +1381,7 @@ namespace uwvv
     typedef typename BasicFunctionLibrary<std::vector<B>,T>::FSig FSig;
 
     using BasicFunctionLibrary<std::vector<B>,T>::getFunction;
+    using BasicFunctionLibrary<std::vector<B>,T>::addProductsUsed;
 
     std::function<FSig>
     getFunction(const std::vector<std::string>& fs) const
@@ -1277,6 +1413,22 @@ namespace uwvv
         return out;
       }
 
+    void
+    addProductsUsed(const std::vector<std::string>& fs, EventProducts& needed) const
+      {
+        if(fs.size() == 1)
+          {
+            size_t sepStart = fs.at(0).find("::");
+            std::string fname = fs.at(0).substr(0,sepStart);
+
+            if(this->functions.find(fname) != this->functions.end())
+              return addProductsUsed(fs.at(0), needed);
+          }
+
+        for(const auto& f : fs)
+          baseLib.addProductsUsed(f, needed);
+      }
+
    private:
     const FunctionLibrary<B,T> baseLib;
   };
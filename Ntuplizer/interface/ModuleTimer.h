@@ -0,0 +1,111 @@
+#ifndef UWVV_Ntuplizer_ModuleTimer_h
+#define UWVV_Ntuplizer_ModuleTimer_h
+
+// Service (UWVVModuleTimer in configs) that measures the wall time, CPU
+// time, and resident memory change of every module's event call, so the
+// cost of each module ends up in the output file instead of a job log.
+// The ModuleTimingWriter analyzer writes the results as histograms with
+// one x bin per module label, which hadd and uwvvMergeNtuples sum.
+//
+// Each stream fills its own arrays, so there is no locking. CPU time is
+// the calling thread's. RSS is the whole process's, so with more than one
+// stream the deltas include the other streams' allocations; use one
+// stream for memory studies, or turn it off with
+// measureRSS=cms.untracked.bool(False) to save two reads per module.
+// A module whose call runs another (unscheduled) module includes that
+// module's time too.
+
+#include <string>
+#include <vector>
+
+namespace edm
+{
+  class ActivityRegistry;
+  class ModuleCallingContext;
+  class ModuleDescription;
+  class ParameterSet;
+  class StreamContext;
+
+  namespace service
+  {
+    class SystemBounds;
+  }
+}
+
+class TFileDirectory;
+
+
+namespace uwvv
+{
+
+  class ModuleTimer
+  {
+   public:
+    ModuleTimer(const edm::ParameterSet& config, edm::ActivityRegistry& registry);
+    ~ModuleTimer();
+
+    // Histograms of everything so far, into dir
+    void write(TFileDirectory& dir) const;
+
+    // Histogram binning: log10(seconds) for times, MB for RSS changes
+    static constexpr unsigned nTimeBins = 90;
+    static constexpr double timeLow = -7.;
+    static constexpr double timeHigh = 2.;
+    static constexpr unsigned nRSSBins = 128;
+    static constexpr double rssLow = -32.;
+    static constexpr double rssHigh = 32.;
+
+   private:
+    struct Start
+    {
+      double wall;
+      double cpu;
+      long rssPages;
+    };
+
+    // One module's results in one stream. Histograms have ROOT's layout,
+    // with underflow first and overflow last.
+    struct Sums
+    {
+      Sums() : nCalls(0), wall(0.), cpu(0.), rss(0.),
+               wallHist(nTimeBins + 2, 0), cpuHist(nTimeBins + 2, 0),
+               rssHist(nRSSBins + 2, 0) {;}
+
+      unsigned long long nCalls;
+      double wall;
+      double cpu;
+      double rss;
+      std::vector<unsigned> wallHist;
+      std::vector<unsigned> cpuHist;
+      std::vector<unsigned> rssHist;
+    };
+
+    struct Stream
+    {
+      std::vector<Start> starts; // by module ID
+      std::vector<Sums> sums;
+    };
+
+    void preallocate(const edm::service::SystemBounds& bounds);
+    void postModuleConstruction(const edm::ModuleDescription& module);
+    void postBeginJob();
+    void preModuleEvent(const edm::StreamContext& stream,
+                        const edm::ModuleCallingContext& module);
+    void postModuleEvent(const edm::StreamContext& stream,
+                         const edm::ModuleCallingContext& module);
+
+    long rssPages() const;
+
+    const bool measureRSS;
+    const double pageMB;
+    int statmFile;
+
+    unsigned nStreams;
+    std::vector<std::string> labels; // by module ID
+    std::vector<Stream> streams;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
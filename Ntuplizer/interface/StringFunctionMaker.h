@@ -3,7 +3,9 @@
 
 
 #include <functional>
+#include <memory>
 #include <string>
+#include <type_traits>
 
 // ROOT
 #include "TMath.h"
@@ -12,6 +14,9 @@
 #include "DataFormats/Common/interface/Ptr.h"
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
 
+// UWVV
+#include "UWVV/Utilities/interface/UserDataIndex.h"
+
 
 
 namespace
@@ -48,10 +53,58 @@ namespace uwvv
       static std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
       makeStringFunction(const std::string& fString)
     {
+      // Plain userFloat/userInt reads (with or without a hasUserFloat
+      // check) are the bulk of the branches, so skip the string parser
+      // for those
+      std::function<Return(const edm::Ptr<Obj>, OtherArgs...)> out =
+        makeUserDataFunction<Return, Obj, OtherArgs...>(fString,
+                                                        std::integral_constant<bool, userData::IsPATObject<Obj>::value>());
+      if(out)
+        return out;
+
       StringObjectFunction<Obj, true> calculator(fString);
-      std::function<Return(const edm::Ptr<Obj>, OtherArgs...)> 
-        out([calculator](const edm::Ptr<Obj>& obj, OtherArgs... otherArgs)
-            {return ::convertFromFloat<Return>(calculator(*obj));});
+      out = [calculator](const edm::Ptr<Obj>& obj, OtherArgs... otherArgs)
+        {return ::convertFromFloat<Return>(calculator(*obj));};
+      return out;
+    }
+
+   private:
+    template<typename Return, class Obj, class... OtherArgs>
+      static std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
+      makeUserDataFunction(const std::string& fString, std::true_type)
+    {
+      userData::Expression expr;
+      if(!userData::parse(fString, expr))
+        return std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>();
+
+      if(expr.type == userData::Type::Float)
+        return makeIndexedFunction<Return, Obj, userData::Type::Float, OtherArgs...>(expr);
+      return makeIndexedFunction<Return, Obj, userData::Type::Int, OtherArgs...>(expr);
+    }
+
+    // Not a PAT object, no user data
+    template<typename Return, class Obj, class... OtherArgs>
+      static std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
+      makeUserDataFunction(const std::string& fString, std::false_type)
+    {
+      return std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>();
+    }
+
+    template<typename Return, class Obj, userData::Type Type, class... OtherArgs>
+      static std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
+      makeIndexedFunction(const userData::Expression& expr)
+    {
+      auto index = std::make_shared<const UserDataIndex<Obj, Type> >(expr.name);
+      const bool hasDefault = expr.hasDefault;
+      const double defaultVal = expr.defaultVal;
+
+      std::function<Return(const edm::Ptr<Obj>, OtherArgs...)>
+        out([index, hasDefault, defaultVal](const edm::Ptr<Obj>& obj, OtherArgs... otherArgs)
+            {
+              if(hasDefault && !index->has(*obj))
+                return ::convertFromFloat<Return>(defaultVal);
+              return ::convertFromFloat<Return>(index->get(*obj));
+            });
       return out;
     }
   };
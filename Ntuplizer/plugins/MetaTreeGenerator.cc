@@ -3,6 +3,10 @@
 //    MetaTreeGenerator                                                    //    
 //                                                                         //    
 //    A builder of meta-info ntuples                                       //
+//                                                                         //
+//    Events are summed per stream with no locking; the streams' sums      //
+//    are merged at the end of each lumi, and the tree is filled at the    //
+//    end of the job.                                                      //
 //                                                                         //    
 //    Nate Woods, U. Wisconsin                                             //    
 //                                                                         //    
@@ -10,75 +14,171 @@
 
 
 //STL
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 // CMSSW
 #include "FWCore/Framework/interface/Frameworkfwd.h"
-#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/global/EDAnalyzer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/LuminosityBlock.h"
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
 
+#include "SimDataFormats/GeneratorProducts/interface/GenEventInfoProduct.h"
+#include "SimDataFormats/GeneratorProducts/interface/LHEEventProduct.h"
+
 // ROOT
 #include "TTree.h"
 #include "TDirectory.h"
 #include "TObjString.h"
 
 // UWVV
-#include "UWVV/Ntuplizer/interface/EventInfo.h"
+#include "UWVV/Utilities/interface/EventIndex.h"
 
 
 using namespace uwvv;
 
-class MetaTreeGenerator : public edm::one::EDAnalyzer<edm::one::SharedResources, 
-                                                      edm::one::WatchLuminosityBlocks>
+namespace
+{
+  // Sums over one lumi, or the part of it one stream has seen
+  struct LumiSums
+  {
+    LumiSums() : nevents(0), summedWeights(0.) {;}
+
+    void clear()
+    {
+      nevents = 0;
+      summedWeights = 0.;
+      summedLHEWeights.clear();
+    }
+
+    void add(const LumiSums& other)
+    {
+      nevents += other.nevents;
+      summedWeights += other.summedWeights;
+
+      if(other.summedLHEWeights.size() > summedLHEWeights.size())
+        summedLHEWeights.resize(other.summedLHEWeights.size(), 0.);
+      for(size_t i = 0; i < other.summedLHEWeights.size(); ++i)
+        summedLHEWeights[i] += other.summedLHEWeights[i];
+    }
+
+    unsigned nevents;
+    double summedWeights;
+    std::vector<double> summedLHEWeights;
+  };
+
+  struct LumiRow
+  {
+    unsigned run;
+    unsigned lumi;
+    LumiSums sums;
+  };
+}
+
+
+class MetaTreeGenerator : public edm::global::EDAnalyzer<edm::StreamCache<LumiSums>,
+                                                         edm::LuminosityBlockSummaryCache<LumiSums> >
 {
  public:
   explicit MetaTreeGenerator(const edm::ParameterSet&);
   virtual ~MetaTreeGenerator() {;}
 
  private:
-  virtual void analyze(const edm::Event& iEvent, 
-                       const edm::EventSetup& iConfig) override;
-  virtual void beginLuminosityBlock(const edm::LuminosityBlock& iLumi,
-                                    const edm::EventSetup& iSetup);
-  virtual void endLuminosityBlock(const edm::LuminosityBlock& iLumi,
-                                  const edm::EventSetup& iSetup);
+  virtual std::unique_ptr<LumiSums> beginStream(edm::StreamID) const override;
+  virtual void analyze(edm::StreamID, const edm::Event& iEvent,
+                       const edm::EventSetup& iConfig) const override;
+  virtual void streamBeginLuminosityBlock(edm::StreamID,
+                                          const edm::LuminosityBlock& iLumi,
+                                          const edm::EventSetup& iSetup) const override;
+  virtual void streamEndLuminosityBlockSummary(edm::StreamID,
+                                               const edm::LuminosityBlock& iLumi,
+                                               const edm::EventSetup& iSetup,
+                                               LumiSums* sums) const override;
+  virtual std::shared_ptr<LumiSums>
+  globalBeginLuminosityBlockSummary(const edm::LuminosityBlock& iLumi,
+                                    const edm::EventSetup& iSetup) const override;
+  virtual void globalEndLuminosityBlockSummary(const edm::LuminosityBlock& iLumi,
+                                               const edm::EventSetup& iSetup,
+                                               LumiSums* sums) const override;
+  virtual void endJob() override;
 
   TTree* const makeTree();
+  TTree* const makeIndexTree(const edm::ParameterSet& config);
+
+  // [first, last) LHE weights to sum; empty if none
+  static std::vector<unsigned> lheWeightRange(const edm::ParameterSet& config);
+
+  const edm::EDGetTokenT<GenEventInfoProduct> genEventInfoToken;
+  const std::vector<unsigned> lheWeights;
+  const edm::EDGetTokenT<LHEEventProduct> lheEventInfoToken;
 
-  TTree* const tree;
-  EventInfo evtInfo;
   const std::string datasetName;
 
+  // Finished lumis, in the order they ended, to go into the tree at the
+  // end of the job
+  mutable std::mutex lumisMutex;
+  mutable std::vector<LumiRow> lumis;
+
+  TTree* const tree;
+
+  // Sorted (run, lumi) -> entry index (evt is always 0), if requested
+  TTree* const indexTree;
+
   unsigned runBranch;
   unsigned lumiBranch;
   unsigned neventsBranch;
   float summedWeightsBranch;
+  std::vector<double> summedLHEWeightsBranch;
 };
 
 
 MetaTreeGenerator::MetaTreeGenerator(const edm::ParameterSet& config) :
-  tree(makeTree()),
-  evtInfo(consumesCollector(), config.getParameter<edm::ParameterSet>("eventParams")),
+  genEventInfoToken(consumes<GenEventInfoProduct>(config.getParameter<edm::ParameterSet>("eventParams").getParameter<edm::InputTag>("genEventInfoSrc"))),
+  lheWeights(lheWeightRange(config)),
+  lheEventInfoToken(lheWeights.empty() ?
+                    edm::EDGetTokenT<LHEEventProduct>() :
+                    consumes<LHEEventProduct>(config.getParameter<edm::ParameterSet>("eventParams").getParameter<edm::InputTag>("lheEventInfoSrc"))),
   datasetName(config.exists("datasetName") ?
              config.getParameter<std::string>("datasetName") : "unknown"),
+  tree(makeTree()),
+  indexTree(makeIndexTree(config)),
   runBranch(0),
   lumiBranch(0),
   neventsBranch(0),
   summedWeightsBranch(0.)
 {
-  usesResource("TFileService");
   edm::Service<TFileService> FS;
   auto dir = FS->mkdir("datasetName");
   dir.make<TObjString>(datasetName.c_str());
 }
 
 
+std::vector<unsigned>
+MetaTreeGenerator::lheWeightRange(const edm::ParameterSet& config)
+{
+  if(!config.exists("lheWeightRange"))
+    return std::vector<unsigned>();
+
+  std::vector<unsigned> range =
+    config.getParameter<std::vector<unsigned> >("lheWeightRange");
+
+  if(!range.empty() && (range.size() != 2 || range[0] >= range[1]))
+    throw cms::Exception("InvalidParameter")
+      << "lheWeightRange should be empty or [first, last) LHE weight indices"
+      << std::endl;
+
+  return range;
+}
+
+
 TTree* const MetaTreeGenerator::makeTree()
 {
   edm::Service<TFileService> FS;
@@ -89,45 +189,130 @@ TTree* const MetaTreeGenerator::makeTree()
   t->Branch("lumi", &lumiBranch);
   t->Branch("nevents", &neventsBranch);
   t->Branch("summedWeights", &summedWeightsBranch);
-  
+  if(!lheWeights.empty())
+    t->Branch("summedLHEWeights", &summedLHEWeightsBranch);
+
   return t;
 }
 
 
-void
-MetaTreeGenerator::beginLuminosityBlock(const edm::LuminosityBlock& iLumi,
-                                        const edm::EventSetup& iSetup)
+TTree* const MetaTreeGenerator::makeIndexTree(const edm::ParameterSet& config)
+{
+  if(!(config.exists("writeEventIndex") &&
+       config.getParameter<bool>("writeEventIndex")))
+    return 0;
+
+  edm::Service<TFileService> FS;
+
+  return FS->make<TTree>("lumiIndex", "lumiIndex");
+}
+
+
+std::unique_ptr<LumiSums> MetaTreeGenerator::beginStream(edm::StreamID) const
 {
-  runBranch = iLumi.run();
-  lumiBranch = iLumi.luminosityBlock();
-  neventsBranch = 0;
-  summedWeightsBranch = 0.;
+  return std::unique_ptr<LumiSums>(new LumiSums());
 }
 
 
 void
-MetaTreeGenerator::endLuminosityBlock(const edm::LuminosityBlock& iLumi,
-                                      const edm::EventSetup& iSetup)
+MetaTreeGenerator::streamBeginLuminosityBlock(edm::StreamID stream,
+                                              const edm::LuminosityBlock& iLumi,
+                                              const edm::EventSetup& iSetup) const
 {
-  tree->Fill();
+  streamCache(stream)->clear();
 }
 
 
-void MetaTreeGenerator::analyze(const edm::Event &event,
-                                const edm::EventSetup &setup)
+void MetaTreeGenerator::analyze(edm::StreamID stream,
+                                const edm::Event &event,
+                                const edm::EventSetup &setup) const
 {
-  evtInfo.setEvent(event);
+  LumiSums& sums = *streamCache(stream);
+
+  ++sums.nevents;
+
+  edm::Handle<GenEventInfoProduct> genEventInfo;
+  event.getByToken(genEventInfoToken, genEventInfo);
+  if(genEventInfo.isValid())
+    sums.summedWeights += genEventInfo->weight();
+
+  if(lheWeights.empty())
+    return;
+
+  edm::Handle<LHEEventProduct> lheEventInfo;
+  event.getByToken(lheEventInfoToken, lheEventInfo);
+  if(!lheEventInfo.isValid())
+    return;
 
-  ++neventsBranch;
-  summedWeightsBranch += (evtInfo.genEventInfo().isValid() ? 
-                          evtInfo.genEventInfo()->weight() :
-                          0.);
+  const auto& weights = lheEventInfo->weights();
+  const size_t last = std::min<size_t>(lheWeights[1], weights.size());
+  if(last <= lheWeights[0])
+    return;
+
+  if(sums.summedLHEWeights.size() < last - lheWeights[0])
+    sums.summedLHEWeights.resize(last - lheWeights[0], 0.);
+  for(size_t i = lheWeights[0]; i < last; ++i)
+    sums.summedLHEWeights[i - lheWeights[0]] += weights[i].wgt;
 }
 
 
-#include "FWCore/Framework/interface/MakerMacros.h"
+void
+MetaTreeGenerator::streamEndLuminosityBlockSummary(edm::StreamID stream,
+                                                   const edm::LuminosityBlock& iLumi,
+                                                   const edm::EventSetup& iSetup,
+                                                   LumiSums* sums) const
+{
+  // The framework calls this for one stream at a time
+  sums->add(*streamCache(stream));
+}
 
-DEFINE_FWK_MODULE(MetaTreeGenerator);
 
+std::shared_ptr<LumiSums>
+MetaTreeGenerator::globalBeginLuminosityBlockSummary(const edm::LuminosityBlock& iLumi,
+                                                     const edm::EventSetup& iSetup) const
+{
+  return std::make_shared<LumiSums>();
+}
 
 
+void
+MetaTreeGenerator::globalEndLuminosityBlockSummary(const edm::LuminosityBlock& iLumi,
+                                                   const edm::EventSetup& iSetup,
+                                                   LumiSums* sums) const
+{
+  std::lock_guard<std::mutex> lock(lumisMutex);
+  lumis.push_back(LumiRow{iLumi.run(), iLumi.luminosityBlock(), *sums});
+}
+
+
+// Filled here rather than at the end of each lumi because the output file
+// is shared with the ntuplizers, which may be filling their trees then
+void MetaTreeGenerator::endJob()
+{
+  EventIndex index;
+
+  for(const LumiRow& row : lumis)
+    {
+      runBranch = row.run;
+      lumiBranch = row.lumi;
+      neventsBranch = row.sums.nevents;
+      summedWeightsBranch = row.sums.summedWeights;
+      summedLHEWeightsBranch = row.sums.summedLHEWeights;
+
+      tree->Fill();
+
+      if(indexTree)
+        index.add(runBranch, lumiBranch, 0, tree->GetEntries() - 1);
+    }
+
+  if(indexTree)
+    {
+      index.sort();
+      index.fill(*indexTree);
+    }
+}
+
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+DEFINE_FWK_MODULE(MetaTreeGenerator);
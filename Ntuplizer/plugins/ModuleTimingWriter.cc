@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    ModuleTimingWriter                                                   //
+//                                                                         //
+//    Writes the per-module timing and memory histograms from the          //
+//    UWVVModuleTimer service (see UWVV/Ntuplizer/interface/ModuleTimer.h) //
+//    into the output file, in a directory named for this module (put it  //
+//    in an EndPath, and call it moduleTiming to sit next to metaInfo).    //
+//    Everything happens in endJob, so it never holds up the event loop.   //
+//    The service is also defined here.                                    //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+// CMSSW
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "FWCore/ServiceRegistry/interface/ServiceMaker.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+
+// UWVV
+#include "UWVV/Ntuplizer/interface/ModuleTimer.h"
+
+
+class ModuleTimingWriter : public edm::global::EDAnalyzer<>
+{
+ public:
+  explicit ModuleTimingWriter(const edm::ParameterSet&);
+  virtual ~ModuleTimingWriter() {;}
+
+ private:
+  virtual void analyze(edm::StreamID, const edm::Event& iEvent,
+                       const edm::EventSetup& iSetup) const override {;}
+  virtual void endJob() override;
+};
+
+
+ModuleTimingWriter::ModuleTimingWriter(const edm::ParameterSet& config)
+{
+  if(!edm::Service<uwvv::ModuleTimer>().isAvailable())
+    throw cms::Exception("Configuration")
+      << "ModuleTimingWriter needs the UWVVModuleTimer service; add "
+      << "process.UWVVModuleTimer = cms.Service('UWVVModuleTimer')"
+      << std::endl;
+}
+
+
+void ModuleTimingWriter::endJob()
+{
+  edm::Service<TFileService> FS;
+  edm::Service<uwvv::ModuleTimer> timer;
+  timer->write(*FS);
+}
+
+
+#include "FWCore/Framework/interface/MakerMacros.h"
+
+DEFINE_FWK_MODULE(ModuleTimingWriter);
+
+typedef uwvv::ModuleTimer UWVVModuleTimer;
+DEFINE_FWK_SERVICE(UWVVModuleTimer);
@@ -10,6 +10,8 @@
 
 
 //STL
+#include <chrono>
+#include <iostream>
 #include <memory>
 #include <type_traits>
 
@@ -34,6 +36,8 @@
 #include "UWVV/Ntuplizer/interface/EventInfo.h"
 #include "UWVV/Ntuplizer/interface/TriggerBranches.h"
 #include "UWVV/DataFormats/interface/DressedGenParticle.h"
+#include "UWVV/Utilities/interface/AllocationCounter.h"
+#include "UWVV/Utilities/interface/EventIndex.h"
 
 
 using namespace uwvv;
@@ -52,15 +56,40 @@ class TreeGenerator : public edm::one::EDAnalyzer<edm::one::SharedResources>
 
  private:
   virtual void analyze(edm::Event const& iEvent, edm::EventSetup const& iConfig) override;
+  virtual void endJob() override;
 
   TTree* const makeTree() const;
+  TTree* const makeIndexTree(const edm::ParameterSet& config) const;
+
+  void printProducts(const edm::ParameterSet& config) const;
+
+  // Fill the branches for this event's rows again and again, timing it
+  void replay(const edm::View<Cand>& cands);
 
   const edm::EDGetTokenT<edm::View<Cand> > candToken;
 
   const std::string ntupleName;
+  const std::string label;
+
+  // If nonzero, every row is refilled this many times from memory (the
+  // output tree still gets each row once) to benchmark the branches
+  const unsigned replayRepeats;
+  unsigned long long nReplayedRows;
+  unsigned long long nReplayAllocations;
+  double replayBranchTime;
+  double replayTriggerTime;
+  unsigned long long nTreeFills;
+  double treeFillTime;
 
   TTree* const tree;
-  EventInfo evtInfo;
+
+  // Sorted (run, lumi, evt) -> entries index, written next to the tree at
+  // the end of the job if requested
+  TTree* const indexTree;
+  EventIndex index;
+
+  // Made after the branches, which say what it needs to consume
+  std::unique_ptr<EventInfo> evtInfo;
 
   std::unique_ptr<BranchManager<T> > branches;
   std::unique_ptr<TriggerBranches> filterBranches;
@@ -73,8 +102,18 @@ TreeGenerator<T>::TreeGenerator(const edm::ParameterSet& config) :
   candToken(consumes<edm::View<Cand> >(config.getParameter<edm::InputTag>("src"))),
   ntupleName(config.exists("ntupleName") ?
              config.getParameter<std::string>("ntupleName") : "ntuple"),
+  label(config.exists("@module_label") ?
+        config.getParameter<std::string>("@module_label") : ntupleName),
+  replayRepeats(config.exists("replayRepeats") ?
+                config.getParameter<unsigned>("replayRepeats") : 0),
+  nReplayedRows(0),
+  nReplayAllocations(0),
+  replayBranchTime(0.),
+  replayTriggerTime(0.),
+  nTreeFills(0),
+  treeFillTime(0.),
   tree(makeTree()),
-  evtInfo(consumesCollector(), config.getParameter<edm::ParameterSet>("eventParams"))
+  indexTree(makeIndexTree(config))
 {
   usesResource("TFileService");
 
@@ -82,12 +121,25 @@ TreeGenerator<T>::TreeGenerator(const edm::ParameterSet& config) :
   branches =
     std::unique_ptr<BranchManager<T> >(new BranchManager<T>("", tree, branchParams));
 
+  // Only consume the event products some branch reads, unless told otherwise
+  bool consumeAll = (config.exists("consumeAllEventProducts") &&
+                     config.getParameter<bool>("consumeAllEventProducts"));
+  evtInfo = std::unique_ptr<EventInfo>(new EventInfo(consumesCollector(),
+                                                     config.getParameter<edm::ParameterSet>("eventParams"),
+                                                     consumeAll ?
+                                                     EventProducts::everything() :
+                                                     branches->eventProductsUsed()));
+
   const edm::ParameterSet& triggers = config.getParameter<edm::ParameterSet>("triggers");
   triggerBranches = std::unique_ptr<TriggerBranches>(new TriggerBranches(consumesCollector(),
                                                                          triggers, tree));
   const edm::ParameterSet& filters = config.getParameter<edm::ParameterSet>("filters");
   filterBranches = std::unique_ptr<TriggerBranches>(new TriggerBranches(consumesCollector(),
                                                                          filters, tree));
+
+  if(config.exists("listEventProducts") &&
+     config.getParameter<bool>("listEventProducts"))
+    printProducts(config);
 }
 
 
@@ -100,6 +152,43 @@ TTree* const TreeGenerator<T>::makeTree() const
 }
 
 
+template<class T>
+TTree* const
+TreeGenerator<T>::makeIndexTree(const edm::ParameterSet& config) const
+{
+  if(!(config.exists("writeEventIndex") &&
+       config.getParameter<bool>("writeEventIndex")))
+    return 0;
+
+  edm::Service<TFileService> FS;
+
+  return FS->make<TTree>("eventIndex", "eventIndex");
+}
+
+
+template<class T>
+void TreeGenerator<T>::printProducts(const edm::ParameterSet& config) const
+{
+  std::cout << "TreeGenerator " << label << " reads:" << std::endl
+            << "    src: " << config.getParameter<edm::InputTag>("src").encode()
+            << std::endl;
+
+  evtInfo->printConsumed(std::cout);
+
+  for(const std::string& which : {"triggers", "filters"})
+    {
+      const edm::ParameterSet& trg = config.getParameter<edm::ParameterSet>(which);
+      std::cout << "    " << which << ": "
+                << trg.getParameter<edm::InputTag>("trigResultsSrc").encode()
+                << ", "
+                << (trg.exists("trigPrescaleSrc") ?
+                    trg.getParameter<edm::InputTag>("trigPrescaleSrc").encode() :
+                    std::string("patTrigger"))
+                << std::endl;
+    }
+}
+
+
 template<class T> void
 TreeGenerator<T>::analyze(const edm::Event &event,
                           const edm::EventSetup &setup)
@@ -107,18 +196,103 @@ TreeGenerator<T>::analyze(const edm::Event &event,
   edm::Handle<edm::View<Cand> > cands;
   event.getByToken(candToken, cands);
 
-  evtInfo.setEvent(event);
+  evtInfo->setEvent(event);
   triggerBranches->setEvent(event);
   filterBranches->setEvent(event);
 
   for(size_t i = 0; i < cands->size(); ++i)
     {
-      branches->fill(cands->ptrAt(i), evtInfo);
+      branches->fill(cands->ptrAt(i), *evtInfo);
       triggerBranches->fill();
       filterBranches->fill();
 
-      tree->Fill();
+      if(replayRepeats)
+        {
+          auto start = std::chrono::steady_clock::now();
+          tree->Fill();
+          treeFillTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          ++nTreeFills;
+        }
+      else
+        tree->Fill();
+
+      if(indexTree)
+        index.add(event.id().run(), event.id().luminosityBlock(),
+                  event.id().event(), tree->GetEntries() - 1);
     }
+
+  if(replayRepeats)
+    replay(*cands);
+}
+
+
+template<class T>
+void TreeGenerator<T>::replay(const edm::View<Cand>& cands)
+{
+  const unsigned long long allocationsBefore = allocationCounter::count();
+
+  auto start = std::chrono::steady_clock::now();
+  for(unsigned iRep = 0; iRep < replayRepeats; ++iRep)
+    {
+      for(size_t i = 0; i < cands.size(); ++i)
+        branches->fill(cands.ptrAt(i), *evtInfo);
+    }
+  auto branchesDone = std::chrono::steady_clock::now();
+  for(unsigned iRep = 0; iRep < replayRepeats; ++iRep)
+    {
+      for(size_t i = 0; i < cands.size(); ++i)
+        {
+          triggerBranches->fill();
+          filterBranches->fill();
+        }
+    }
+  auto end = std::chrono::steady_clock::now();
+
+  nReplayAllocations += allocationCounter::count() - allocationsBefore;
+  nReplayedRows += cands.size() * replayRepeats;
+  replayBranchTime += std::chrono::duration<double>(branchesDone - start).count();
+  replayTriggerTime += std::chrono::duration<double>(end - branchesDone).count();
+}
+
+
+template<class T>
+void TreeGenerator<T>::endJob()
+{
+  if(indexTree)
+    {
+      index.sort();
+      index.fill(*indexTree);
+    }
+
+  if(!replayRepeats)
+    return;
+
+  const double nRows = nReplayedRows;
+  const double nBranchFills = nRows * branches->nBranches();
+
+  std::cout << "TreeGenerator " << label << " replay (" << replayRepeats
+            << " repeats per row):" << std::endl
+            << "    rows replayed: " << nReplayedRows << std::endl
+            << "    branches per row: " << branches->nBranches() << std::endl;
+
+  if(!nReplayedRows)
+    return;
+
+  std::cout << "    rows/sec (branches + triggers): "
+            << nRows / (replayBranchTime + replayTriggerTime) << std::endl
+            << "    ns/branch: " << 1.e9 * replayBranchTime / nBranchFills
+            << std::endl
+            << "    ns/row in trigger and filter branches: "
+            << 1.e9 * replayTriggerTime / nRows << std::endl
+            << "    ns/row in TTree::Fill (not replayed): "
+            << (nTreeFills ? 1.e9 * treeFillTime / nTreeFills : 0.) << std::endl;
+
+  if(allocationCounter::active())
+    std::cout << "    allocations/row: " << nReplayAllocations / nRows
+              << std::endl;
+  else
+    std::cout << "    allocations/row: not counted (preload "
+              << "libUWVVAllocationCounter.so to count them)" << std::endl;
 }
 
 
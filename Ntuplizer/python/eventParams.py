@@ -28,10 +28,10 @@ def makeEventParams(flowOutputs, channel='', **newParams):
     usual format from AnalysisFlowBase or newParams (which takes precedence).
     Anything that isn't already a CMS type is assumed to be an InputTag.
     Extra collections are indicated by a regular object string, then an
-    identifier after an underscore, e.g. "j_jesUp" for a jet collection with
-    the energy scale raised. These will be added as extra collections labeled
-    with the identifier, e.g. you'd retrieve that jet collection from the
-    EventInfo object with evt.jets("jesUp").
+    identifier after an underscore, e.g. "j_syst" for the jet collection
+    used for systematic variations. These will be added as extra collections
+    labeled with the identifier, e.g. you'd retrieve that jet collection from
+    the EventInfo object with evt.jets("syst").
     '''
     params = _defaultEventParams.copy()
 
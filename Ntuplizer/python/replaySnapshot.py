@@ -0,0 +1,37 @@
+import FWCore.ParameterSet.Config as cms
+
+
+def _collectKeeps(pset, keeps):
+    '''
+    Add a keep statement for every InputTag (including ones in nested PSets)
+    in pset to keeps.
+    '''
+    for name in pset.parameterNames_():
+        param = getattr(pset, name)
+        if isinstance(param, cms.InputTag):
+            if param.getModuleLabel():
+                keeps.add('keep *_{}_{}_{}'.format(param.getModuleLabel(),
+                                                   param.getProductInstanceLabel() or '*',
+                                                   param.getProcessName() or '*'))
+        elif isinstance(param, cms.PSet):
+            _collectKeeps(param, keeps)
+        elif isinstance(param, cms.VPSet):
+            for p in param:
+                _collectKeeps(p, keeps)
+
+
+def snapshotOutputCommands(processName, *modules):
+    '''
+    Output commands for a replay snapshot: everything made in this process
+    (the final candidates and everything they point to), every product the
+    given ntuplizer modules are configured to read, and the default trigger
+    prescales. Electron and photon superclusters live in reducedEgamma in
+    MiniAOD and are only referenced, so they are kept too.
+    '''
+    keeps = set(['keep *_patTrigger_*_*', 'keep *_reducedEgamma_*_*'])
+    for mod in modules:
+        _collectKeeps(mod, keeps)
+
+    commands = ['drop *', 'keep *_*_*_{}'.format(processName)] + sorted(keeps)
+
+    return cms.untracked.vstring(*commands)
@@ -8,7 +8,9 @@ from UWVV.Utilities.helpers import dict2PSet, mapObjects
 def makeCrossDaughterBranches(channel, includeFSR=False):
     '''
     Make a PSet of branches for di-object variables outside of Zs,
-    e.g. e1_m2_Mass.
+    e.g. e1_m2_Mass. These come from the DaughterPairKinematics embedded by
+    AlternateDaughterInfoEmbedder; the branches are -999 (False for SS) if
+    it's missing.
     '''
     objects = mapObjects(channel)
 
@@ -19,12 +21,13 @@ def makeCrossDaughterBranches(channel, includeFSR=False):
             continue
 
         name = '_'.join([pair[0], pair[1], ''])
+        option = '::{},{}'.format(*pair)
 
-        params['floats'][name + 'Mass'] = cms.string('? hasUserFloat("{0}") ? userFloat("{0}") : -999.'.format(name+'Mass'))
+        params['floats'][name + 'Mass'] = cms.string('pairMass' + option)
         if includeFSR:
-            params['floats'][name + 'MassNoFSR'] = cms.string('? hasUserFloat("{0}") ? userFloat("{0}") : -999.'.format(name+'MassNoFSR'))
-        params['bools'][name + 'SS'] = cms.string('? hasUserFloat("{0}") ? userFloat("{0}") : 0'.format(name+'SS'))
-        params['floats'][name + 'DR'] = cms.string('? hasUserFloat("{0}") ? userFloat("{0}") : -999.'.format(name+'DR'))
+            params['floats'][name + 'MassNoFSR'] = cms.string('pairMassNoFSR' + option)
+        params['bools'][name + 'SS'] = cms.string('pairSS' + option)
+        params['floats'][name + 'DR'] = cms.string('pairDR' + option)
 
     return dict2PSet(params)
 
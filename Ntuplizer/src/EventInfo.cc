@@ -5,9 +5,12 @@ using namespace uwvv;
 
 template<class T>
 EventInfoHolder<T>::EventInfoHolder(edm::ConsumesCollector& cc,
-                                    const edm::InputTag& primaryTag,
-                                    const edm::ParameterSet& moreTags) :
-  primary_(setupData(cc,primaryTag,moreTags))
+                                    const edm::ParameterSet& config,
+                                    const std::string& label,
+                                    EventProducts::Type type,
+                                    const EventProducts& needed) :
+  label_(label),
+  primary_(setupData(cc,config,type,needed))
 {
 }
 
@@ -15,14 +18,23 @@ EventInfoHolder<T>::EventInfoHolder(edm::ConsumesCollector& cc,
 template<class T>
 DatumPtr<T>&
 EventInfoHolder<T>::setupData(edm::ConsumesCollector& cc,
-                              const edm::InputTag& primaryTag,
-                              const edm::ParameterSet& moreTags)
+                              const edm::ParameterSet& config,
+                              EventProducts::Type type,
+                              const EventProducts& needed)
 {
+  const edm::ParameterSet moreTags = (config.exists(label_+"Extra") ?
+                                      config.getParameter<edm::ParameterSet>(label_+"Extra") :
+                                      edm::ParameterSet());
+
   data_ = std::map<std::string, DatumPtr<T> >();
-  data_[""] = std::make_unique<EventDatum<T> >(cc, primaryTag);
+  data_[""] = std::make_unique<EventDatum<T> >(cc,
+                                               config.getParameter<edm::InputTag>(label_+"Src"),
+                                               needed.needs(type, ""));
 
   for(auto&& collection : moreTags.getParameterNames())
-    data_[collection] = std::make_unique<EventDatum<T> >(cc, moreTags.getParameter<edm::InputTag>(collection));
+    data_[collection] = std::make_unique<EventDatum<T> >(cc,
+                                                         moreTags.getParameter<edm::InputTag>(collection),
+                                                         needed.needs(type, collection));
 
   return data_[""];
 }
@@ -36,68 +48,38 @@ void EventInfoHolder<T>::setEvent(const edm::Event& event)
 }
 
 
+template<class T>
+void EventInfoHolder<T>::printConsumed(std::ostream& out) const
+{
+  for(auto&& d : data_)
+    {
+      if(!d.second->consumed())
+        continue;
+
+      out << "    " << (d.first.empty() ? label_+"Src" : label_+"Extra."+d.first)
+          << ": " << d.second->tag().encode() << std::endl;
+    }
+}
+
+
 EventInfo::EventInfo(edm::ConsumesCollector cc,
-                     const edm::ParameterSet& config) :
-  vertices_(cc, config.getParameter<edm::InputTag>("vtxSrc"),
-            config.exists("vtxExtra") ?
-            config.getParameter<edm::ParameterSet>("vtxExtra") :
-            edm::ParameterSet()),
-  electrons_(cc, config.getParameter<edm::InputTag>("eSrc"),
-             config.exists("eExtra") ?
-             config.getParameter<edm::ParameterSet>("eExtra") :
-             edm::ParameterSet()),
-  muons_(cc, config.getParameter<edm::InputTag>("mSrc"),
-         config.exists("mExtra") ?
-         config.getParameter<edm::ParameterSet>("mExtra") :
-         edm::ParameterSet()),
-  taus_(cc, config.getParameter<edm::InputTag>("tSrc"),
-        config.exists("tExtra") ?
-        config.getParameter<edm::ParameterSet>("tExtra") :
-        edm::ParameterSet()),
-  photons_(cc, config.getParameter<edm::InputTag>("gSrc"),
-           config.exists("gExtra") ?
-           config.getParameter<edm::ParameterSet>("gExtra") :
-           edm::ParameterSet()),
-  jets_(cc, config.getParameter<edm::InputTag>("jSrc"),
-        config.exists("jExtra") ?
-        config.getParameter<edm::ParameterSet>("jExtra") :
-        edm::ParameterSet()),
-  pfCands_(cc, config.getParameter<edm::InputTag>("pfCandSrc"),
-           config.exists("pfCandExtra") ?
-           config.getParameter<edm::ParameterSet>("pfCandExtra") :
-           edm::ParameterSet()),
-  mets_(cc, config.getParameter<edm::InputTag>("metSrc"),
-        config.exists("metExtra") ?
-        config.getParameter<edm::ParameterSet>("metExtra") :
-        edm::ParameterSet()),
-  puInfo_(cc, config.getParameter<edm::InputTag>("puSrc"),
-          config.exists("puExtra") ?
-          config.getParameter<edm::ParameterSet>("puExtra") :
-          edm::ParameterSet()),
-  genEventInfo_(cc, config.getParameter<edm::InputTag>("genEventInfoSrc"),
-                config.exists("genEventInfoExtra") ?
-                config.getParameter<edm::ParameterSet>("genEventInfoExtra") :
-                edm::ParameterSet()),
-  lheEventInfo_(cc, config.getParameter<edm::InputTag>("lheEventInfoSrc"),
-                config.exists("lheEventInfoExtra") ?
-                config.getParameter<edm::ParameterSet>("lheEventInfoExtra") :
-                edm::ParameterSet()),
-  genJets_(cc, config.getParameter<edm::InputTag>("genJetSrc"),
-           config.exists("genJetExtra") ?
-           config.getParameter<edm::ParameterSet>("genJetExtra") :
-           edm::ParameterSet()),
-  genParticles_(cc, config.getParameter<edm::InputTag>("genParticleSrc"),
-                config.exists("genParticleExtra") ?
-                config.getParameter<edm::ParameterSet>("genParticleExtra") :
-                edm::ParameterSet()),
-  initialStates_(cc, config.getParameter<edm::InputTag>("initialStateSrc"),
-                 config.exists("initialStateExtra") ?
-                 config.getParameter<edm::ParameterSet>("initialStateExtra") :
-                 edm::ParameterSet()),
-  genInitialStates_(cc, config.getParameter<edm::InputTag>("genInitialStateSrc"),
-                    config.exists("genInitialStateExtra") ?
-                    config.getParameter<edm::ParameterSet>("genInitialStateExtra") :
-                    edm::ParameterSet())
+                     const edm::ParameterSet& config,
+                     const EventProducts& needed) :
+  vertices_(cc, config, "vtx", EventProducts::Vertices, needed),
+  electrons_(cc, config, "e", EventProducts::Electrons, needed),
+  muons_(cc, config, "m", EventProducts::Muons, needed),
+  taus_(cc, config, "t", EventProducts::Taus, needed),
+  photons_(cc, config, "g", EventProducts::Photons, needed),
+  jets_(cc, config, "j", EventProducts::Jets, needed),
+  pfCands_(cc, config, "pfCand", EventProducts::PFCands, needed),
+  mets_(cc, config, "met", EventProducts::METs, needed),
+  puInfo_(cc, config, "pu", EventProducts::PUInfo, needed),
+  genEventInfo_(cc, config, "genEventInfo", EventProducts::GenEventInfo, needed),
+  lheEventInfo_(cc, config, "lheEventInfo", EventProducts::LHEEventInfo, needed),
+  genJets_(cc, config, "genJet", EventProducts::GenJets, needed),
+  genParticles_(cc, config, "genParticle", EventProducts::GenParticles, needed),
+  initialStates_(cc, config, "initialState", EventProducts::InitialStates, needed),
+  genInitialStates_(cc, config, "genInitialState", EventProducts::GenInitialStates, needed)
 {
 }
 
@@ -122,3 +104,23 @@ void EventInfo::setEvent(const edm::Event& event)
 
   currentEvent_ = &event;
 }
+
+
+void EventInfo::printConsumed(std::ostream& out) const
+{
+  vertices_.printConsumed(out);
+  electrons_.printConsumed(out);
+  muons_.printConsumed(out);
+  taus_.printConsumed(out);
+  photons_.printConsumed(out);
+  jets_.printConsumed(out);
+  pfCands_.printConsumed(out);
+  mets_.printConsumed(out);
+  puInfo_.printConsumed(out);
+  genEventInfo_.printConsumed(out);
+  lheEventInfo_.printConsumed(out);
+  genJets_.printConsumed(out);
+  genParticles_.printConsumed(out);
+  initialStates_.printConsumed(out);
+  genInitialStates_.printConsumed(out);
+}
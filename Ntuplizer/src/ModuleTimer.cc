@@ -0,0 +1,270 @@
+#include "UWVV/Ntuplizer/interface/ModuleTimer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/ActivityRegistry.h"
+#include "FWCore/ServiceRegistry/interface/ModuleCallingContext.h"
+#include "FWCore/ServiceRegistry/interface/StreamContext.h"
+#include "FWCore/ServiceRegistry/interface/SystemBounds.h"
+#include "DataFormats/Provenance/interface/ModuleDescription.h"
+#include "CommonTools/UtilAlgos/interface/TFileDirectory.h"
+
+#include "TH1D.h"
+#include "TH2F.h"
+
+using namespace uwvv;
+
+
+namespace
+{
+  double wallSeconds()
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  double threadCPUSeconds()
+  {
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + 1.e-9 * t.tv_nsec;
+  }
+
+  // Bin in ROOT's layout (0 is underflow, nBins + 1 overflow)
+  unsigned findBin(double x, unsigned nBins, double low, double high)
+  {
+    if(!(x >= low))
+      return 0;
+    if(x >= high)
+      return nBins + 1;
+    return 1 + unsigned((x - low) * nBins / (high - low));
+  }
+
+  unsigned timeBin(double seconds)
+  {
+    if(seconds <= 0.)
+      return 0;
+    return findBin(std::log10(seconds), ModuleTimer::nTimeBins,
+                   ModuleTimer::timeLow, ModuleTimer::timeHigh);
+  }
+}
+
+
+constexpr unsigned ModuleTimer::nTimeBins;
+constexpr double ModuleTimer::timeLow;
+constexpr double ModuleTimer::timeHigh;
+constexpr unsigned ModuleTimer::nRSSBins;
+constexpr double ModuleTimer::rssLow;
+constexpr double ModuleTimer::rssHigh;
+
+
+ModuleTimer::ModuleTimer(const edm::ParameterSet& config,
+                         edm::ActivityRegistry& registry) :
+  measureRSS(config.getUntrackedParameter<bool>("measureRSS", true)),
+  pageMB(sysconf(_SC_PAGESIZE) / (1024. * 1024.)),
+  statmFile(measureRSS ? open("/proc/self/statm", O_RDONLY) : -1),
+  nStreams(1)
+{
+  registry.watchPreallocate(this, &ModuleTimer::preallocate);
+  registry.watchPostModuleConstruction(this, &ModuleTimer::postModuleConstruction);
+  registry.watchPostBeginJob(this, &ModuleTimer::postBeginJob);
+  registry.watchPreModuleEvent(this, &ModuleTimer::preModuleEvent);
+  registry.watchPostModuleEvent(this, &ModuleTimer::postModuleEvent);
+}
+
+
+ModuleTimer::~ModuleTimer()
+{
+  if(statmFile >= 0)
+    close(statmFile);
+}
+
+
+void ModuleTimer::preallocate(const edm::service::SystemBounds& bounds)
+{
+  nStreams = bounds.maxNumberOfStreams();
+}
+
+
+void ModuleTimer::postModuleConstruction(const edm::ModuleDescription& module)
+{
+  if(module.id() >= labels.size())
+    labels.resize(module.id() + 1);
+  labels[module.id()] = module.moduleLabel();
+}
+
+
+void ModuleTimer::postBeginJob()
+{
+  streams.resize(nStreams);
+  for(Stream& s : streams)
+    {
+      s.starts.resize(labels.size());
+      s.sums.resize(labels.size());
+    }
+}
+
+
+long ModuleTimer::rssPages() const
+{
+  if(statmFile < 0)
+    return 0;
+
+  // statm is "size resident shared ...", in pages
+  char buf[64];
+  ssize_t n = pread(statmFile, buf, sizeof(buf) - 1, 0);
+  if(n <= 0)
+    return 0;
+  buf[n] = '\0';
+
+  char* end = 0;
+  std::strtol(buf, &end, 10);
+  return std::strtol(end, 0, 10);
+}
+
+
+void ModuleTimer::preModuleEvent(const edm::StreamContext& stream,
+                                 const edm::ModuleCallingContext& module)
+{
+  const unsigned id = module.moduleDescription()->id();
+  Stream& s = streams[stream.streamID().value()];
+  if(id >= s.starts.size())
+    return;
+
+  Start& start = s.starts[id];
+  start.rssPages = rssPages();
+  start.cpu = threadCPUSeconds();
+  start.wall = wallSeconds();
+}
+
+
+void ModuleTimer::postModuleEvent(const edm::StreamContext& stream,
+                                  const edm::ModuleCallingContext& module)
+{
+  const double wall = wallSeconds();
+  const double cpu = threadCPUSeconds();
+
+  const unsigned id = module.moduleDescription()->id();
+  Stream& s = streams[stream.streamID().value()];
+  if(id >= s.starts.size())
+    return;
+
+  const Start& start = s.starts[id];
+  Sums& sums = s.sums[id];
+
+  ++sums.nCalls;
+
+  sums.wall += wall - start.wall;
+  ++sums.wallHist[timeBin(wall - start.wall)];
+
+  sums.cpu += cpu - start.cpu;
+  ++sums.cpuHist[timeBin(cpu - start.cpu)];
+
+  if(measureRSS)
+    {
+      const double rss = (rssPages() - start.rssPages) * pageMB;
+      sums.rss += rss;
+      ++sums.rssHist[findBin(rss, nRSSBins, rssLow, rssHigh)];
+    }
+}
+
+
+void ModuleTimer::write(TFileDirectory& dir) const
+{
+  // Everything summed over streams. Every constructed module gets a bin,
+  // even if it never ran, so jobs with the same configuration make
+  // identical axes and merge bin by bin
+  std::vector<unsigned> ids;
+  std::vector<Sums> totals(labels.size());
+  for(unsigned id = 0; id < labels.size(); ++id)
+    {
+      Sums& t = totals[id];
+      for(const Stream& s : streams)
+        {
+          const Sums& sums = s.sums[id];
+          t.nCalls += sums.nCalls;
+          t.wall += sums.wall;
+          t.cpu += sums.cpu;
+          t.rss += sums.rss;
+          for(size_t i = 0; i < t.wallHist.size(); ++i)
+            {
+              t.wallHist[i] += sums.wallHist[i];
+              t.cpuHist[i] += sums.cpuHist[i];
+            }
+          for(size_t i = 0; i < t.rssHist.size(); ++i)
+            t.rssHist[i] += sums.rssHist[i];
+        }
+
+      if(!labels[id].empty())
+        ids.push_back(id);
+    }
+
+  const unsigned nModules = ids.size();
+  if(!nModules)
+    return;
+
+  TH1D* nCalls = dir.make<TH1D>("nCalls", "Event calls", nModules, 0., nModules);
+  TH1D* wallSum = dir.make<TH1D>("wallTimeSum", "Total wall time [s]",
+                                 nModules, 0., nModules);
+  TH1D* cpuSum = dir.make<TH1D>("cpuTimeSum", "Total CPU time [s]",
+                                nModules, 0., nModules);
+  TH2F* wallHist = dir.make<TH2F>("wallTime", "Wall time per event;;log_{10}(t/s)",
+                                  nModules, 0., nModules,
+                                  nTimeBins, timeLow, timeHigh);
+  TH2F* cpuHist = dir.make<TH2F>("cpuTime", "CPU time per event;;log_{10}(t/s)",
+                                 nModules, 0., nModules,
+                                 nTimeBins, timeLow, timeHigh);
+  TH1D* rssSum = 0;
+  TH2F* rssHist = 0;
+  if(measureRSS)
+    {
+      rssSum = dir.make<TH1D>("rssDeltaSum", "Total RSS change [MB]",
+                              nModules, 0., nModules);
+      rssHist = dir.make<TH2F>("rssDelta", "RSS change per event;;#DeltaRSS [MB]",
+                               nModules, 0., nModules,
+                               nRSSBins, rssLow, rssHigh);
+    }
+
+  std::vector<TH1*> all = {nCalls, wallSum, cpuSum, wallHist, cpuHist};
+  if(measureRSS)
+    {
+      all.push_back(rssSum);
+      all.push_back(rssHist);
+    }
+
+  unsigned long long nTotal = 0;
+  for(unsigned iBin = 1; iBin <= nModules; ++iBin)
+    {
+      const Sums& t = totals[ids[iBin - 1]];
+      nTotal += t.nCalls;
+
+      for(TH1* h : all)
+        h->GetXaxis()->SetBinLabel(iBin, labels[ids[iBin - 1]].c_str());
+
+      nCalls->SetBinContent(iBin, t.nCalls);
+      wallSum->SetBinContent(iBin, t.wall);
+      cpuSum->SetBinContent(iBin, t.cpu);
+      for(unsigned iY = 0; iY < t.wallHist.size(); ++iY)
+        {
+          wallHist->SetBinContent(iBin, iY, t.wallHist[iY]);
+          cpuHist->SetBinContent(iBin, iY, t.cpuHist[iY]);
+        }
+
+      if(measureRSS)
+        {
+          rssSum->SetBinContent(iBin, t.rss);
+          for(unsigned iY = 0; iY < t.rssHist.size(); ++iY)
+            rssHist->SetBinContent(iBin, iY, t.rssHist[iY]);
+        }
+    }
+
+  for(TH1* h : all)
+    h->SetEntries(nTotal);
+}
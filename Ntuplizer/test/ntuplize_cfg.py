@@ -11,8 +11,6 @@ from UWVV.Ntuplizer.eventParams import makeEventParams, makeGenEventParams
 
 import os
 
-process = cms.Process("Ntuple")
-
 options = VarParsing.VarParsing('analysis')
 
 options.inputFiles = '/store/mc/RunIIFall15MiniAODv2/GluGluHToZZTo4L_M2500_13TeV_powheg2_JHUgenV6_pythia8/MINIAODSIM/PU25nsData2015v1_76X_mcRun2_asymptotic_v12-v1/60000/02C0EC1D-F3E4-E511-ADCA-AC162DA603B4.root'
@@ -55,6 +53,44 @@ options.register('profile', 0,
                  VarParsing.VarParsing.multiplicity.singleton,
                  VarParsing.VarParsing.varType.int,
                  "Set nonzero to run igprof.")
+options.register('listEventProducts', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to have each ntuplizer print the event "
+                 "products it reads.")
+options.register('snapshotFile', '',
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.string,
+                 "If set, also write the events that make it into an "
+                 "ntuple, with everything the ntuplizers read, to this EDM "
+                 "file for replaying (see the replay option).")
+options.register('replay', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero if the input is a snapshot made with the "
+                 "snapshotFile option (use the same channel and other "
+                 "options). The analysis flow is not rerun, and every row is "
+                 "refilled this many times from memory to benchmark the "
+                 "ntuplizers. Timing is printed at the end of the job.")
+options.register('eventIndex', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to write a sorted (run, lumi, evt) index next "
+                 "to each ntuple (and a (run, lumi) index next to metaInfo) "
+                 "for finding events without scanning the trees.")
+options.register('cutflow', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to count the objects going into and out of "
+                 "every module in the analysis flow, written to the output "
+                 "file as a cutflow tree (flowCutflow directory; print it "
+                 "with uwvvPrintCutflow).")
+options.register('moduleTiming', 0,
+                 VarParsing.VarParsing.multiplicity.singleton,
+                 VarParsing.VarParsing.varType.int,
+                 "Set nonzero to measure the wall time, CPU time and RSS "
+                 "change of every module, written to the output file as "
+                 "histograms (moduleTiming directory).")
 options.register('hzzExtra', 0,
                  VarParsing.VarParsing.multiplicity.singleton,
                  VarParsing.VarParsing.varType.int,
@@ -98,6 +134,10 @@ options.register('datasetName', '',
 
 options.parseArguments()
 
+# A replay job reads products made by an "Ntuple" job, so it can't be one
+processName = "NtupleReplay" if options.replay else "Ntuple"
+process = cms.Process(processName)
+
 genLepChoices =  {"hardProcess" : "isHardProcess()",
         "hardProcessFS" : "fromHardProcessFinalState()",
         "finalstate" : "status() == 1",
@@ -362,25 +402,44 @@ flowOpts = {
     'electronRhoResShift' : options.eRhoResShift,
     'electronPhiResShift' : options.ePhiResShift,
     'muonClosureShift' : options.mClosureShift,
+
+    'cutflow' : bool(options.cutflow) and not options.replay,
     }
 
+# A replay job's input already has the flow's products, so the flows are
+# built in a scratch process of their own, only to get the final tags
+flowProcess = None if options.replay else process
+
 # Turn all these into a single flow class
 FlowClass = createFlow(*FlowSteps)
-flow = FlowClass('flow', process, initialstate_chans=channels, **flowOpts)
+flow = FlowClass('flow', flowProcess, initialstate_chans=channels, **flowOpts)
 
 
 
 ### Set up tree makers
 
 # meta info tree first
+# per-lumi LHE weight sums cover the same weights as the LHE branches
+lheWeightRange = []
+if options.isMC and options.lheWeights:
+    lheWeightRange = [0, {1:9, 2:111}.get(options.lheWeights, 9999)]
+
 process.metaInfo = cms.EDAnalyzer(
     'MetaTreeGenerator',
     eventParams = makeEventParams(flow.finalTags()),
     datasetName = cms.string(options.datasetName),
+    writeEventIndex = cms.bool(bool(options.eventIndex)),
+    lheWeightRange = cms.vuint32(lheWeightRange),
     )
 process.metaTreePath = cms.Path(process.metaInfo)
 process.schedule.append(process.metaTreePath)
 
+if options.moduleTiming:
+    process.UWVVModuleTimer = cms.Service('UWVVModuleTimer')
+    process.moduleTiming = cms.EDAnalyzer('ModuleTimingWriter')
+    process.moduleTimingPath = cms.EndPath(process.moduleTiming)
+    process.schedule.append(process.moduleTimingPath)
+
 is2016H = 'Run2016H' in options.inputFiles[0] or "Run2016H" in options.datasetName
 is2016G = 'Run2016G' in options.inputFiles[0] or "Run2016G" in options.datasetName
 
@@ -419,6 +478,9 @@ for chan in channels:
             if not options.isMC else makeEventParams(flow.finalTags(), chan),
         triggers = trgBranches,
         filters = filterBranches,
+        listEventProducts = cms.bool(bool(options.listEventProducts)),
+        replayRepeats = cms.uint32(options.replay),
+        writeEventIndex = cms.bool(bool(options.eventIndex)),
         )
 
     setattr(process, chan, mod)
@@ -438,7 +500,7 @@ if zz and options.isMC and options.genInfo:
     else:
         from UWVV.AnalysisTools.templates.GenLeptonBase import GenLeptonBase
         GenFlow = createFlow(GenLeptonBase, GenZZBase)
-    genFlow = GenFlow('genFlow', process, suffix='Gen', e='prunedGenParticles',
+    genFlow = GenFlow('genFlow', flowProcess, suffix='Gen', e='prunedGenParticles',
                     m='prunedGenParticles', a='prunedGenParticles', j='slimmedGenJets',
                     pfCands='packedGenParticles',
                     leptonStatusFlag=genLepChoices[options.genLeptonType])
@@ -478,15 +540,48 @@ if zz and options.isMC and options.genInfo:
             eventParams = makeGenEventParams(genFlow.finalTags()),
             triggers = genTrg,
             filters = genTrg,
+            listEventProducts = cms.bool(bool(options.listEventProducts)),
+            replayRepeats = cms.uint32(options.replay),
+            writeEventIndex = cms.bool(bool(options.eventIndex)),
             )
 
         setattr(process, chan+'Gen', genMod)
         process.genTreeSequence += genMod
 
-    pGen = genFlow.getPath()
-    pGen += process.genTreeSequence
+    if options.replay:
+        # the flow already ran when the snapshot was made
+        process.genTreePath = cms.Path(process.genTreeSequence)
+        pGen = process.genTreePath
+    else:
+        pGen = genFlow.getPath()
+        pGen += process.genTreeSequence
     process.schedule.append(pGen)
 
-p = flow.getPath()
-p += process.treeSequence
+if options.replay:
+    process.treePath = cms.Path(process.treeSequence)
+    p = process.treePath
+else:
+    p = flow.getPath()
+    p += process.treeSequence
 process.schedule.append(p)
+
+# Snapshot of events that make it into an ntuple, for replay jobs
+if options.snapshotFile and not options.replay:
+    from UWVV.Ntuplizer.replaySnapshot import snapshotOutputCommands
+
+    snapshotPaths = [flow.name+'FlowPath']
+    ntuplizers = [process.metaInfo] + [getattr(process, chan) for chan in channels]
+    if hasattr(process, 'genTreeSequence'):
+        snapshotPaths.append(genFlow.name+'FlowPath')
+        ntuplizers += [getattr(process, chan+'Gen') for chan in channels]
+
+    process.replaySnapshot = cms.OutputModule(
+        "PoolOutputModule",
+        fileName = cms.untracked.string(options.snapshotFile),
+        outputCommands = snapshotOutputCommands(processName, *ntuplizers),
+        SelectEvents = cms.untracked.PSet(
+            SelectEvents = cms.vstring(*snapshotPaths),
+            ),
+        )
+    process.replaySnapshotPath = cms.EndPath(process.replaySnapshot)
+    process.schedule.append(process.replaySnapshotPath)
@@ -0,0 +1,145 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    cutSelectorBenchmark                                                 //
+//                                                                         //
+//    Times the per-object cost of the cut strings used in the hot loops   //
+//    of the analysis chain with StringCutObjectSelector and with          //
+//    uwvv::CompiledCutSelector, and checks that they make the same        //
+//    decisions.                                                           //
+//                                                                         //
+//    Usage: uwvvCutSelectorBenchmark [nObjects] [nRepetitions]            //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "DataFormats/Candidate/interface/CompositeCandidate.h"
+#include "DataFormats/Candidate/interface/LeafCandidate.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
+
+
+namespace
+{
+  template<typename F>
+  double timeIt(F f, size_t nReps)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nReps; ++i)
+      f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Returns the number of disagreements
+  template<class T, bool Lazy>
+  size_t compare(const std::string& cut, const std::vector<T>& objects,
+                 size_t nReps)
+  {
+    const StringCutObjectSelector<T, Lazy> interpreted(cut);
+    const uwvv::CompiledCutSelector<T, Lazy> compiled(cut);
+
+    std::vector<unsigned char> oldPass(objects.size());
+    std::vector<unsigned char> newPass(objects.size());
+
+    double tOld = timeIt([&]()
+      {
+        for(size_t i = 0; i < objects.size(); ++i)
+          oldPass[i] = interpreted(objects[i]);
+      }, nReps);
+    double tNew = timeIt([&]()
+      {
+        for(size_t i = 0; i < objects.size(); ++i)
+          newPass[i] = compiled(objects[i]);
+      }, nReps);
+
+    size_t nBad = 0;
+    for(size_t i = 0; i < objects.size(); ++i)
+      {
+        if(oldPass[i] != newPass[i])
+          ++nBad;
+      }
+
+    const double nEvals = double(objects.size()) * nReps;
+    std::cout << cut << std::endl
+              << "  StringCutObjectSelector: " << 1.e9 * tOld / nEvals
+              << " ns/object" << std::endl
+              << "  CompiledCutSelector:     " << 1.e9 * tNew / nEvals
+              << " ns/object (" << tOld / tNew << "x"
+              << (compiled.isCompiled() ? "" : ", interpreted") << ")"
+              << std::endl
+              << "  mismatches: " << nBad << std::endl;
+
+    return nBad;
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  const size_t nObjects = (argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000);
+  const size_t nReps = (argc > 2 ? std::strtoul(argv[2], 0, 10) : 1000);
+
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<double> etaDist(-3., 3.);
+  std::uniform_real_distribution<double> phiDist(-3.14159, 3.14159);
+  std::exponential_distribution<double> ptDist(1. / 20.);
+  std::uniform_real_distribution<float> flagDist(0., 1.);
+
+  std::vector<pat::PackedCandidate> pfCands;
+  std::vector<pat::Muon> muons;
+  for(size_t i = 0; i < nObjects; ++i)
+    {
+      double pt = ptDist(gen);
+      double eta = etaDist(gen);
+      double phi = phiDist(gen);
+      reco::Candidate::PolarLorentzVector p4(pt, eta, phi, 0.);
+
+      pat::PackedCandidate pf;
+      pf.setP4(p4);
+      pf.setPdgId(i % 3 ? 22 : 211);
+      pfCands.push_back(pf);
+
+      pat::Muon mu;
+      mu.setP4(reco::Candidate::PolarLorentzVector(pt, eta, phi, 0.106));
+      mu.setCharge(i % 2 ? 1 : -1);
+      mu.addUserFloat("ZZIDPassTight", flagDist(gen) > 0.3);
+      mu.addUserFloat("ZZIsoPass", flagDist(gen) > 0.2);
+      muons.push_back(mu);
+    }
+
+  // Z candidates like the ones the combiners make
+  std::vector<reco::CompositeCandidate> zs;
+  for(size_t i = 0; i + 1 < nObjects; i += 2)
+    {
+      reco::CompositeCandidate z;
+      z.addDaughter(reco::LeafCandidate(muons[i].charge(), muons[i].p4()), "m1");
+      z.addDaughter(reco::LeafCandidate(muons[i+1].charge(), muons[i+1].p4()), "m2");
+      z.setP4(muons[i].p4() + muons[i+1].p4());
+      zs.push_back(z);
+    }
+
+  size_t nBad = 0;
+  nBad += compare<pat::PackedCandidate, false>("pdgId == 22 && pt > 2 && abs(eta) < 2.4",
+                                               pfCands, nReps);
+  nBad += compare<pat::Muon, false>("userFloat(\"ZZIDPassTight\") > 0.5 && userFloat(\"ZZIsoPass\") > 0.5",
+                                    muons, nReps);
+  nBad += compare<pat::Muon, false>("pt > 5 && abs(eta) < 2.4 && isPFMuon",
+                                    muons, nReps);
+  nBad += compare<reco::CompositeCandidate, true>("daughter(\"m1\").pt > 5 && abs(daughter(\"m1\").eta) < 2.4 && "
+                                                  "daughter(\"m2\").pt > 5 && abs(daughter(\"m2\").eta) < 2.4",
+                                                  zs, nReps / 2);
+  nBad += compare<reco::CompositeCandidate, true>("40. < mass < 120.",
+                                                  zs, nReps / 2);
+
+  return nBad ? 1 : 0;
+}
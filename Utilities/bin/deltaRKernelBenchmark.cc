@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    deltaRKernelBenchmark                                                //
+//                                                                         //
+//    Times the batched deltaR kernels against their scalar reference      //
+//    versions and against one-pair-at-a-time evaluation, and checks that  //
+//    they agree.                                                          //
+//                                                                         //
+//    Usage: uwvvDeltaRKernelBenchmark [nObjects] [nRepetitions]           //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
+
+using namespace uwvv::deltaR;
+
+namespace
+{
+  template<typename F>
+  double timeIt(F f, size_t nReps)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nReps; ++i)
+      f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / nReps;
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  const size_t n = (argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000);
+  const size_t nReps = (argc > 2 ? std::strtoul(argv[2], 0, 10) : 200);
+
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<float> etaDist(-2.5, 2.5);
+  std::uniform_real_distribution<float> phiDist(-M_PI, M_PI);
+
+  EtaPhiBuffer a(n), b(n);
+  for(size_t i = 0; i < n; ++i)
+    {
+      a.push_back(etaDist(gen), phiDist(gen));
+      b.push_back(etaDist(gen), phiDist(gen));
+    }
+
+  std::vector<float> outVec(n * n);
+  std::vector<float> outScalar(n * n);
+  std::vector<unsigned char> mask(n);
+  volatile float sink = 0.;
+
+  double tPairwise = timeIt([&]()
+                            {
+                              for(size_t i = 0; i < n; ++i)
+                                for(size_t j = 0; j < n; ++j)
+                                  outScalar[i*n+j] = deltaR2(a.eta()[i], a.phi()[i],
+                                                             b.eta()[j], b.phi()[j]);
+                              sink = outScalar[n];
+                            }, nReps);
+
+  double tScalar = timeIt([&]()
+                          {
+                            scalar::deltaR2Matrix(a.eta(), a.phi(), n,
+                                                  b.eta(), b.phi(), n,
+                                                  outScalar.data());
+                            sink = outScalar[n];
+                          }, nReps);
+
+  double tVec = timeIt([&]()
+                       {
+                         deltaR2Matrix(a.eta(), a.phi(), n,
+                                       b.eta(), b.phi(), n,
+                                       outVec.data());
+                         sink = outVec[n];
+                       }, nReps);
+
+  double tMask = timeIt([&]()
+                        {
+                          std::fill(mask.begin(), mask.end(), 0);
+                          for(size_t i = 0; i < n; ++i)
+                            markWithinDeltaR(a.eta()[i], a.phi()[i], b.eta(), b.phi(),
+                                             n, 0.4, mask.data());
+                          sink = mask[0];
+                        }, nReps);
+
+  size_t nBad = 0;
+  for(size_t i = 0; i < n * n; ++i)
+    {
+      if(std::abs(outVec[i] - outScalar[i]) > 1.e-5 * (1. + outScalar[i]))
+        ++nBad;
+    }
+
+  const double nPairs = double(n) * n;
+
+  std::cout << n << " x " << n << " deltaR^2 matrix, " << nReps << " repetitions" << std::endl
+            << "  one pair at a time: " << tPairwise / nPairs << " ns/pair" << std::endl
+            << "  scalar kernel:      " << tScalar / nPairs << " ns/pair" << std::endl
+            << "  vectorized kernel:  " << tVec / nPairs << " ns/pair" << std::endl
+            << "  threshold mask:     " << tMask / nPairs << " ns/pair" << std::endl
+            << "  mismatches:         " << nBad << std::endl;
+
+  return (nBad ? 1 : 0);
+}
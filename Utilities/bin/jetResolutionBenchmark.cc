@@ -0,0 +1,157 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    jetResolutionBenchmark                                               //
+//                                                                         //
+//    Compares the events/sec of the jet resolution and scale factor       //
+//    lookups in PATJetSmearing done the old way (payloads copied out of   //
+//    the EventSetup every event, each jet evaluated on its own through    //
+//    JME::JetParameters) and with uwvv::jer::JetResolutionCache, and      //
+//    checks that they agree. Use a high jet multiplicity to see the       //
+//    difference.                                                          //
+//                                                                         //
+//    Usage: uwvvJetResolutionBenchmark resolution.txt scaleFactors.txt    //
+//               [nJets] [nEvents]                                         //
+//    with the text files from the JER database, e.g.                      //
+//    Spring16_25nsV10_MC_PtResolution_AK4PFchs.txt and                    //
+//    Spring16_25nsV10_MC_SF_AK4PFchs.txt                                  //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "JetMETCorrections/Modules/interface/JetResolution.h"
+#include "UWVV/Utilities/interface/JetResolutionCache.h"
+
+
+namespace
+{
+  struct Event
+  {
+    float rho;
+    std::vector<float> pt;
+    std::vector<float> eta;
+  };
+
+  template<typename F>
+  double eventsPerSecond(F f, const std::vector<Event>& events)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& evt : events)
+      f(evt);
+    auto end = std::chrono::steady_clock::now();
+
+    return events.size() / std::chrono::duration<double>(end - start).count();
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  if(argc < 3)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " resolution.txt scaleFactors.txt [nJets] [nEvents]"
+                << std::endl;
+      return 1;
+    }
+
+  const JME::JetResolution resFile(argv[1]);
+  const JME::JetResolutionScaleFactor sfFile(argv[2]);
+  const size_t nJets = (argc > 3 ? std::strtoul(argv[3], 0, 10) : 30);
+  const size_t nEvents = (argc > 4 ? std::strtoul(argv[4], 0, 10) : 20000);
+
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<float> etaDist(-4.7, 4.7);
+  std::exponential_distribution<float> ptDist(1. / 40.);
+  std::uniform_real_distribution<float> rhoDist(5., 40.);
+
+  std::vector<Event> events(nEvents);
+  for(auto& evt : events)
+    {
+      evt.rho = rhoDist(gen);
+      for(size_t i = 0; i < nJets; ++i)
+        {
+          evt.pt.push_back(15. + ptDist(gen));
+          evt.eta.push_back(etaDist(gen));
+        }
+    }
+
+  std::vector<float> oldOut(3 * nEvents * nJets);
+  std::vector<float> newOut(3 * nEvents * nJets);
+  std::vector<float> oldRes(nEvents * nJets);
+  std::vector<float> newRes(nEvents * nJets);
+  size_t iEvt = 0;
+
+  // What PATJetSmearing used to do: JME::JetResolution::get() returns a
+  // copy of the payload
+  double oldRate = eventsPerSecond([&](const Event& evt)
+    {
+      JME::JetResolution res(*resFile.getResolutionObject());
+      JME::JetResolutionScaleFactor sf(*sfFile.getResolutionObject());
+
+      for(size_t i = 0; i < evt.pt.size(); ++i)
+        {
+          size_t k = iEvt * nJets + i;
+
+          JME::JetParameters params;
+          params.setJetPt(evt.pt[i]).setJetEta(evt.eta[i]).setRho(evt.rho);
+          oldRes[k] = res.getResolution(params);
+
+          JME::JetParameters paramsSF;
+          paramsSF.setJetEta(evt.eta[i]).setRho(evt.rho);
+          oldOut[3*k] = sf.getScaleFactor(paramsSF);
+          oldOut[3*k+1] = sf.getScaleFactor(paramsSF, Variation::DOWN);
+          oldOut[3*k+2] = sf.getScaleFactor(paramsSF, Variation::UP);
+        }
+      ++iEvt;
+    }, events);
+
+  uwvv::jer::JetResolutionCache cache("", "");
+  cache.set(resFile, sfFile);
+  std::vector<float> nom(nJets), dn(nJets), up(nJets);
+  iEvt = 0;
+
+  double newRate = eventsPerSecond([&](const Event& evt)
+    {
+      size_t k = iEvt * nJets;
+
+      cache.resolutions(nJets, evt.pt.data(), evt.eta.data(), evt.rho,
+                        &newRes[k]);
+      cache.scaleFactors(nJets, evt.eta.data(), evt.rho,
+                         nom.data(), dn.data(), up.data());
+      for(size_t i = 0; i < nJets; ++i)
+        {
+          newOut[3*(k+i)] = nom[i];
+          newOut[3*(k+i)+1] = dn[i];
+          newOut[3*(k+i)+2] = up[i];
+        }
+      ++iEvt;
+    }, events);
+
+  size_t nBad = 0;
+  for(size_t k = 0; k < oldRes.size(); ++k)
+    {
+      if(std::abs(oldRes[k] - newRes[k]) > 1.e-6 * std::abs(oldRes[k]))
+        ++nBad;
+    }
+  for(size_t k = 0; k < oldOut.size(); ++k)
+    {
+      if(oldOut[k] != newOut[k])
+        ++nBad;
+    }
+
+  std::cout << nEvents << " events with " << nJets << " jets" << std::endl;
+  std::cout << "  per-event payloads, per-jet evaluation: " << oldRate
+            << " events/s" << std::endl;
+  std::cout << "  cached payloads, batched evaluation:    " << newRate
+            << " events/s (" << newRate / oldRate << "x)" << std::endl;
+  std::cout << "  mismatches: " << nBad << std::endl;
+
+  return nBad ? 1 : 0;
+}
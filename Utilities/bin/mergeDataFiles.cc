@@ -0,0 +1,407 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    mergeDataFiles                                                       //
+//                                                                         //
+//    Merge many data ntuple files into one, removing duplicate events     //
+//    (the overlap between primary datasets). Same output as               //
+//    Utilities/scripts/mergeDataFiles.py: for each channel, the first     //
+//    occurrence of every event, in input order, in channel/ntuple.        //
+//                                                                         //
+//    Channels are done in parallel, each into its own temporary file,     //
+//    then gathered into the output. Files with no duplicates are copied   //
+//    basket by basket (fast cloning); the others entry by entry.          //
+//    Other directories (meta info, module timing, cutflows) are merged    //
+//    like hadd would, with trees concatenated and histograms summed;      //
+//    channels that weren't asked for are left out.                        //
+//                                                                         //
+//    Usage: uwvvMergeDataFiles [options] channels input output            //
+//        channels: comma-separated list or shorthand (zz, zl, z, l)       //
+//        input: comma-separated list of files, may contain wildcards      //
+//               (matches are taken in sorted order)                       //
+//    Options:                                                             //
+//        -j N: number of channels to do at once (default: all)            //
+//        -m MB: memory limit for duplicate finding per channel; past      //
+//               this, events are sorted externally (default: no limit)    //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TChain.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include "UWVV/Utilities/interface/DuplicateEventFinder.h"
+#include "UWVV/Utilities/interface/EventIndex.h"
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+
+
+namespace
+{
+  std::vector<std::string> split(const std::string& s, char sep)
+  {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while(std::getline(ss, item, sep))
+      {
+        if(!item.empty())
+          out.push_back(item);
+      }
+    return out;
+  }
+
+  // Same as UWVV.Utilities.helpers.parseChannels
+  std::vector<std::string> parseChannels(std::string channels)
+  {
+    std::transform(channels.begin(), channels.end(), channels.begin(), ::tolower);
+
+    if(channels == "4l" || channels == "zz")
+      return {"eeee", "eemm", "mmmm"};
+    if(channels == "3l" || channels == "zl" || channels == "z+l" || channels == "wz")
+      return {"eee", "eem", "emm", "mmm"};
+    if(channels == "z" || channels == "2l" || channels == "ll")
+      return {"ee", "mm"};
+    if(channels == "l" || channels == "1l")
+      return {"e", "m"};
+
+    std::vector<std::string> out = split(channels, ',');
+    for(const auto& ch : out)
+      {
+        if(ch.size() > 4 || ch.find_first_not_of("emtgj") != std::string::npos)
+          throw std::invalid_argument("Invalid channel " + ch);
+      }
+    return out;
+  }
+
+
+  struct ChannelResult
+  {
+    std::string channel;
+    std::string tempFile;
+    long long nIn;
+    long long nOut;
+    bool externalSort;
+    bool hasIndex;
+    uwvv::EventIndex index;
+    std::string error;
+  };
+
+
+  // Index of the chained trees, if all the files have one
+  bool readIndex(const std::vector<std::string>& files,
+                 const std::string& channel, uwvv::EventIndex& out)
+  {
+    for(const auto& f : files)
+      {
+        TFile in(f.c_str());
+        TDirectory* d = in.GetDirectory(channel.c_str());
+        uwvv::EventIndex fileIndex;
+        if(!(d && uwvv::EventIndex::read(*d, fileIndex)))
+          return false;
+
+        TTree* t = 0;
+        d->GetObject("ntuple", t);
+        if(!t || Long64_t(fileIndex.treeEntries()) != t->GetEntries())
+          return false;
+
+        out.append(fileIndex);
+      }
+
+    return true;
+  }
+
+
+  // Index of the merged tree: the kept entries of the input index,
+  // renumbered
+  uwvv::EventIndex keptIndex(const uwvv::EventIndex& in,
+                             const std::vector<bool>& keep)
+  {
+    std::vector<uwvv::EventIndex::Range> byEntry(in.begin(), in.end());
+    std::sort(byEntry.begin(), byEntry.end(),
+              [](const uwvv::EventIndex::Range& a,
+                 const uwvv::EventIndex::Range& b)
+              {return a.first < b.first;});
+
+    uwvv::EventIndex out;
+    uint64_t pos = 0;
+    uint64_t nKeptBefore = 0;
+    for(const auto& r : byEntry)
+      {
+        for(; pos < r.first; ++pos)
+          nKeptBefore += keep[pos];
+
+        for(; pos < r.first + r.n; ++pos)
+          {
+            if(keep[pos])
+              out.add(r.id, nKeptBefore++);
+          }
+      }
+    out.sort();
+
+    return out;
+  }
+
+
+  // Find the entries to keep for one channel and copy them to their own file
+  void mergeChannel(const std::vector<std::string>& files,
+                    size_t memoryLimit, ChannelResult& result)
+  {
+    const std::string treeName = result.channel + "/ntuple";
+
+    TChain chain(treeName.c_str());
+    for(const auto& f : files)
+      chain.Add(f.c_str());
+
+    result.nIn = chain.GetEntries();
+    result.nOut = 0;
+
+    // Pass 1: only read the event ID
+    unsigned run = 0;
+    unsigned long long evt = 0;
+    chain.SetBranchStatus("*", 0);
+    chain.SetBranchStatus("run", 1);
+    chain.SetBranchStatus("evt", 1);
+    chain.SetBranchAddress("run", &run);
+    chain.SetBranchAddress("evt", &evt);
+
+    uwvv::DuplicateEventFinder finder(result.nIn, memoryLimit);
+    for(long long i = 0; i < result.nIn; ++i)
+      {
+        chain.GetEntry(i);
+        finder.add(run, evt);
+      }
+    finder.finish();
+    result.externalSort = finder.usedExternalSort();
+
+    const std::vector<bool>& keep = finder.kept();
+
+    uwvv::EventIndex inputIndex;
+    result.hasIndex = readIndex(files, result.channel, inputIndex);
+    if(result.hasIndex)
+      result.index = keptIndex(inputIndex, keep);
+
+    // Pass 2: copy
+    chain.ResetBranchAddresses();
+    chain.SetBranchStatus("*", 1);
+
+    TFile out(result.tempFile.c_str(), "recreate");
+    TTree* outTree = chain.CloneTree(0);
+    outTree->SetDirectory(&out);
+    outTree->SetName("ntuple");
+    outTree->SetTitle("ntuple");
+
+    // Offset of each file's first entry in the chain
+    chain.LoadTree(0);
+    const Long64_t* offsets = chain.GetTreeOffset();
+
+    for(int iTree = 0; iTree < chain.GetNtrees(); ++iTree)
+      {
+        const long long begin = offsets[iTree];
+        const long long end = (iTree + 1 < chain.GetNtrees() ?
+                               offsets[iTree+1] : result.nIn);
+        if(begin == end)
+          continue;
+
+        const bool keepAll = std::all_of(keep.begin() + begin, keep.begin() + end,
+                                         [](bool b) {return b;});
+
+        if(keepAll)
+          {
+            chain.LoadTree(begin);
+            outTree->FlushBaskets();
+            outTree->CopyEntries(chain.GetTree(), -1, "fast");
+            result.nOut += end - begin;
+            continue;
+          }
+
+        for(long long i = begin; i < end; ++i)
+          {
+            if(!keep[i])
+              continue;
+
+            chain.GetEntry(i);
+            outTree->Fill();
+            ++result.nOut;
+          }
+      }
+
+    out.cd();
+    outTree->Write();
+    out.Close();
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  size_t nThreads = 0;
+  size_t memoryLimit = 0;
+  std::vector<std::string> positional;
+
+  for(int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if((arg == "-j" || arg == "-m") && i + 1 < argc)
+        {
+          unsigned long val = std::strtoul(argv[++i], 0, 10);
+          if(arg == "-j")
+            nThreads = val;
+          else
+            memoryLimit = val << 20;
+        }
+      else
+        positional.push_back(arg);
+    }
+
+  if(positional.size() != 3)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [-j nThreads] [-m memoryLimitMB] channels input output"
+                << std::endl;
+      return 1;
+    }
+
+  std::vector<std::string> channels;
+  try
+    {
+      channels = parseChannels(positional[0]);
+    }
+  catch(const std::invalid_argument& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+  const std::vector<std::string> files = uwvv::ntupleFiles::expand(positional[1]);
+  if(files.empty())
+    {
+      std::cerr << "No files found matching " << positional[1] << std::endl;
+      return 1;
+    }
+  const std::string outName = positional[2];
+
+  ROOT::EnableThreadSafety();
+
+  std::vector<ChannelResult> results(channels.size());
+  for(size_t i = 0; i < channels.size(); ++i)
+    {
+      results[i].channel = channels[i];
+      results[i].tempFile = outName + ".tmp_" + channels[i] + ".root";
+      results[i].nIn = results[i].nOut = 0;
+      results[i].externalSort = false;
+      results[i].hasIndex = false;
+    }
+
+  if(!nThreads || nThreads > channels.size())
+    nThreads = channels.size();
+
+  std::atomic<size_t> nextChannel(0);
+  std::vector<std::thread> workers;
+  for(size_t iThread = 0; iThread < nThreads; ++iThread)
+    {
+      workers.emplace_back([&]()
+        {
+          for(size_t i = nextChannel++; i < results.size(); i = nextChannel++)
+            {
+              try
+                {
+                  mergeChannel(files, memoryLimit, results[i]);
+                }
+              catch(const std::exception& e)
+                {
+                  results[i].error = e.what();
+                }
+            }
+        });
+    }
+  for(auto& w : workers)
+    w.join();
+
+  // Gather the channels into the output file
+  int status = 0;
+  TFile out(outName.c_str(), "recreate");
+  for(const auto& r : results)
+    {
+      if(!r.error.empty())
+        {
+          std::cerr << r.channel << ": " << r.error << std::endl;
+          status = 1;
+          continue;
+        }
+
+      TFile in(r.tempFile.c_str());
+      TTree* t = static_cast<TTree*>(in.Get("ntuple"));
+      if(!t)
+        {
+          std::cerr << r.channel << ": merged tree is missing" << std::endl;
+          status = 1;
+          continue;
+        }
+
+      TDirectory* d = out.mkdir(r.channel.c_str());
+      d->cd();
+      TTree* copy = t->CloneTree(-1, "fast");
+      copy->SetDirectory(d);
+      copy->Write();
+      if(r.hasIndex)
+        {
+          TTree indexTree("eventIndex", "eventIndex");
+          indexTree.SetDirectory(d);
+          r.index.fill(indexTree);
+          indexTree.Write();
+          indexTree.SetDirectory(0);
+        }
+      in.Close();
+      std::remove(r.tempFile.c_str());
+
+      std::cout << r.channel << ": " << r.nIn << " entries in, " << r.nOut
+                << " out (" << r.nIn - r.nOut << " duplicates removed"
+                << (r.externalSort ? ", external sort" : "")
+                << (r.hasIndex ? ", indexed" : "") << ")"
+                << std::endl;
+    }
+
+  try
+    {
+      // Channels not asked for are left out, not merged with duplicates
+      std::vector<std::string> ntupleDirs;
+      {
+        TFile first(files.front().c_str());
+        ntupleDirs = uwvv::ntupleFiles::directoriesWith(first, "ntuple");
+      }
+
+      for(const auto& d : uwvv::ntupleFiles::topDirectories(files))
+        {
+          if(std::find(channels.begin(), channels.end(), d) != channels.end() ||
+             std::find(ntupleDirs.begin(), ntupleDirs.end(), d) != ntupleDirs.end())
+            continue;
+
+          TDirectory* outDir = out.mkdir(d.c_str());
+          uwvv::ntupleFiles::mergeDirectory(files, d, *outDir);
+        }
+    }
+  catch(const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+      status = 1;
+    }
+
+  out.Close();
+
+  return status;
+}
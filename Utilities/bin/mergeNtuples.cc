@@ -0,0 +1,516 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    mergeNtuples                                                         //
+//                                                                         //
+//    Merge ntuple files (e.g. the outputs of all the jobs for a sample)   //
+//    into one, like hadd but aware of the UWVV layout:                    //
+//      - channel ntuples are fast-cloned (copied basket by basket), all   //
+//        channels in parallel, and their event indices combined           //
+//      - metaInfo rows for the same run and lumi are summed (events,      //
+//        weights, LHE weight sums), and the lumi index remade             //
+//        (the metaInfo/datasetName string is kept)                        //
+//      - everything else (e.g. moduleTiming, flowCutflow) is merged like  //
+//        hadd would: histograms summed, trees concatenated                //
+//                                                                         //
+//    With more inputs than the fan-in, groups of inputs are merged into   //
+//    temporary files (groups in parallel) and those are merged, and so    //
+//    on, so the number of files open and the memory used stay flat.       //
+//                                                                         //
+//    Usage: uwvvMergeNtuples [options] output input [input ...]           //
+//        inputs may be comma-separated lists and contain wildcards        //
+//    Options:                                                             //
+//        -j N: number of threads (default: number of cores)               //
+//        -f N: fan-in, the most files merged at once (default: 500)       //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "TChain.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TObjString.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include "UWVV/Utilities/interface/EventIndex.h"
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+
+
+namespace
+{
+  // Run f(0) ... f(n-1) on up to nThreads threads
+  void parallelFor(size_t n, size_t nThreads,
+                   const std::function<void(size_t)>& f)
+  {
+    if(!nThreads || nThreads > n)
+      nThreads = n;
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for(size_t iThread = 0; iThread < nThreads; ++iThread)
+      {
+        workers.emplace_back([&]()
+          {
+            for(size_t i = next++; i < n; i = next++)
+              f(i);
+          });
+      }
+    for(auto& w : workers)
+      w.join();
+  }
+
+
+  struct TreeMerge
+  {
+    std::string directory;
+    std::string tempFile;
+    long long nEntries;
+    bool hasIndex;
+    uwvv::EventIndex index;
+    std::string error;
+  };
+
+
+  // Fast-clone one channel's ntuples into their own file, and combine
+  // their indices if they all have one
+  void mergeTree(const std::vector<std::string>& inputs, TreeMerge& merge)
+  {
+    merge.hasIndex = true;
+    for(const auto& f : inputs)
+      {
+        TFile in(f.c_str());
+        TDirectory* d = in.GetDirectory(merge.directory.c_str());
+        uwvv::EventIndex fileIndex;
+        if(!(d && uwvv::EventIndex::read(*d, fileIndex)))
+          {
+            merge.hasIndex = false;
+            break;
+          }
+        merge.index.append(fileIndex);
+      }
+
+    TChain chain((merge.directory + "/ntuple").c_str());
+    for(const auto& f : inputs)
+      chain.Add(f.c_str());
+
+    TFile out(merge.tempFile.c_str(), "recreate");
+    TTree* merged = chain.CloneTree(-1, "fast");
+    if(!merged)
+      throw std::runtime_error("Can't merge " + merge.directory + "/ntuple");
+    merged->SetDirectory(&out);
+    merged->SetName("ntuple");
+    merged->Write();
+    merge.nEntries = merged->GetEntries();
+    out.Close();
+
+    if(merge.hasIndex && Long64_t(merge.index.treeEntries()) != merge.nEntries)
+      merge.hasIndex = false;
+  }
+
+
+  struct LumiSums
+  {
+    LumiSums() : nevents(0), summedWeights(0.) {;}
+
+    unsigned nevents;
+    double summedWeights;
+    std::vector<double> summedLHEWeights;
+  };
+
+  struct MetaMerge
+  {
+    std::string directory;
+    std::map<std::pair<unsigned, unsigned>, LumiSums> lumis;
+    bool hasLHEWeights;
+    bool hasIndex;
+    std::string datasetName;
+  };
+
+
+  // Sum the rows of one meta tree over all inputs by run and lumi
+  void mergeMeta(const std::vector<std::string>& inputs, MetaMerge& merge)
+  {
+    merge.hasLHEWeights = false;
+    merge.hasIndex = true;
+
+    for(const auto& f : inputs)
+      {
+        TFile in(f.c_str());
+        TDirectory* d = in.GetDirectory(merge.directory.c_str());
+        TTree* t = 0;
+        if(d)
+          d->GetObject("metaInfo", t);
+        if(!t)
+          throw std::runtime_error(f + " has no " + merge.directory +
+                                   "/metaInfo");
+
+        TTree* lumiIndex = 0;
+        d->GetObject("lumiIndex", lumiIndex);
+        merge.hasIndex = merge.hasIndex && lumiIndex;
+
+        // Kept from the first input that has one
+        TDirectory* nameDir = d->GetDirectory("datasetName");
+        if(nameDir && nameDir->GetListOfKeys()->GetSize())
+          {
+            std::string name =
+              static_cast<TKey*>(nameDir->GetListOfKeys()->First())->GetName();
+            if(merge.datasetName.empty())
+              merge.datasetName = name;
+            else if(name != merge.datasetName)
+              std::cerr << "Warning: " << f << " is from dataset " << name
+                        << ", not " << merge.datasetName << "; keeping "
+                        << merge.datasetName << std::endl;
+          }
+
+        unsigned run = 0;
+        unsigned lumi = 0;
+        unsigned nevents = 0;
+        float summedWeights = 0.;
+        std::vector<double>* summedLHEWeights = 0;
+        t->SetBranchAddress("run", &run);
+        t->SetBranchAddress("lumi", &lumi);
+        t->SetBranchAddress("nevents", &nevents);
+        t->SetBranchAddress("summedWeights", &summedWeights);
+        if(t->GetBranch("summedLHEWeights"))
+          {
+            t->SetBranchAddress("summedLHEWeights", &summedLHEWeights);
+            merge.hasLHEWeights = true;
+          }
+
+        for(Long64_t i = 0; i < t->GetEntries(); ++i)
+          {
+            t->GetEntry(i);
+
+            LumiSums& sums = merge.lumis[std::make_pair(run, lumi)];
+            sums.nevents += nevents;
+            sums.summedWeights += summedWeights;
+            if(summedLHEWeights)
+              {
+                if(summedLHEWeights->size() > sums.summedLHEWeights.size())
+                  sums.summedLHEWeights.resize(summedLHEWeights->size(), 0.);
+                for(size_t iW = 0; iW < summedLHEWeights->size(); ++iW)
+                  sums.summedLHEWeights[iW] += summedLHEWeights->at(iW);
+              }
+          }
+
+        t->ResetBranchAddresses();
+        delete summedLHEWeights;
+      }
+  }
+
+
+  void writeMeta(const MetaMerge& merge, TFile& out)
+  {
+    TDirectory* d = out.mkdir(merge.directory.c_str());
+    d->cd();
+
+    unsigned run = 0;
+    unsigned lumi = 0;
+    unsigned nevents = 0;
+    float summedWeights = 0.;
+    std::vector<double> summedLHEWeights;
+
+    TTree* t = new TTree("metaInfo", "metaInfo");
+    t->Branch("run", &run);
+    t->Branch("lumi", &lumi);
+    t->Branch("nevents", &nevents);
+    t->Branch("summedWeights", &summedWeights);
+    if(merge.hasLHEWeights)
+      t->Branch("summedLHEWeights", &summedLHEWeights);
+
+    uwvv::EventIndex index;
+    for(const auto& row : merge.lumis)
+      {
+        run = row.first.first;
+        lumi = row.first.second;
+        nevents = row.second.nevents;
+        summedWeights = row.second.summedWeights;
+        summedLHEWeights = row.second.summedLHEWeights;
+        t->Fill();
+
+        index.add(run, lumi, 0, t->GetEntries() - 1);
+      }
+    t->Write();
+
+    if(merge.hasIndex)
+      {
+        TTree* indexTree = new TTree("lumiIndex", "lumiIndex");
+        index.sort();
+        index.fill(*indexTree);
+        indexTree->Write();
+      }
+
+    if(!merge.datasetName.empty())
+      {
+        TDirectory* nameDir = d->mkdir("datasetName");
+        nameDir->cd();
+        TObjString(merge.datasetName.c_str()).Write();
+      }
+  }
+
+
+  struct MergeStats
+  {
+    MergeStats() : nFiles(0), nEntries(0) {;}
+
+    size_t nFiles;
+    long long nEntries;
+  };
+
+
+  // Merge the inputs into the output, with each channel on its own thread
+  MergeStats mergeFiles(const std::vector<std::string>& inputs,
+                        const std::string& output, size_t nThreads)
+  {
+    std::vector<std::string> trees;
+    std::vector<std::string> metas;
+    std::vector<std::string> others;
+    {
+      TFile first(inputs.front().c_str());
+      if(first.IsZombie())
+        throw std::runtime_error("Can't open " + inputs.front());
+      trees = uwvv::ntupleFiles::directoriesWith(first, "ntuple");
+      metas = uwvv::ntupleFiles::directoriesWith(first, "metaInfo");
+    }
+
+    // Everything else is merged like hadd would
+    for(const auto& d : uwvv::ntupleFiles::topDirectories(inputs))
+      {
+        if(std::find(trees.begin(), trees.end(), d) == trees.end() &&
+           std::find(metas.begin(), metas.end(), d) == metas.end())
+          others.push_back(d);
+      }
+
+    std::vector<TreeMerge> treeMerges(trees.size());
+    for(size_t i = 0; i < trees.size(); ++i)
+      {
+        treeMerges[i].directory = trees[i];
+        treeMerges[i].tempFile = output + ".tmp_" + trees[i] + ".root";
+        treeMerges[i].nEntries = 0;
+        treeMerges[i].hasIndex = false;
+      }
+
+    std::vector<MetaMerge> metaMerges(metas.size());
+    for(size_t i = 0; i < metas.size(); ++i)
+      metaMerges[i].directory = metas[i];
+
+    // Channels on the workers, the (small) meta trees on this thread
+    std::thread channelThread([&]()
+      {
+        parallelFor(treeMerges.size(), nThreads, [&](size_t i)
+          {
+            try
+              {
+                mergeTree(inputs, treeMerges[i]);
+              }
+            catch(const std::exception& e)
+              {
+                treeMerges[i].error = e.what();
+              }
+          });
+      });
+
+    std::string metaError;
+    try
+      {
+        for(auto& m : metaMerges)
+          mergeMeta(inputs, m);
+      }
+    catch(const std::exception& e)
+      {
+        metaError = e.what();
+      }
+
+    channelThread.join();
+
+    if(!metaError.empty())
+      throw std::runtime_error(metaError);
+    for(const auto& m : treeMerges)
+      {
+        if(!m.error.empty())
+          throw std::runtime_error(m.directory + ": " + m.error);
+      }
+
+    // Gather
+    MergeStats stats;
+    stats.nFiles = inputs.size();
+
+    TFile out(output.c_str(), "recreate");
+    for(const auto& m : treeMerges)
+      {
+        TFile in(m.tempFile.c_str());
+        TTree* t = static_cast<TTree*>(in.Get("ntuple"));
+        if(!t)
+          throw std::runtime_error(m.directory + ": merged tree is missing");
+
+        TDirectory* d = out.mkdir(m.directory.c_str());
+        d->cd();
+        TTree* copy = t->CloneTree(-1, "fast");
+        if(!copy)
+          throw std::runtime_error(m.directory + ": can't copy merged tree");
+        copy->SetDirectory(d);
+        copy->Write();
+
+        if(m.hasIndex)
+          {
+            TTree* indexTree = new TTree("eventIndex", "eventIndex");
+            m.index.fill(*indexTree);
+            indexTree->Write();
+          }
+
+        in.Close();
+        std::remove(m.tempFile.c_str());
+
+        stats.nEntries += m.nEntries;
+      }
+
+    for(const auto& m : metaMerges)
+      writeMeta(m, out);
+
+    for(const auto& o : others)
+      {
+        TDirectory* d = out.mkdir(o.c_str());
+        uwvv::ntupleFiles::mergeDirectory(inputs, o, *d);
+      }
+
+    out.Close();
+
+    return stats;
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  size_t nThreads = std::thread::hardware_concurrency();
+  size_t fanIn = 500;
+  std::vector<std::string> positional;
+
+  for(int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if((arg == "-j" || arg == "-f") && i + 1 < argc)
+        {
+          unsigned long val = std::strtoul(argv[++i], 0, 10);
+          if(arg == "-j")
+            nThreads = val;
+          else
+            fanIn = std::max(val, 2UL);
+        }
+      else
+        positional.push_back(arg);
+    }
+
+  if(positional.size() < 2)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [-j nThreads] [-f fanIn] output input [input ...]"
+                << std::endl;
+      return 1;
+    }
+
+  const std::string outName = positional[0];
+  std::vector<std::string> inputs;
+  for(size_t i = 1; i < positional.size(); ++i)
+    {
+      std::vector<std::string> found = uwvv::ntupleFiles::expand(positional[i]);
+      if(found.empty())
+        std::cerr << "Warning: no files found matching " << positional[i]
+                  << std::endl;
+      inputs.insert(inputs.end(), found.begin(), found.end());
+    }
+  if(inputs.empty())
+    {
+      std::cerr << "No input files" << std::endl;
+      return 1;
+    }
+
+  ROOT::EnableThreadSafety();
+
+  auto start = std::chrono::steady_clock::now();
+
+  MergeStats stats;
+  std::vector<std::string> tempFiles;
+  try
+    {
+      // Reduce groups of fanIn files into temporary files until the rest
+      // can be merged at once
+      for(unsigned level = 0; inputs.size() > fanIn; ++level)
+        {
+          const size_t nGroups = (inputs.size() + fanIn - 1) / fanIn;
+          std::vector<std::string> groupOutputs(nGroups);
+          std::vector<std::string> errors(nGroups);
+
+          parallelFor(nGroups, nThreads, [&](size_t iGroup)
+            {
+              auto begin = inputs.begin() + iGroup * fanIn;
+              auto end = inputs.begin() + std::min((iGroup + 1) * fanIn, inputs.size());
+
+              groupOutputs[iGroup] = (outName + ".tmp_L" + std::to_string(level) +
+                                      "_" + std::to_string(iGroup) + ".root");
+              try
+                {
+                  mergeFiles(std::vector<std::string>(begin, end),
+                             groupOutputs[iGroup], 1);
+                }
+              catch(const std::exception& e)
+                {
+                  errors[iGroup] = e.what();
+                }
+            });
+
+          for(const auto& e : errors)
+            {
+              if(!e.empty())
+                throw std::runtime_error(e);
+            }
+
+          std::cout << "Merged " << inputs.size() << " files into "
+                    << nGroups << " temporary files" << std::endl;
+
+          // Intermediate files from the level before aren't needed now
+          for(const auto& f : tempFiles)
+            std::remove(f.c_str());
+          tempFiles = groupOutputs;
+          inputs = groupOutputs;
+        }
+
+      stats = mergeFiles(inputs, outName, nThreads);
+    }
+  catch(const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+      for(const auto& f : tempFiles)
+        std::remove(f.c_str());
+      return 1;
+    }
+
+  for(const auto& f : tempFiles)
+    std::remove(f.c_str());
+
+  const double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "Merged into " << outName << ": " << stats.nEntries
+            << " ntuple rows in " << seconds << " s" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    ntupleHists                                                          //
+//                                                                         //
+//    Fill histograms of ntuple columns for one channel, on all cores,     //
+//    with the compiled reader (UWVV/Utilities/interface/NtupleReader.h).  //
+//    Meant for quick studies that would otherwise be a python loop.       //
+//                                                                         //
+//    Usage: uwvvNtupleHists [options] channel input output hist [...]     //
+//        input: comma-separated list of files, may contain wildcards      //
+//        hist: column:nBins:low:high for 1D, or                           //
+//              x:nBins:low:high:y:nBins:low:high for 2D                   //
+//              columns may use Z1 and Z2, e.g. Z1Mass:60:60:120           //
+//    Options:                                                             //
+//        -j N: number of threads (default: number of cores)               //
+//        -c cut: only rows passing, e.g. "Z1Mass > 60 && e1Pt > 20"       //
+//        -w column: weight each row by this column                        //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+#include "UWVV/Utilities/interface/NtupleReader.h"
+
+
+namespace
+{
+  std::vector<std::string> splitSpec(const std::string& spec)
+  {
+    std::vector<std::string> out;
+    std::stringstream ss(spec);
+    std::string field;
+    while(std::getline(ss, field, ':'))
+      out.push_back(field);
+
+    return out;
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  unsigned nThreads = 0;
+  std::string cut;
+  std::string weight;
+  std::vector<std::string> positional;
+
+  for(int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if(arg == "-j" && i + 1 < argc)
+        nThreads = std::strtoul(argv[++i], 0, 10);
+      else if(arg == "-c" && i + 1 < argc)
+        cut = argv[++i];
+      else if(arg == "-w" && i + 1 < argc)
+        weight = argv[++i];
+      else
+        positional.push_back(arg);
+    }
+
+  if(positional.size() < 4)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [-j nThreads] [-c cut] [-w weight] channel input output"
+                << " column:nBins:low:high [...]" << std::endl;
+      return 1;
+    }
+
+  const std::string channel = positional[0];
+  const std::vector<std::string> files = uwvv::ntupleFiles::expand(positional[1]);
+  if(files.empty())
+    {
+      std::cerr << "No files found matching " << positional[1] << std::endl;
+      return 1;
+    }
+  const std::string outName = positional[2];
+
+  try
+    {
+      const uwvv::ntuple::Selection selection(cut);
+
+      uwvv::ntuple::Processor processor(files, channel, nThreads);
+
+      uwvv::ntuple::Counter counter(selection, weight);
+      processor.add(counter);
+
+      std::vector<std::unique_ptr<uwvv::ntuple::Hist1D> > hists1D;
+      std::vector<std::unique_ptr<uwvv::ntuple::Hist2D> > hists2D;
+      for(size_t i = 3; i < positional.size(); ++i)
+        {
+          const std::vector<std::string> f = splitSpec(positional[i]);
+          if(f.size() == 4)
+            {
+              hists1D.emplace_back(new uwvv::ntuple::Hist1D(f[0], f[0],
+                                                            std::stoul(f[1]),
+                                                            std::stod(f[2]),
+                                                            std::stod(f[3]),
+                                                            selection, weight));
+              processor.add(*hists1D.back());
+            }
+          else if(f.size() == 8)
+            {
+              hists2D.emplace_back(new uwvv::ntuple::Hist2D(f[4] + "_vs_" + f[0],
+                                                            f[0], std::stoul(f[1]),
+                                                            std::stod(f[2]),
+                                                            std::stod(f[3]),
+                                                            f[4], std::stoul(f[5]),
+                                                            std::stod(f[6]),
+                                                            std::stod(f[7]),
+                                                            selection, weight));
+              processor.add(*hists2D.back());
+            }
+          else
+            {
+              std::cerr << "Can't understand histogram " << positional[i]
+                        << " (should be column:nBins:low:high or "
+                        << "x:nBins:low:high:y:nBins:low:high)" << std::endl;
+              return 1;
+            }
+        }
+
+      const uwvv::ntuple::Processor::Stats stats = processor.run();
+
+      TFile out(outName.c_str(), "recreate");
+      for(const auto& h : hists1D)
+        h->hist().Write();
+      for(const auto& h : hists2D)
+        h->hist().Write();
+      out.Close();
+
+      std::cout << counter.count() << " of " << stats.nEntries
+                << " rows pass";
+      if(!weight.empty())
+        std::cout << " (sum of weights " << counter.sumOfWeights() << ")";
+      std::cout << std::endl
+                << "Read " << stats.nFiles << " files in " << stats.nBlocks
+                << " blocks in " << stats.seconds << " s: "
+                << stats.nEntries / stats.seconds << " rows/s, "
+                << stats.bytesRead / stats.seconds / (1 << 20) << " MB/s"
+                << std::endl;
+    }
+  catch(const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,319 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    pickEvents                                                           //
+//                                                                         //
+//    Copy the rows of a list of events from every channel ntuple in a     //
+//    set of files into one new file, without scanning the trees: each     //
+//    file's event index (see UWVV/Utilities/interface/EventIndex.h) is    //
+//    used to find the entries, and built from the run, lumi, and evt      //
+//    branches if the file doesn't have one. Files are done in parallel.   //
+//                                                                         //
+//    Usage: uwvvPickEvents [options] eventList input output               //
+//        eventList: text file with one run:lumi:evt per line (spaces      //
+//                   or commas work too; # starts a comment)               //
+//        input: comma-separated list of files, may contain wildcards      //
+//               (matches are taken in sorted order)                       //
+//    Options:                                                             //
+//        -j N: number of files to do at once (default: number of cores)   //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TChain.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include "UWVV/Utilities/interface/EventIndex.h"
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+
+
+namespace
+{
+  // Same format edmPickEvents takes
+  std::vector<uwvv::EventID> readEventList(const std::string& fileName)
+  {
+    std::ifstream in(fileName.c_str());
+    if(!in)
+      throw std::runtime_error("Can't open event list " + fileName);
+
+    std::vector<uwvv::EventID> out;
+    std::string line;
+    for(size_t iLine = 1; std::getline(in, line); ++iLine)
+      {
+        line = line.substr(0, line.find('#'));
+        std::replace(line.begin(), line.end(), ':', ' ');
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        std::istringstream fields(line);
+        uwvv::EventID id;
+        std::string extra;
+        if(!(fields >> id.run))
+          continue; // blank
+        if(!(fields >> id.lumi >> id.evt) || (fields >> extra))
+          throw std::runtime_error("Can't understand line " +
+                                   std::to_string(iLine) + " of " + fileName +
+                                   " (should be run:lumi:evt)");
+
+        out.push_back(id);
+      }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+
+    return out;
+  }
+
+
+  struct FileResult
+  {
+    std::string tempFile;
+    std::vector<std::string> channels; // with picked rows in tempFile
+    long long nEntries;                // in all channel trees
+    long long nPicked;
+    long long bytesRead;
+    bool builtIndex;                   // for at least one channel
+    std::set<uwvv::EventID> found;
+    std::string error;
+  };
+
+
+  void pickFromFile(const std::string& fileName,
+                    const std::vector<uwvv::EventID>& events,
+                    FileResult& result)
+  {
+    TFile in(fileName.c_str());
+    if(in.IsZombie())
+      throw std::runtime_error("Can't open " + fileName);
+
+    std::unique_ptr<TFile> out;
+
+    for(const std::string& channel : uwvv::ntupleFiles::directoriesWith(in, "ntuple"))
+      {
+        TDirectory* d = in.GetDirectory(channel.c_str());
+        TTree* tree = 0;
+        d->GetObject("ntuple", tree);
+        result.nEntries += tree->GetEntries();
+
+        uwvv::EventIndex index;
+        if(!uwvv::EventIndex::read(*d, index) ||
+           Long64_t(index.treeEntries()) != tree->GetEntries())
+          {
+            index = uwvv::EventIndex::build(*tree);
+            result.builtIndex = true;
+          }
+
+        std::vector<uint64_t> entries;
+        for(const auto& id : events)
+          {
+            auto found = index.find(id);
+            if(found.first == found.second)
+              continue;
+
+            result.found.insert(id);
+            for(auto r = found.first; r != found.second; ++r)
+              {
+                for(uint64_t i = r->first; i < r->first + r->n; ++i)
+                  entries.push_back(i);
+              }
+          }
+
+        if(entries.empty())
+          continue;
+
+        // read in entry order
+        std::sort(entries.begin(), entries.end());
+
+        if(!out)
+          out.reset(new TFile(result.tempFile.c_str(), "recreate"));
+        TDirectory* outDir = out->mkdir(channel.c_str());
+        outDir->cd();
+
+        TTree* picked = tree->CloneTree(0);
+        picked->SetDirectory(outDir);
+        for(uint64_t i : entries)
+          {
+            tree->GetEntry(i);
+            picked->Fill();
+          }
+        picked->Write();
+
+        result.channels.push_back(channel);
+        result.nPicked += entries.size();
+      }
+
+    result.bytesRead = in.GetBytesRead();
+
+    if(out)
+      out->Close();
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  size_t nThreads = std::thread::hardware_concurrency();
+  std::vector<std::string> positional;
+
+  for(int i = 1; i < argc; ++i)
+    {
+      std::string arg = argv[i];
+      if(arg == "-j" && i + 1 < argc)
+        nThreads = std::strtoul(argv[++i], 0, 10);
+      else
+        positional.push_back(arg);
+    }
+
+  if(positional.size() != 3)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [-j nThreads] eventList input output" << std::endl;
+      return 1;
+    }
+
+  std::vector<uwvv::EventID> events;
+  try
+    {
+      events = readEventList(positional[0]);
+    }
+  catch(const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+  const std::vector<std::string> files = uwvv::ntupleFiles::expand(positional[1]);
+  if(files.empty())
+    {
+      std::cerr << "No files found matching " << positional[1] << std::endl;
+      return 1;
+    }
+  const std::string outName = positional[2];
+
+  ROOT::EnableThreadSafety();
+
+  std::vector<FileResult> results(files.size());
+  for(size_t i = 0; i < files.size(); ++i)
+    {
+      results[i].tempFile = outName + ".tmp_" + std::to_string(i) + ".root";
+      results[i].nEntries = results[i].nPicked = results[i].bytesRead = 0;
+      results[i].builtIndex = false;
+    }
+
+  if(!nThreads || nThreads > files.size())
+    nThreads = files.size();
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::atomic<size_t> nextFile(0);
+  std::vector<std::thread> workers;
+  for(size_t iThread = 0; iThread < nThreads; ++iThread)
+    {
+      workers.emplace_back([&]()
+        {
+          for(size_t i = nextFile++; i < files.size(); i = nextFile++)
+            {
+              try
+                {
+                  pickFromFile(files[i], events, results[i]);
+                }
+              catch(const std::exception& e)
+                {
+                  results[i].error = e.what();
+                }
+            }
+        });
+    }
+  for(auto& w : workers)
+    w.join();
+
+  // Gather each channel's picked rows, in file order
+  int status = 0;
+  std::map<std::string, std::vector<std::string> > tempFilesByChannel;
+  std::set<uwvv::EventID> found;
+  long long nEntries = 0;
+  long long nPicked = 0;
+  long long bytesRead = 0;
+  size_t nBuilt = 0;
+  for(size_t i = 0; i < files.size(); ++i)
+    {
+      const FileResult& r = results[i];
+      if(!r.error.empty())
+        {
+          std::cerr << files[i] << ": " << r.error << std::endl;
+          status = 1;
+        }
+
+      for(const auto& c : r.channels)
+        tempFilesByChannel[c].push_back(r.tempFile);
+      found.insert(r.found.begin(), r.found.end());
+      nEntries += r.nEntries;
+      nPicked += r.nPicked;
+      bytesRead += r.bytesRead;
+      nBuilt += r.builtIndex;
+    }
+
+  TFile out(outName.c_str(), "recreate");
+  for(const auto& chanFiles : tempFilesByChannel)
+    {
+      TChain chain((chanFiles.first + "/ntuple").c_str());
+      for(const auto& f : chanFiles.second)
+        chain.Add(f.c_str());
+
+      TDirectory* d = out.mkdir(chanFiles.first.c_str());
+      d->cd();
+      TTree* merged = chain.CloneTree(-1, "fast");
+      merged->SetDirectory(d);
+      merged->Write();
+    }
+  out.Close();
+
+  for(const auto& r : results)
+    {
+      if(!r.channels.empty())
+        std::remove(r.tempFile.c_str());
+    }
+
+  const double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "Found " << found.size() << " of " << events.size()
+            << " events (" << nPicked << " rows) in " << files.size()
+            << " files (" << nBuilt << " without an index)" << std::endl
+            << "Took " << seconds << " s: "
+            << files.size() / seconds << " files/s, "
+            << nEntries / seconds << " ntuple rows/s, "
+            << bytesRead / seconds / (1 << 20) << " MB/s read" << std::endl;
+
+  if(found.size() != events.size())
+    {
+      std::cout << "Not found:" << std::endl;
+      for(const auto& id : events)
+        {
+          if(!found.count(id))
+            std::cout << "    " << id.run << ":" << id.lumi << ":" << id.evt
+                      << std::endl;
+        }
+    }
+
+  return status;
+}
@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    printCutflow                                                         //
+//                                                                         //
+//    Print the cutflow table for every CutflowCounter in a set of files   //
+//    (e.g. flowCutflow): the counts per event of each module, the         //
+//    modules that remove the most objects, and the cuts that might go     //
+//    earlier. Rows for the same step, module, and collection are summed,  //
+//    so the table is right for merged files and for the outputs of        //
+//    several jobs given together.                                         //
+//                                                                         //
+//    Usage: uwvvPrintCutflow input [directory]                            //
+//        input: comma-separated list of files, may contain wildcards      //
+//        directory: only print the counter in this directory              //
+//                                                                         //
+//    Nate Woods, U. Wisconsin                                             //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+
+#include "UWVV/Utilities/interface/CutflowTable.h"
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+
+
+int main(int argc, char** argv)
+{
+  if(argc < 2 || argc > 3)
+    {
+      std::cerr << "Usage: " << argv[0] << " input [directory]" << std::endl;
+      return 1;
+    }
+
+  const std::vector<std::string> files = uwvv::ntupleFiles::expand(argv[1]);
+  if(files.empty())
+    {
+      std::cerr << "No files found matching " << argv[1] << std::endl;
+      return 1;
+    }
+
+  try
+    {
+      // Directories with a cutflow tree in any of the files
+      std::vector<std::string> dirs;
+      for(const auto& name : files)
+        {
+          std::unique_ptr<TFile> f(TFile::Open(name.c_str()));
+          if(!f || f->IsZombie())
+            throw std::runtime_error("Can't open " + name);
+
+          for(const auto& dir : uwvv::ntupleFiles::directoriesWith(*f, "cutflow"))
+            if(std::find(dirs.begin(), dirs.end(), dir) == dirs.end())
+              dirs.push_back(dir);
+        }
+
+      if(argc == 3)
+        {
+          if(std::find(dirs.begin(), dirs.end(), argv[2]) == dirs.end())
+            throw std::runtime_error(std::string("No cutflow tree in ") + argv[2]);
+          dirs.assign(1, argv[2]);
+        }
+
+      if(dirs.empty())
+        throw std::runtime_error("No cutflow trees found");
+
+      for(const auto& dir : dirs)
+        {
+          TChain chain((dir + "/cutflow").c_str());
+          for(const auto& name : files)
+            chain.Add(name.c_str());
+
+          std::cout << dir << ":" << std::endl
+                    << uwvv::cutflow::makeTable(uwvv::cutflow::readTree(chain))
+                    << std::endl;
+        }
+    }
+  catch(const std::exception& e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////
+//                                                                         //
+//    userDataIndexBenchmark                                               //
+//                                                                         //
+//    Times userFloat reads from a muon carrying as many userFloats as     //
+//    the analysis chain embeds (~100) three ways: through                 //
+//    StringObjectFunction (how branches used to be filled), through       //
+//    pat::Muon::userFloat, and through uwvv::UserDataIndex, and checks    //
+//    that they all agree.                                                 //
+//                                                                         //
+//    Usage: uwvvUserDataIndexBenchmark [nUserFloats] [nRepetitions]       //
+//                                                                         //
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "UWVV/Utilities/interface/UserDataIndex.h"
+
+
+namespace
+{
+  template<typename F>
+  double timeIt(F f, size_t nReps)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nReps; ++i)
+      f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  // Returns the number of disagreements
+  size_t compare(const std::string& expression,
+                 const std::vector<pat::Muon>& muons, size_t nReps)
+  {
+    uwvv::userData::Expression expr;
+    if(!uwvv::userData::parse(expression, expr))
+      {
+        std::cout << expression << std::endl
+                  << "  not understood by userData::parse()" << std::endl;
+        return 1;
+      }
+
+    const StringObjectFunction<pat::Muon, true> interpreted(expression);
+    const uwvv::UserDataIndex<pat::Muon, uwvv::userData::Type::Float> indexed(expr.name);
+
+    std::vector<double> oldVals(muons.size());
+    std::vector<double> patVals(muons.size());
+    std::vector<double> newVals(muons.size());
+
+    double tOld = timeIt([&]()
+      {
+        for(size_t i = 0; i < muons.size(); ++i)
+          oldVals[i] = interpreted(muons[i]);
+      }, nReps);
+    double tPAT = timeIt([&]()
+      {
+        for(size_t i = 0; i < muons.size(); ++i)
+          patVals[i] = (muons[i].hasUserFloat(expr.name) ?
+                        muons[i].userFloat(expr.name) : expr.defaultVal);
+      }, nReps);
+    double tNew = timeIt([&]()
+      {
+        for(size_t i = 0; i < muons.size(); ++i)
+          newVals[i] = (indexed.has(muons[i]) ?
+                        indexed.get(muons[i]) : expr.defaultVal);
+      }, nReps);
+
+    size_t nBad = 0;
+    for(size_t i = 0; i < muons.size(); ++i)
+      {
+        if(oldVals[i] != newVals[i] || patVals[i] != newVals[i])
+          ++nBad;
+      }
+
+    const double nEvals = double(muons.size()) * nReps;
+    std::cout << expression << std::endl
+              << "  StringObjectFunction: " << 1.e9 * tOld / nEvals
+              << " ns/read" << std::endl
+              << "  pat::Muon::userFloat: " << 1.e9 * tPAT / nEvals
+              << " ns/read" << std::endl
+              << "  UserDataIndex:        " << 1.e9 * tNew / nEvals
+              << " ns/read (" << tOld / tNew << "x, "
+              << indexed.nSearches() << " searches)" << std::endl
+              << "  mismatches: " << nBad << std::endl;
+
+    return nBad;
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  const size_t nUserFloats = (argc > 1 ? std::strtoul(argv[1], 0, 10) : 100);
+  const size_t nReps = (argc > 2 ? std::strtoul(argv[2], 0, 10) : 10000);
+  const size_t nMuons = 20;
+
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<float> valDist(0., 1.);
+
+  // Every muon gets the same user data in the same order, like a
+  // collection that went through the embedder chain
+  std::vector<pat::Muon> muons(nMuons);
+  for(auto& mu : muons)
+    {
+      for(size_t i = 0; i + 3 < nUserFloats; ++i)
+        mu.addUserFloat("embedded" + std::to_string(i), valDist(gen));
+
+      mu.addUserFloat("ZZIsoVal", valDist(gen));
+      mu.addUserFloat("ZZIDPassTight", valDist(gen) > 0.3);
+      mu.addUserFloat("kalmanPtError", valDist(gen));
+    }
+  // and one that missed an embedder
+  muons.back() = pat::Muon();
+  muons.back().addUserFloat("ZZIDPassTight", 1.);
+
+  size_t nBad = 0;
+  nBad += compare("? hasUserFloat(\"ZZIsoVal\") ? userFloat(\"ZZIsoVal\") : 999.",
+                  muons, nReps);
+  nBad += compare("? hasUserFloat(\"ZZIDPassTight\") ? userFloat(\"ZZIDPassTight\") : 0.",
+                  muons, nReps);
+  nBad += compare("? hasUserFloat(\"kalmanPtError\") ? userFloat(\"kalmanPtError\") : -1.",
+                  muons, nReps);
+  nBad += compare("? hasUserFloat(\"embedded0\") ? userFloat(\"embedded0\") : -1.",
+                  muons, nReps);
+
+  return nBad ? 1 : 0;
+}
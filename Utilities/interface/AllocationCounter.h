@@ -0,0 +1,34 @@
+#ifndef UWVV_Utilities_AllocationCounter_h
+#define UWVV_Utilities_AllocationCounter_h
+
+// Number of operator new calls made so far in this process. Counting only
+// happens if the job was started with the counting library preloaded,
+//     LD_PRELOAD=$CMSSW_BASE/lib/$SCRAM_ARCH/libUWVVAllocationCounter.so cmsRun ...
+// (see UWVV/AllocationCounter); otherwise active() is false and count() is
+// always 0.
+
+
+// Defined by the preloaded library, if there is one
+extern "C" unsigned long long uwvvAllocationCount() __attribute__((weak));
+
+
+namespace uwvv
+{
+
+  namespace allocationCounter
+  {
+    inline bool active()
+    {
+      return uwvvAllocationCount != nullptr;
+    }
+
+    inline unsigned long long count()
+    {
+      return active() ? uwvvAllocationCount() : 0;
+    }
+  } // namespace allocationCounter
+
+} // namespace uwvv
+
+
+#endif // header guard
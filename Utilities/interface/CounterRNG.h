@@ -0,0 +1,58 @@
+#ifndef UWVV_Utilities_CounterRNG_h
+#define UWVV_Utilities_CounterRNG_h
+
+// Counter-based random numbers (Philox4x32-10, Salmon et al., SC11).
+// The output is a pure function of a key and a counter, so there is no
+// generator state to set up, seed or share between threads, and the same
+// inputs give the same numbers no matter which stream or in which order
+// events are processed.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace uwvv
+{
+
+  namespace random
+  {
+    typedef std::array<uint32_t, 4> PhiloxCounter;
+    typedef std::array<uint32_t, 2> PhiloxKey;
+
+    // The Philox4x32 bijection with 10 rounds
+    PhiloxCounter philox4x32(PhiloxCounter ctr, PhiloxKey key);
+
+
+    // Random numbers for one event, keyed on (run, lumi, event) and a
+    // module-specific seed. Item i (e.g. the index of a jet in its
+    // collection) always gets the same number.
+    class EventRandom
+    {
+     public:
+      EventRandom(uint32_t run, uint32_t lumi, uint64_t event, uint32_t seed = 0);
+      ~EventRandom() {;}
+
+      // Uniform in (0, 1]
+      double uniform(uint32_t i) const;
+
+      // Standard normal
+      float gaussian(uint32_t i) const;
+
+      // Standard normal numbers for items 0 to n-1, four per generator call
+      void gaussians(size_t n, float* out) const;
+
+     private:
+      PhiloxCounter block(uint32_t iBlock) const;
+
+      const PhiloxKey key;
+      const uint32_t lumi;
+      const uint64_t event;
+    };
+
+  } // namespace random
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,71 @@
+#ifndef UWVV_Utilities_CutflowTable_h
+#define UWVV_Utilities_CutflowTable_h
+
+// Cutflow counts as written by CutflowCounter (a "cutflow" tree with one row
+// per module and collection), and the text table made from them. The table
+// is always made from the tree, so files from several jobs (merged or not)
+// give the summed counts.
+
+#include <string>
+#include <vector>
+
+class TTree;
+
+
+namespace uwvv
+{
+
+  namespace cutflow
+  {
+    struct Counts
+    {
+      Counts() : nEvents(0), nIn(0), nOut(0), nEventsIn(0), nEventsOut(0),
+                 nMissing(0) {;}
+
+      void add(const Counts& other)
+      {
+        nEvents += other.nEvents;
+        nIn += other.nIn;
+        nOut += other.nOut;
+        nEventsIn += other.nEventsIn;
+        nEventsOut += other.nEventsOut;
+        nMissing += other.nMissing;
+      }
+
+      unsigned long long nEvents;
+      unsigned long long nIn;        // objects in, summed over events
+      unsigned long long nOut;       // objects out
+      unsigned long long nEventsIn;  // events with at least one object in
+      unsigned long long nEventsOut; // events with at least one object out
+      unsigned long long nMissing;   // events where the output wasn't made
+    };
+
+    // What one module did to one collection
+    struct Row
+    {
+      std::string step;
+      std::string module;
+      std::string object;
+      bool newObject; // the module made the collection rather than cut it
+      Counts counts;
+    };
+
+    // Add a branch for every field of row to tree
+    void branchTree(TTree& tree, Row& row);
+
+    // The rows of a cutflow tree, in the order they first appear, with the
+    // counts of rows for the same step, module and object (e.g. from
+    // several jobs) summed
+    std::vector<Row> readTree(TTree& tree);
+
+    // Counts per event for every row, then the modules that remove the
+    // most objects and the cuts that drop objects several earlier modules
+    // already worked on (candidates to move earlier)
+    std::string makeTable(const std::vector<Row>& rows);
+
+  } // namespace cutflow
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,175 @@
+#ifndef UWVV_Utilities_DeltaRKernels_h
+#define UWVV_Utilities_DeltaRKernels_h
+
+// Batched deltaR kernels.
+// Everything here works on structure-of-arrays eta/phi buffers in single
+// precision so the inner loops can be vectorized (SSE2 when available,
+// plain scalar loops otherwise). Use these instead of calling
+// reco::deltaR one pair at a time in loops over whole collections.
+
+#include <cstddef>
+#include <vector>
+#include <cmath>
+
+
+namespace uwvv
+{
+
+  namespace deltaR
+  {
+    // Eta and phi of a collection, stored as two contiguous arrays
+    class EtaPhiBuffer
+    {
+     public:
+      EtaPhiBuffer() {;}
+      explicit EtaPhiBuffer(size_t n) {reserve(n);}
+      ~EtaPhiBuffer() {;}
+
+      void reserve(size_t n) {eta_.reserve(n); phi_.reserve(n);}
+      void clear() {eta_.clear(); phi_.clear();}
+
+      void push_back(float eta, float phi)
+      {
+        eta_.push_back(eta);
+        phi_.push_back(phi);
+      }
+
+      // Add anything with eta() and phi()
+      template<class T>
+      void add(const T& obj) {push_back(obj.eta(), obj.phi());}
+
+      // Add every object in a collection (or edm::View)
+      template<class C>
+      void addAll(const C& coll)
+      {
+        reserve(size() + coll.size());
+        for(const auto& obj : coll)
+          add(obj);
+      }
+
+      size_t size() const {return eta_.size();}
+      bool empty() const {return eta_.empty();}
+
+      const float* eta() const {return eta_.data();}
+      const float* phi() const {return phi_.data();}
+
+     private:
+      std::vector<float> eta_;
+      std::vector<float> phi_;
+    };
+
+
+    // Same range reduction as reco::deltaPhi, for a single value
+    inline float wrapPhi(float dPhi)
+    {
+      constexpr float pi = M_PI;
+      constexpr float twoPi = 2. * M_PI;
+      constexpr float o2pi = 1. / (2. * M_PI);
+
+      if(std::abs(dPhi) <= pi)
+        return dPhi;
+
+      return dPhi - std::round(dPhi * o2pi) * twoPi;
+    }
+
+    inline float deltaR2(float eta1, float phi1, float eta2, float phi2)
+    {
+      float dEta = eta1 - eta2;
+      float dPhi = wrapPhi(phi1 - phi2);
+      return dEta * dEta + dPhi * dPhi;
+    }
+
+
+    //// One against many. out must have room for n values.
+
+    void deltaR2OneToMany(float eta, float phi,
+                          const float* etas, const float* phis, size_t n,
+                          float* out);
+
+    void deltaROneToMany(float eta, float phi,
+                         const float* etas, const float* phis, size_t n,
+                         float* out);
+
+    inline void deltaR2OneToMany(float eta, float phi, const EtaPhiBuffer& others,
+                                 std::vector<float>& out)
+    {
+      out.resize(others.size());
+      deltaR2OneToMany(eta, phi, others.eta(), others.phi(), others.size(), out.data());
+    }
+
+    inline void deltaROneToMany(float eta, float phi, const EtaPhiBuffer& others,
+                                std::vector<float>& out)
+    {
+      out.resize(others.size());
+      deltaROneToMany(eta, phi, others.eta(), others.phi(), others.size(), out.data());
+    }
+
+
+    //// Many against many. out is row-major, nA rows of nB values.
+
+    void deltaR2Matrix(const float* etasA, const float* phisA, size_t nA,
+                       const float* etasB, const float* phisB, size_t nB,
+                       float* out);
+
+    inline void deltaR2Matrix(const EtaPhiBuffer& a, const EtaPhiBuffer& b,
+                              std::vector<float>& out)
+    {
+      out.resize(a.size() * b.size());
+      deltaR2Matrix(a.eta(), a.phi(), a.size(), b.eta(), b.phi(), b.size(), out.data());
+    }
+
+
+    //// Threshold masks
+
+    // Set mask[i] to 1 for every i with deltaR < dRMax. Entries that are
+    // already set are left alone, so calling this once per object in
+    // another collection gives the union of their cones.
+    // Returns the number of entries newly set.
+    size_t markWithinDeltaR(float eta, float phi,
+                            const float* etas, const float* phis, size_t n,
+                            float dRMax, unsigned char* mask);
+
+    inline size_t markWithinDeltaR(float eta, float phi, const EtaPhiBuffer& others,
+                                   float dRMax, std::vector<unsigned char>& mask)
+    {
+      mask.resize(others.size(), 0);
+      return markWithinDeltaR(eta, phi, others.eta(), others.phi(), others.size(),
+                              dRMax, mask.data());
+    }
+
+    // True if anything in others is within dRMax of (eta, phi)
+    bool anyWithinDeltaR(float eta, float phi,
+                         const float* etas, const float* phis, size_t n,
+                         float dRMax);
+
+    inline bool anyWithinDeltaR(float eta, float phi, const EtaPhiBuffer& others,
+                                float dRMax)
+    {
+      return anyWithinDeltaR(eta, phi, others.eta(), others.phi(), others.size(), dRMax);
+    }
+
+
+    //// Reference implementations with no vectorization, for validation
+    //// and benchmarking
+
+    namespace scalar
+    {
+      void deltaR2OneToMany(float eta, float phi,
+                            const float* etas, const float* phis, size_t n,
+                            float* out);
+
+      void deltaR2Matrix(const float* etasA, const float* phisA, size_t nA,
+                         const float* etasB, const float* phisB, size_t nB,
+                         float* out);
+
+      size_t markWithinDeltaR(float eta, float phi,
+                              const float* etas, const float* phis, size_t n,
+                              float dRMax, unsigned char* mask);
+    } // namespace scalar
+
+  } // namespace deltaR
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,102 @@
+#ifndef UWVV_Utilities_DuplicateEventFinder_h
+#define UWVV_Utilities_DuplicateEventFinder_h
+
+// Finds the first occurrence of each event in a long list of (run, event)
+// numbers given in entry order, for removing the overlap between primary
+// datasets. Lumi numbers aren't needed since event numbers are unique
+// within a run.
+//
+// Events are packed into one 64-bit word (19 bits of run, 45 of event
+// number), which is exact for any run/event CMS has produced. Those are
+// kept in an open-addressing hash set (16 bytes per event), or, if that
+// would take more than the memory limit, as (key, entry) pairs sorted in
+// bounded chunks spilled to temporary files and merged at the end. The
+// (very rare) events that don't fit in 64 bits go in an exact std::set.
+//
+// Either way, the result is one bit per entry saying whether to keep it.
+
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <utility>
+#include <vector>
+
+
+namespace uwvv
+{
+
+  // Open-addressing set of nonzero 64-bit keys
+  class EventKeySet
+  {
+   public:
+    EventKeySet() : nKeys(0), mask(0) {;}
+    ~EventKeySet() {;}
+
+    // Make room for n keys without rehashing
+    void reserve(size_t n);
+
+    // True if the key wasn't there before
+    bool insert(uint64_t key);
+
+    size_t size() const {return nKeys;}
+    size_t memoryUsed() const {return slots.size() * sizeof(uint64_t);}
+
+    // Bytes needed to hold n keys
+    static size_t memoryNeeded(size_t n);
+
+   private:
+    void rehash(size_t newSize);
+
+    std::vector<uint64_t> slots;
+    size_t nKeys;
+    size_t mask;
+  };
+
+
+  class DuplicateEventFinder
+  {
+   public:
+    // nEntries is how many events will be added (for sizing things);
+    // memoryLimit (bytes) of 0 means no limit
+    DuplicateEventFinder(size_t nEntries, size_t memoryLimit = 0);
+    ~DuplicateEventFinder();
+
+    // Events must be added in entry order
+    void add(unsigned run, unsigned long long evt);
+
+    // Call once after the last add()
+    void finish();
+
+    // One entry per add(); true for the first occurrence of each event
+    const std::vector<bool>& kept() const {return keep;}
+    size_t nKept() const {return nKeptEntries;}
+
+    bool usedExternalSort() const {return external;}
+
+    // false if the event can't be packed into 64 bits
+    static bool pack(unsigned run, unsigned long long evt, uint64_t& key);
+
+   private:
+    typedef std::pair<uint64_t, uint64_t> KeyAndEntry;
+
+    void spill();
+
+    const bool external;
+    const size_t chunkSize;
+
+    std::vector<bool> keep;
+    size_t nKeptEntries;
+
+    EventKeySet keys;
+    std::set<std::pair<unsigned, unsigned long long> > unpackable;
+
+    // for the external sort
+    std::vector<KeyAndEntry> chunk;
+    std::vector<std::FILE*> spilled;
+    std::vector<size_t> spilledSizes;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
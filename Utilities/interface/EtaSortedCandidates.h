@@ -0,0 +1,44 @@
+#ifndef UWVV_Utilities_EtaSortedCandidates_h
+#define UWVV_Utilities_EtaSortedCandidates_h
+
+// The eta, phi and pt of a set of candidates (e.g. the PF candidates used
+// for an isolation sum), sorted by eta so a cone query only has to look at
+// the candidates in a narrow eta window.
+
+#include <vector>
+#include <cstddef>
+
+
+namespace uwvv
+{
+
+  class EtaSortedCandidates
+  {
+   public:
+    EtaSortedCandidates() {;}
+    ~EtaSortedCandidates() {;}
+
+    void add(float eta, float phi, float pt);
+    // Call after adding everything and before any queries
+    void sort();
+
+    size_t size() const {return eta_.size();}
+    bool empty() const {return eta_.empty();}
+    const std::vector<float>& eta() const {return eta_;}
+    const std::vector<float>& phi() const {return phi_;}
+    const std::vector<float>& pt() const {return pt_;}
+
+    // Scalar sum pt of candidates with dRVeto < deltaR < dRMax
+    double sumPtInCone(float eta, float phi, float dRMax,
+                       float dRVeto) const;
+
+   private:
+    std::vector<float> eta_;
+    std::vector<float> phi_;
+    std::vector<float> pt_;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,134 @@
+#ifndef UWVV_Utilities_EventIndex_h
+#define UWVV_Utilities_EventIndex_h
+
+// Sorted index of the (run, lumi, event) numbers in a tree, giving the
+// entries each event occupies, so events can be found without scanning.
+// An ntuple has one row per candidate, so an event is a range of
+// consecutive entries. An event may appear in more than one range if
+// trees with overlapping events were combined.
+//
+// In a file, the index is a small tree next to the one it indexes, with
+// one entry ("segment") per job that wrote it. Each segment holds the
+// ranges, delta- and varint-encoded (about 10 bytes per event, not 32),
+// and the number of entries the indexed tree had in that job. Because
+// hadd concatenates both trees in the same order, a merged file's index
+// is still valid: read() shifts each segment by the entries before it.
+// Tools that drop entries have to write a new index.
+//
+// The lumi index in metaInfo uses the same format with evt = 0.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TDirectory;
+class TTree;
+
+
+namespace uwvv
+{
+
+  struct EventID
+  {
+    unsigned run;
+    unsigned lumi;
+    unsigned long long evt;
+
+    bool operator<(const EventID& other) const
+    {
+      if(run != other.run)
+        return run < other.run;
+      if(lumi != other.lumi)
+        return lumi < other.lumi;
+      return evt < other.evt;
+    }
+    bool operator==(const EventID& other) const
+    {
+      return run == other.run && lumi == other.lumi && evt == other.evt;
+    }
+    bool operator!=(const EventID& other) const {return !(*this == other);}
+  };
+
+
+  class EventIndex
+  {
+   public:
+    struct Range
+    {
+      EventID id;
+      uint64_t first; // first entry in the tree
+      uint32_t n;     // number of consecutive entries
+
+      bool operator<(const Range& other) const
+      {
+        if(id != other.id)
+          return id < other.id;
+        return first < other.first;
+      }
+    };
+
+    typedef std::vector<Range>::const_iterator const_iterator;
+
+    EventIndex() : nEntries(0), sorted(true) {;}
+    ~EventIndex() {;}
+
+    // Building: call for every entry of the tree, in entry order, then
+    // sort() before any lookups
+    void add(const EventID& id, uint64_t entry);
+    void add(unsigned run, unsigned lumi, unsigned long long evt,
+             uint64_t entry)
+    {
+      add(EventID{run, lumi, evt}, entry);
+    }
+    void sort();
+
+    // Index of a tree made by appending the other index's tree to this
+    // one's. Both must be sorted; the result is too. O(n)
+    void append(const EventIndex& other);
+
+    // Entries in the indexed tree
+    uint64_t treeEntries() const {return nEntries;}
+    // Distinct ranges (events, unless trees with overlaps were combined)
+    size_t size() const {return ranges.size();}
+    bool empty() const {return ranges.empty();}
+
+    const_iterator begin() const {return ranges.begin();}
+    const_iterator end() const {return ranges.end();}
+
+    // All the ranges for this event, in entry order. O(log n)
+    std::pair<const_iterator, const_iterator> find(const EventID& id) const;
+    bool contains(const EventID& id) const;
+    // All entries of this event, in order
+    std::vector<uint64_t> entries(const EventID& id) const;
+
+    // Compact encoding of one segment
+    void encode(std::vector<unsigned char>& out) const;
+    static EventIndex decode(const unsigned char* data, size_t size,
+                             uint64_t treeEntries);
+
+    // Add this index to the tree as one segment, making the branches if
+    // the tree doesn't have them yet
+    void fill(TTree& tree) const;
+
+    // Make an index by reading the run, lumi, and evt branches of a tree
+    static EventIndex build(TTree& tree);
+
+    // Read all segments of an index tree, as if appended in order
+    static EventIndex read(TTree& tree);
+    // Returns false (and leaves out unchanged) if there's no such tree
+    static bool read(TDirectory& dir, EventIndex& out,
+                     const std::string& name = "eventIndex");
+
+   private:
+    void checkSorted(const char* what) const;
+
+    std::vector<Range> ranges;
+    uint64_t nEntries;
+    bool sorted;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,109 @@
+#ifndef UWVV_Utilities_JetResolutionCache_h
+#define UWVV_Utilities_JetResolutionCache_h
+
+// Jet pt resolution and data/MC resolution scale factors, read from the
+// EventSetup only when their IOV changes. The binning of both payloads is
+// flattened into plain arrays so finding a jet's bin doesn't go through
+// JME::JetParameters, and the scale factors (which have no formula) are
+// read straight out of the table. Everything is evaluated for a whole
+// event's jets at once.
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "FWCore/Framework/interface/ESWatcher.h"
+#include "CondFormats/DataRecord/interface/JetResolutionRcd.h"
+#include "CondFormats/DataRecord/interface/JetResolutionScaleFactorRcd.h"
+#include "CondFormats/JetMETObjects/interface/JetResolutionObject.h"
+#include "JetMETCorrections/Modules/interface/JetResolution.h"
+
+
+namespace uwvv
+{
+
+  namespace jer
+  {
+    // The bin boundaries of a JetResolutionObject, one row per record, in
+    // the same order as the records so the first match is the record
+    // JetResolutionObject::getRecord() would return
+    class FlatBinning
+    {
+     public:
+      FlatBinning() : usable(false) {;}
+      ~FlatBinning() {;}
+
+      // False if the payload is binned in something other than jet pt,
+      // eta, |eta| and rho, in which case it can't be used
+      bool build(const JME::JetResolutionObject& obj);
+
+      bool isUsable() const {return usable;}
+
+      bool uses(JME::Binning b) const;
+
+      // Index of the record containing this jet, or -1 if there is none
+      int find(float pt, float eta, float rho) const;
+
+     private:
+      bool usable;
+      std::vector<JME::Binning> bins;
+      std::vector<float> lo; // nRecords * nBins
+      std::vector<float> hi;
+    };
+
+
+    class JetResolutionCache
+    {
+     public:
+      JetResolutionCache(const std::string& resolutionLabel,
+                         const std::string& scaleFactorLabel);
+      ~JetResolutionCache() {;}
+
+      // Get new payloads if either IOV has changed. Returns true if
+      // anything was reloaded.
+      bool update(const edm::EventSetup& setup);
+
+      // Use these payloads instead of ones from the EventSetup (e.g. ones
+      // read from text files)
+      void set(const JME::JetResolution& resolution,
+               const JME::JetResolutionScaleFactor& scaleFactor);
+
+      // Relative pt resolution for n jets
+      void resolutions(size_t n, const float* pt, const float* eta,
+                       float rho, float* out) const;
+
+      // Nominal, down and up scale factors for n jets. Like the JME lookup
+      // this replaces, the scale factors are looked up without the jet pt.
+      void scaleFactors(size_t n, const float* eta, float rho,
+                        float* nominal, float* down, float* up) const;
+
+     private:
+      void rebuildResolution();
+      void rebuildScaleFactor();
+
+      const std::string resLabel;
+      const std::string sfLabel;
+
+      edm::ESWatcher<JetResolutionRcd> resWatcher;
+      edm::ESWatcher<JetResolutionScaleFactorRcd> sfWatcher;
+
+      std::unique_ptr<JME::JetResolution> res;
+      std::unique_ptr<JME::JetResolutionScaleFactor> sf;
+
+      FlatBinning resBins;
+      FlatBinning sfBins;
+
+      // Scale factors by record, if they can be tabulated
+      bool sfTabulated;
+      std::vector<float> sfNominal;
+      std::vector<float> sfDown;
+      std::vector<float> sfUp;
+    };
+
+  } // namespace jer
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,42 @@
+#ifndef UWVV_Utilities_NtupleFiles_h
+#define UWVV_Utilities_NtupleFiles_h
+
+// Helpers for the command-line tools that work on ntuple files.
+
+#include <string>
+#include <vector>
+
+class TDirectory;
+class TFile;
+
+
+namespace uwvv
+{
+
+  namespace ntupleFiles
+  {
+    // Comma-separated list of files, which may contain wildcards (matches
+    // are taken in sorted order)
+    std::vector<std::string> expand(const std::string& patterns);
+
+    // Names of the top-level directories of the file that hold a tree with
+    // this name ("ntuple" for the channels, "metaInfo" for the meta tree)
+    std::vector<std::string> directoriesWith(TFile& f,
+                                             const std::string& treeName);
+
+    // Names of the top-level directories in any of the files, in the order
+    // they're first seen
+    std::vector<std::string> topDirectories(const std::vector<std::string>& files);
+
+    // Merge the directory at path in all the inputs into out the way hadd
+    // would: histograms are summed (labeled bins are matched by label),
+    // trees are concatenated, subdirectories are merged the same way, and
+    // anything else is copied from the first input that has it
+    void mergeDirectory(const std::vector<std::string>& inputs,
+                        const std::string& path, TDirectory& out);
+  } // namespace ntupleFiles
+
+} // namespace uwvv
+
+
+#endif // header guard
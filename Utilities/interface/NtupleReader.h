@@ -0,0 +1,367 @@
+#ifndef UWVV_Utilities_NtupleReader_h
+#define UWVV_Utilities_NtupleReader_h
+
+// Compiled, multithreaded reading of UWVV ntuples for studies, instead of
+// looping over rows in python.
+//
+// A Processor runs a set of Kernels over one channel's ntuple in a list of
+// files. The trees are cut into blocks of entries (on cluster boundaries,
+// so no basket is read twice), and the blocks are shared out among the
+// threads. Each block is read column by column -- only the branches some
+// kernel asked for -- into typed arrays, and handed to every kernel.
+// Each thread has its own copy of each kernel; the copies are merged back
+// into the originals at the end, so kernels need no locking.
+//
+// Column names are the branch names, e.g. e1Pt, e1_m2_Mass, or Mass, and
+// may also use Z1 and Z2 for the first and second Z's prefix (Z1Mass is
+// e1_e2_Mass in eemm). Z1 and Z2 are in the ntuple's daughter order, not
+// sorted by mass. Layout gives the branch names for a channel.
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+#include "TH1D.h"
+#include "TH2D.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+class TTree;
+
+
+namespace uwvv
+{
+
+  namespace ntuple
+  {
+    // Branch naming for one channel, the same as makeBranchSet.py
+    class Layout
+    {
+     public:
+      explicit Layout(const std::string& channel);
+      ~Layout() {;}
+
+      const std::string& channel() const {return channel_;}
+
+      // Final state objects, in branch name order, e.g. e1 e2 m1 m2
+      const std::vector<std::string>& objects() const {return objects_;}
+      size_t nZs() const {return zPrefixes.size();}
+
+      // e.g. object("e1", "Pt") -> e1Pt
+      std::string object(const std::string& obj, const std::string& var) const
+      {
+        return obj + var;
+      }
+      // Variables of a pair of objects (either order), e.g.
+      // pair("m2", "e1", "Mass") -> e1_m2_Mass
+      std::string pair(const std::string& obj1, const std::string& obj2,
+                       const std::string& var) const;
+      // Variables of the first or second Z, e.g. z(1, "Mass") -> e1_e2_Mass
+      std::string z(unsigned i, const std::string& var) const;
+
+      // Branch name for a column name, with Z1 and Z2 replaced
+      std::string resolve(const std::string& column) const;
+
+     private:
+      std::string channel_;
+      std::vector<std::string> objects_;
+      std::vector<std::string> zPrefixes;
+    };
+
+
+    // Branch types we know how to read
+    enum class Type {Float, Double, Int, UInt, Bool, ULong64, Long64,
+                     VFloat, VDouble, VInt, VUInt, Unknown};
+
+    template<class T> struct TypeOf;
+    template<> struct TypeOf<float> {static const Type value = Type::Float;};
+    template<> struct TypeOf<double> {static const Type value = Type::Double;};
+    template<> struct TypeOf<int> {static const Type value = Type::Int;};
+    template<> struct TypeOf<unsigned> {static const Type value = Type::UInt;};
+    template<> struct TypeOf<bool> {static const Type value = Type::Bool;};
+    template<> struct TypeOf<ULong64_t> {static const Type value = Type::ULong64;};
+    template<> struct TypeOf<Long64_t> {static const Type value = Type::Long64;};
+    template<> struct TypeOf<std::vector<float> > {static const Type value = Type::VFloat;};
+    template<> struct TypeOf<std::vector<double> > {static const Type value = Type::VDouble;};
+    template<> struct TypeOf<std::vector<int> > {static const Type value = Type::VInt;};
+    template<> struct TypeOf<std::vector<unsigned> > {static const Type value = Type::VUInt;};
+
+    const char* typeName(Type t);
+
+
+    namespace detail
+    {
+      struct ColumnData
+      {
+        explicit ColumnData(Type type) : type(type) {;}
+        virtual ~ColumnData() {;}
+
+        // Read entries [first, first+n) of the branch
+        virtual void read(TTree& tree, const std::string& branch,
+                          Long64_t first, size_t n) = 0;
+        // Converted to double; throws for vector columns
+        virtual void asDouble(std::vector<double>& out) const = 0;
+
+        const Type type;
+      };
+
+      template<class T>
+      struct TypedColumnData : public ColumnData
+      {
+        TypedColumnData() : ColumnData(TypeOf<T>::value) {;}
+
+        void read(TTree& tree, const std::string& branch, Long64_t first,
+                  size_t n) override;
+        void asDouble(std::vector<double>& out) const override;
+
+        std::vector<T> values;
+      };
+
+      std::unique_ptr<ColumnData> makeColumnData(Type type);
+    } // namespace detail
+
+
+    // One block of consecutive entries of one file's tree, with the values
+    // of all the requested columns
+    class Block
+    {
+     public:
+      Block(const Layout& layout) : layout(layout), file_(0), first_(0),
+                                    size_(0) {;}
+      ~Block() {;}
+
+      size_t size() const {return size_;}
+      const std::string& file() const {return *file_;}
+      Long64_t firstEntry() const {return first_;}
+
+      // Values of a column, which must have exactly this type
+      template<class T>
+      const std::vector<T>& get(const std::string& column) const
+      {
+        const detail::ColumnData& data = find(column);
+        if(data.type != TypeOf<T>::value)
+          throw cms::Exception("BranchTypeMismatch")
+            << "Column " << column << " is " << typeName(data.type)
+            << ", not " << typeName(TypeOf<T>::value) << std::endl;
+
+        return static_cast<const detail::TypedColumnData<T>&>(data).values;
+      }
+
+      // Values of any scalar column, converted to double
+      void getAsDouble(const std::string& column,
+                       std::vector<double>& out) const
+      {
+        find(column).asDouble(out);
+      }
+
+     private:
+      friend class Processor;
+
+      const detail::ColumnData& find(const std::string& column) const;
+
+      const Layout& layout;
+      const std::string* file_;
+      Long64_t first_;
+      size_t size_;
+      std::map<std::string, std::unique_ptr<detail::ColumnData> > columns;
+    };
+
+
+    class Kernel
+    {
+     public:
+      virtual ~Kernel() {;}
+
+      // Add the names of the columns this reads
+      virtual void columns(std::vector<std::string>& out) const = 0;
+      // A new, empty kernel with the same setup, for another thread
+      virtual std::unique_ptr<Kernel> clone() const = 0;
+      virtual void process(const Block& block) = 0;
+      // Add the results of a clone of this kernel
+      virtual void merge(const Kernel& other) = 0;
+    };
+
+
+    // A list of cuts, all of which must pass, e.g.
+    //     "Z1Mass > 60 && Z1Mass < 120 && abs(e1Eta) < 2.5"
+    // Each cut is a column (or abs() of one), a comparison, and a number.
+    // An empty string accepts everything.
+    class Selection
+    {
+     public:
+      Selection() {;}
+      explicit Selection(const std::string& cut);
+      ~Selection() {;}
+
+      bool empty() const {return cuts.empty();}
+
+      void columns(std::vector<std::string>& out) const;
+      // pass[i] is 1 if entry i of the block passes
+      void evaluate(const Block& block, std::vector<char>& pass) const;
+
+     private:
+      enum class Op {LT, LE, GT, GE, EQ, NE};
+
+      struct Cut
+      {
+        std::string column;
+        bool abs;
+        Op op;
+        double value;
+      };
+
+      std::vector<Cut> cuts;
+      mutable std::vector<double> buffer;
+    };
+
+
+    // Number (and sum of weights) of rows passing a selection
+    class Counter : public Kernel
+    {
+     public:
+      Counter(const Selection& selection = Selection(),
+              const std::string& weight = "");
+      ~Counter() {;}
+
+      long long count() const {return count_;}
+      double sumOfWeights() const {return sumW;}
+
+      void columns(std::vector<std::string>& out) const override;
+      std::unique_ptr<Kernel> clone() const override;
+      void process(const Block& block) override;
+      void merge(const Kernel& other) override;
+
+     private:
+      const Selection selection;
+      const std::string weight;
+
+      long long count_;
+      double sumW;
+
+      std::vector<char> pass;
+      std::vector<double> weights;
+    };
+
+
+    // Histogram of a scalar column for rows passing a selection
+    class Hist1D : public Kernel
+    {
+     public:
+      Hist1D(const std::string& name, const std::string& column,
+             unsigned nBins, double low, double high,
+             const Selection& selection = Selection(),
+             const std::string& weight = "");
+      ~Hist1D() {;}
+
+      const TH1D& hist() const {return *hist_;}
+
+      void columns(std::vector<std::string>& out) const override;
+      std::unique_ptr<Kernel> clone() const override;
+      void process(const Block& block) override;
+      void merge(const Kernel& other) override;
+
+     private:
+      const std::string column;
+      const Selection selection;
+      const std::string weight;
+
+      std::unique_ptr<TH1D> hist_;
+
+      std::vector<char> pass;
+      std::vector<double> values;
+      std::vector<double> weights;
+    };
+
+
+    // 2D histogram of two scalar columns
+    class Hist2D : public Kernel
+    {
+     public:
+      Hist2D(const std::string& name,
+             const std::string& columnX, unsigned nBinsX, double lowX,
+             double highX,
+             const std::string& columnY, unsigned nBinsY, double lowY,
+             double highY,
+             const Selection& selection = Selection(),
+             const std::string& weight = "");
+      ~Hist2D() {;}
+
+      const TH2D& hist() const {return *hist_;}
+
+      void columns(std::vector<std::string>& out) const override;
+      std::unique_ptr<Kernel> clone() const override;
+      void process(const Block& block) override;
+      void merge(const Kernel& other) override;
+
+     private:
+      const std::string columnX;
+      const std::string columnY;
+      const Selection selection;
+      const std::string weight;
+
+      std::unique_ptr<TH2D> hist_;
+
+      std::vector<char> pass;
+      std::vector<double> valuesX;
+      std::vector<double> valuesY;
+      std::vector<double> weights;
+    };
+
+
+    class Processor
+    {
+     public:
+      struct Stats
+      {
+        size_t nFiles;
+        size_t nBlocks;
+        long long nEntries;
+        long long bytesRead;
+        double seconds;
+      };
+
+      // nThreads = 0 means one per core
+      Processor(const std::vector<std::string>& files,
+                const std::string& channel, unsigned nThreads = 0);
+      ~Processor() {;}
+
+      const Layout& layout() const {return layout_;}
+
+      // Kernels are not owned, and must live until run() is done
+      void add(Kernel& kernel) {kernels.push_back(&kernel);}
+
+      // Entries per block (rounded up to whole clusters)
+      void setBlockSize(size_t n) {blockSize = n;}
+
+      // Run every kernel over every entry. May be called again after
+      // adding more kernels; kernels already run get the entries again.
+      Stats run();
+
+     private:
+      struct Task
+      {
+        size_t iFile;
+        Long64_t first;
+        size_t n;
+      };
+
+      std::vector<Task> makeTasks(const std::vector<std::string>& branches,
+                                  std::vector<Type>& types) const;
+
+      const std::vector<std::string> files;
+      const std::string treePath;
+      const Layout layout_;
+      unsigned nThreads;
+      size_t blockSize;
+      std::vector<Kernel*> kernels;
+    };
+
+  } // namespace ntuple
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,82 @@
+#ifndef UWVV_Utilities_PerEventCache_h
+#define UWVV_Utilities_PerEventCache_h
+
+// Results of an expensive computation for the event each stream is
+// currently processing, so every module in the job that needs the same
+// thing in the same event can share one evaluation. Different streams
+// never see the same event, so each stream has its own slot, which is
+// emptied when the stream moves on to a new event; modules on the same
+// stream may run at the same time, so access is locked.
+//
+// Use shared() to get the one instance for a given key/value type.
+
+#include <map>
+#include <mutex>
+
+#include "DataFormats/Provenance/interface/EventID.h"
+
+
+namespace uwvv
+{
+
+  template<class Key, class Value>
+  class PerEventCache
+  {
+   public:
+    PerEventCache() {;}
+    ~PerEventCache() {;}
+
+    static PerEventCache& shared()
+    {
+      static PerEventCache cache;
+      return cache;
+    }
+
+    // Copies the stored value into out if there is one
+    bool find(unsigned stream, const edm::EventID& evt, const Key& key,
+              Value& out)
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      Slot& slot = slotFor(stream, evt);
+
+      auto found = slot.values.find(key);
+      if(found == slot.values.end())
+        return false;
+
+      out = found->second;
+      return true;
+    }
+
+    void insert(unsigned stream, const edm::EventID& evt, const Key& key,
+                const Value& value)
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      slotFor(stream, evt).values[key] = value;
+    }
+
+   private:
+    struct Slot
+    {
+      edm::EventID event;
+      std::map<Key, Value> values;
+    };
+
+    Slot& slotFor(unsigned stream, const edm::EventID& evt)
+    {
+      Slot& slot = slots[stream];
+      if(slot.event != evt)
+        {
+          slot.event = evt;
+          slot.values.clear();
+        }
+      return slot;
+    }
+
+    std::mutex mutex;
+    std::map<unsigned, Slot> slots;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
@@ -0,0 +1,165 @@
+#ifndef UWVV_Utilities_UserDataIndex_h
+#define UWVV_Utilities_UserDataIndex_h
+
+// Fast userFloat/userInt reads for PAT objects. PAT keeps user data as
+// parallel vectors of names and values and looks the name up on every
+// call. Every object in a collection gets its user data from the same
+// chain of embedders, so a name sits at the same position in all of them.
+// UserDataIndex finds that position on the first object it sees and after
+// that only checks the name at that position is still the right one,
+// searching again if it isn't (e.g. the object came from a different
+// collection).
+//
+// Not thread safe: each instance remembers the last position it found,
+// so don't share one between streams.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DataFormats/PatCandidates/interface/PATObject.h"
+
+
+namespace uwvv
+{
+
+  namespace userData
+  {
+    enum class Type {Float, Int};
+
+    // What a branch string like 'userFloat("x")' or
+    // '? hasUserFloat("x") ? userFloat("x") : -999.' asks for
+    struct Expression
+    {
+      Type type;
+      std::string name;
+      bool hasDefault;   // the ternary form
+      double defaultVal; // returned when the object doesn't have it
+    };
+
+    // False if the string isn't one of those two forms (anything fancier
+    // should go to StringObjectFunction)
+    bool parse(const std::string& s, Expression& out);
+
+
+    // Only declared, for detecting (and finding the base of) PAT objects
+    template<class B> B* patObjectBase(const pat::PATObject<B>*);
+
+    template<class T>
+    struct IsPATObject
+    {
+      template<class U>
+      static auto test(int) -> decltype(patObjectBase(std::declval<const U*>()),
+                                        std::true_type());
+      template<class U>
+      static std::false_type test(...);
+
+      static const bool value = decltype(test<T>(0))::value;
+    };
+
+    // The user data vectors are protected, but a pointer to a protected
+    // member taken through a derived class can be used on any PATObject
+    template<class B>
+    struct Access : public pat::PATObject<B>
+    {
+      static const std::vector<std::string>& floatNames(const pat::PATObject<B>& o)
+      {
+        return o.*(&Access::userFloatLabels_);
+      }
+      static const std::vector<float>& floats(const pat::PATObject<B>& o)
+      {
+        return o.*(&Access::userFloats_);
+      }
+      static const std::vector<std::string>& intNames(const pat::PATObject<B>& o)
+      {
+        return o.*(&Access::userIntLabels_);
+      }
+      static const std::vector<int32_t>& ints(const pat::PATObject<B>& o)
+      {
+        return o.*(&Access::userInts_);
+      }
+    };
+  } // namespace userData
+
+
+  template<class T, userData::Type Type>
+  class UserDataIndex
+  {
+    typedef typename std::remove_pointer<decltype(userData::patObjectBase(std::declval<const T*>()))>::type Base;
+    typedef userData::Access<Base> Access;
+
+   public:
+    UserDataIndex(const std::string& name) :
+      name_(name),
+      index_(std::numeric_limits<size_t>::max()),
+      nSearches_(0)
+    {;}
+    ~UserDataIndex() {;}
+
+    bool has(const T& obj) const
+    {
+      return resolve(obj);
+    }
+
+    // Same as obj.userFloat(name)/obj.userInt(name), including what
+    // happens if the object doesn't have it
+    double get(const T& obj) const
+    {
+      if(!resolve(obj))
+        return fallback(obj);
+
+      if(Type == userData::Type::Float)
+        return Access::floats(obj)[index_];
+      return Access::ints(obj)[index_];
+    }
+
+    const std::string& name() const {return name_;}
+
+    // How many times the name had to be searched for; should be 1 (or 0)
+    // if things are working as intended
+    unsigned long long nSearches() const {return nSearches_;}
+
+   private:
+    const std::vector<std::string>& names(const T& obj) const
+    {
+      return (Type == userData::Type::Float ?
+              Access::floatNames(obj) :
+              Access::intNames(obj));
+    }
+
+    double fallback(const T& obj) const
+    {
+      if(Type == userData::Type::Float)
+        return obj.userFloat(name_);
+      return obj.userInt(name_);
+    }
+
+    bool resolve(const T& obj) const
+    {
+      const std::vector<std::string>& labels = names(obj);
+
+      if(index_ < labels.size() && labels[index_] == name_)
+        return true;
+
+      ++nSearches_;
+      auto found = std::find(labels.begin(), labels.end(), name_);
+      if(found == labels.end())
+        return false;
+
+      index_ = found - labels.begin();
+      return true;
+    }
+
+    const std::string name_;
+    mutable size_t index_;
+    mutable unsigned long long nSearches_;
+  };
+
+} // namespace uwvv
+
+
+#endif // header guard
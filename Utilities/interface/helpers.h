@@ -3,6 +3,7 @@
 
 
 #include <string>
+#include <vector>
 
 #include "TLorentzVector.h"
 
@@ -13,6 +14,8 @@
 #include "DataFormats/Candidate/interface/Candidate.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
 namespace uwvv
 {
 
@@ -53,11 +56,67 @@ namespace uwvv
     // applicable
     bool overlapWithAnyDaughter(const reco::Candidate& cand,
                                 const reco::Candidate& mother, float dR);
+
+    // Same, with the final daughters' eta and phi already collected by
+    // finalDaughterEtaPhi(). Use this when checking many objects against
+    // the same mother.
+    bool overlapWithAnyDaughter(const reco::Candidate& cand,
+                                const deltaR::EtaPhiBuffer& finalDaughters,
+                                float dR);
+
+    // Add the eta and phi of all final daughters of mother (or of mother
+    // itself if it has no daughters) to addTo
+    void finalDaughterEtaPhi(const reco::Candidate& mother,
+                             deltaR::EtaPhiBuffer& addTo);
+
+    // Indices of the objects in coll that are not within dR of any final
+    // daughter of mother, in their original order
+    template<class C>
+    std::vector<size_t> nonOverlappingIndices(const C& coll,
+                                              const reco::Candidate& mother,
+                                              float dR)
+    {
+      deltaR::EtaPhiBuffer daughters;
+      finalDaughterEtaPhi(mother, daughters);
+
+      deltaR::EtaPhiBuffer objects;
+      objects.addAll(coll);
+
+      std::vector<unsigned char> overlaps(objects.size(), 0);
+      for(size_t i = 0; i < daughters.size(); ++i)
+        deltaR::markWithinDeltaR(daughters.eta()[i], daughters.phi()[i],
+                                 objects, dR, overlaps);
+
+      std::vector<size_t> out;
+      out.reserve(objects.size());
+      for(size_t i = 0; i < overlaps.size(); ++i)
+        {
+          if(!overlaps[i])
+            out.push_back(i);
+        }
+
+      return out;
+    }
     
     // Return the jet collection cleaned from the initial state objects. 
     // Collection should be embedded into the initial state as userData.
     const edm::PtrVector<pat::Jet>* getCleanedJetCollection(const pat::CompositeCandidate& cand, 
         const std::string& variation, std::string collectionName="cleanedJets");
+
+    // Jet systematic variations (JES, JER shifts) are not separate
+    // collections. Each nominal jet carries a userFloat with the factor
+    // that takes its nominal p4 to the shifted one.
+    // Label of the userFloat holding the scale factor for a variation
+    std::string jetVariationLabel(const std::string& variation);
+
+    // Factor to scale the nominal p4 by for this variation (1 if variation
+    // is empty, i.e. nominal)
+    float jetVariationScale(const pat::Jet& jet, const std::string& variation);
+
+    // The jet's p4 under this variation. Eta, phi and rapidity are the same
+    // for all variations, so only quantities that depend on the energy
+    // scale need this.
+    math::XYZTLorentzVector jetP4(const pat::Jet& jet, const std::string& variation);
   } // namespace helpers
 
 } // namespace uwvv
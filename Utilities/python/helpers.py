@@ -158,3 +158,11 @@ def deltaR(eta1, phi1, eta2, phi2):
     while dPhi > pi:
         dPhi -= 2*pi
     return sqrt(dPhi**2 + (eta2 - eta1)**2)
+
+def jetVariationLabel(variation):
+    '''
+    Name of the userFloat holding the factor that takes a jet's nominal p4
+    to the p4 for a systematic variation like 'jesUp'. Must match
+    uwvv::helpers::jetVariationLabel() in C++.
+    '''
+    return 'p4Scale_' + variation
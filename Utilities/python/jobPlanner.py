@@ -0,0 +1,201 @@
+'''
+
+Split a dataset's files into jobs of roughly equal wall time, from the
+number of events in each file and a measured ntuplizer throughput, instead
+of a fixed number of files per job.
+
+A throughput profile is a JSON file mapping a configuration key (by
+default the channels, e.g. "zz") to
+    {"eventsPerSecond" : float, "startupSeconds" : float}
+as measured by Utilities/scripts/calibrateThroughput.py. A job with N
+events is predicted to take startupSeconds + N / eventsPerSecond.
+
+Nate Woods, U. Wisconsin
+
+'''
+
+import heapq
+import json
+from math import ceil, sqrt
+
+
+def readFileList(fileName):
+    '''
+    Read a list of input files with event counts, one "file nEvents" per
+    line (the format of "das_client --query='file dataset=... | grep
+    file.name, file.nevents'"). Blank lines and lines starting with # are
+    skipped. Returns a list of (file, nEvents).
+    '''
+    files = []
+    with open(fileName) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            files.append(parseFileLine(line))
+
+    return files
+
+
+def parseFileLine(line):
+    '''
+    One (file, nEvents) from a "file nEvents" line.
+    '''
+    fields = line.replace(',', ' ').split()
+    if len(fields) != 2:
+        raise ValueError("Can't understand file list line '{}' (should be "
+                         "'file nEvents')".format(line))
+
+    return (fields[0], int(fields[1]))
+
+
+def configKey(cmsRunArgs):
+    '''
+    Default throughput profile key for a list of cmsRun arguments: the
+    channels argument, if any.
+    '''
+    for arg in cmsRunArgs:
+        if arg.startswith('channels='):
+            return arg.split('=', 1)[1]
+
+    return 'default'
+
+
+def readThroughput(fileName, key):
+    '''
+    Get (eventsPerSecond, startupSeconds) for this configuration from a
+    throughput profile. Falls back on the "default" entry if there is one.
+    '''
+    with open(fileName) as f:
+        profile = json.load(f)
+
+    if key not in profile:
+        if 'default' not in profile:
+            raise KeyError("No throughput for '{}' (or default) in "
+                           "{}".format(key, fileName))
+        key = 'default'
+
+    return (float(profile[key]['eventsPerSecond']),
+            float(profile[key].get('startupSeconds', 0.)))
+
+
+def writeThroughput(fileName, key, eventsPerSecond, startupSeconds):
+    '''
+    Add or replace one configuration in a throughput profile.
+    '''
+    try:
+        with open(fileName) as f:
+            profile = json.load(f)
+    except IOError:
+        profile = {}
+
+    profile[key] = {
+        'eventsPerSecond' : eventsPerSecond,
+        'startupSeconds' : startupSeconds,
+        }
+
+    with open(fileName, 'w') as f:
+        json.dump(profile, f, indent=2, sort_keys=True)
+
+
+class Job(object):
+    def __init__(self):
+        self.files = []
+        self.nEvents = 0
+
+    def add(self, fileName, nEvents):
+        self.files.append(fileName)
+        self.nEvents += nEvents
+
+    def time(self, eventsPerSecond, startupSeconds):
+        return startupSeconds + self.nEvents / eventsPerSecond
+
+
+def planJobs(files, eventsPerSecond, targetSeconds, startupSeconds=0.):
+    '''
+    Split files (a list of (file, nEvents)) into jobs predicted to take
+    about targetSeconds each. Files aren't split, so a file that takes
+    longer than that gets a job to itself.
+
+    Uses the longest-processing-time rule: just enough jobs are made to
+    fit all the events at the target time, then each file, biggest first,
+    goes to the job with the fewest events so far.
+    '''
+    if not files:
+        return []
+    if targetSeconds <= startupSeconds:
+        raise ValueError("Target job time ({} s) must be longer than the "
+                         "startup time ({} s)".format(targetSeconds,
+                                                      startupSeconds))
+
+    eventsPerJob = eventsPerSecond * (targetSeconds - startupSeconds)
+    totalEvents = sum(n for f, n in files)
+    nJobs = min(len(files), max(1, int(ceil(totalEvents / eventsPerJob))))
+
+    jobs = [Job() for i in range(nJobs)]
+    heap = [(0, i) for i in range(nJobs)]
+
+    for fileName, nEvents in sorted(files, key=lambda f: -f[1]):
+        events, i = heapq.heappop(heap)
+        jobs[i].add(fileName, nEvents)
+        heapq.heappush(heap, (jobs[i].nEvents, i))
+
+    return [j for j in jobs if j.files]
+
+
+def fixedJobs(files, filesPerJob):
+    '''
+    The old way, for comparison: filesPerJob files per job, in order.
+    '''
+    jobs = []
+    for i in range(0, len(files), filesPerJob):
+        job = Job()
+        for fileName, nEvents in files[i:i+filesPerJob]:
+            job.add(fileName, nEvents)
+        jobs.append(job)
+
+    return jobs
+
+
+def groupByNFiles(jobs):
+    '''
+    Farmout only does a fixed number of files per job, so a plan is
+    submitted as one farmout task per job size. Returns a dict of
+    {nFiles : [list of files of all jobs with that many, in job order]}.
+    '''
+    groups = {}
+    for job in jobs:
+        groups.setdefault(len(job.files), []).extend(job.files)
+
+    return groups
+
+
+def summarize(jobs, eventsPerSecond, startupSeconds):
+    '''
+    Dict of predicted wall times for a plan: number of jobs, mean, RMS
+    spread, longest, and total core-hours.
+    '''
+    times = [j.time(eventsPerSecond, startupSeconds) for j in jobs]
+    if not times:
+        return {'nJobs' : 0, 'mean' : 0., 'rms' : 0., 'max' : 0.,
+                'coreHours' : 0.}
+
+    mean = sum(times) / len(times)
+    rms = sqrt(sum((t - mean)**2 for t in times) / len(times))
+
+    return {
+        'nJobs' : len(times),
+        'mean' : mean,
+        'rms' : rms,
+        'max' : max(times),
+        'coreHours' : sum(times) / 3600.,
+        }
+
+
+def formatSummary(name, summary):
+    return ('{}: {} jobs, predicted wall time {:.2f} +/- {:.2f} h, longest '
+            '{:.2f} h, {:.1f} core-hours').format(name, summary['nJobs'],
+                                                  summary['mean'] / 3600.,
+                                                  summary['rms'] / 3600.,
+                                                  summary['max'] / 3600.,
+                                                  summary['coreHours'])
@@ -0,0 +1,99 @@
+'''
+
+Run mergeDataFiles.py and uwvvMergeDataFiles on the same inputs, time them,
+and check that they give the same events in the same order in every
+channel. Wildcards are expanded here (sorted) and the explicit file list
+is given to both, since they don't expand wildcards in the same order.
+
+Nate Woods, U. Wisconsin
+
+'''
+
+import os
+import subprocess
+import sys
+import time
+from glob import glob
+
+# import ROOT in batch mode
+oldargv = sys.argv[:]
+sys.argv = [ '-b-' ]
+import ROOT
+ROOT.gROOT.SetBatch(True)
+sys.argv = oldargv
+
+from UWVV.Utilities.helpers import parseChannels
+
+
+def timeCommand(cmd):
+    start = time.time()
+    subprocess.check_call(cmd)
+    return time.time() - start
+
+
+def eventList(fileName, channel):
+    f = ROOT.TFile.Open(fileName)
+    t = f.Get('{}/ntuple'.format(channel))
+    if not t:
+        raise IOError('No {}/ntuple in {}'.format(channel, fileName))
+
+    t.SetBranchStatus('*', 0)
+    for b in ['run', 'lumi', 'evt']:
+        t.SetBranchStatus(b, 1)
+
+    out = [(ev.run, ev.lumi, ev.evt) for ev in t]
+    nBranches = t.GetListOfBranches().GetEntries()
+    f.Close()
+
+    return out, nBranches
+
+
+if __name__ == "__main__":
+    from argparse import ArgumentParser
+
+    parser = ArgumentParser(description='Compare and time the Python and compiled data mergers.')
+    parser.add_argument('channels', type=str, nargs=1,
+                        help='Comma-separated list of channels or channel shorthands.')
+    parser.add_argument('input', type=str, nargs=1,
+                        help='Comma-separated list of input files. May contain wildcars.')
+    parser.add_argument('--outputDir', type=str, default='.',
+                        help='Where to put the two merged files.')
+    parser.add_argument('--threads', type=int, default=0,
+                        help='Number of channels for uwvvMergeDataFiles to do at once (0 for all).')
+    parser.add_argument('--memoryLimit', type=int, default=0,
+                        help='Memory limit (MB) for uwvvMergeDataFiles (0 for none).')
+
+    args = parser.parse_args()
+
+    infiles = []
+    for fset in args.input[0].split(','):
+        infiles += sorted(glob(fset))
+    if not len(infiles):
+        raise IOError("No files found matching {}".format(args.input[0]))
+    fileList = ','.join(infiles)
+
+    pyOut = os.path.join(args.outputDir, 'mergedPython.root')
+    cppOut = os.path.join(args.outputDir, 'mergedCompiled.root')
+
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          'mergeDataFiles.py')
+    tPy = timeCommand(['python', script, args.channels[0], fileList, pyOut])
+    tCpp = timeCommand(['uwvvMergeDataFiles', '-j', str(args.threads),
+                        '-m', str(args.memoryLimit),
+                        args.channels[0], fileList, cppOut])
+
+    print 'mergeDataFiles.py:  {:.1f} s'.format(tPy)
+    print 'uwvvMergeDataFiles: {:.1f} s ({:.1f}x)'.format(tCpp, tPy / tCpp)
+
+    allGood = True
+    for c in parseChannels(args.channels):
+        pyEvents, pyBranches = eventList(pyOut, c)
+        cppEvents, cppBranches = eventList(cppOut, c)
+
+        good = pyEvents == cppEvents and pyBranches == cppBranches
+        allGood = allGood and good
+        print '{}: {} events, {} branches ({}) vs {} events, {} branches ({}): {}'.format(
+            c, len(pyEvents), pyBranches, 'python', len(cppEvents),
+            cppBranches, 'compiled', 'same' if good else 'DIFFERENT')
+
+    sys.exit(0 if allGood else 1)
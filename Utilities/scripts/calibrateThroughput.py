@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+
+'''
+
+Measure how fast the ntuplizer runs for one configuration, for job
+splitting in submitJobs.py. cmsRun is run locally twice, on a small and a
+large number of events, so the startup time (loading, conditions, etc.)
+and the per-event rate can be separated. The result goes into a
+throughput profile (see UWVV.Utilities.jobPlanner).
+
+The input file(s) must have at least as many events as the larger run.
+
+Nate Woods, U. Wisconsin
+
+'''
+
+
+import argparse
+import logging
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+from UWVV.Utilities.jobPlanner import configKey, writeThroughput
+
+
+log = logging.getLogger("calibrateThroughput")
+logging.basicConfig(level=logging.INFO, stream=sys.stderr)
+
+
+def timeCmsRun(cfg, inputFiles, nEvents, cmsRunArgs):
+    # VarParsing renames the output (e.g. ntuple_numEvent100.root) when
+    # maxEvents is set, so write into a scratch directory and remove that
+    outDir = tempfile.mkdtemp(prefix='calibrateThroughput')
+    outFile = os.path.join(outDir, 'ntuple.root')
+
+    cmd = ['cmsRun', cfg, 'inputFiles={}'.format(inputFiles),
+           'maxEvents={}'.format(nEvents),
+           'outputFile={}'.format(outFile)] + cmsRunArgs
+
+    log.info("Running %s", ' '.join(cmd))
+
+    try:
+        with open(os.devnull, 'w') as devnull:
+            start = time.time()
+            subprocess.check_call(cmd, stdout=devnull)
+            elapsed = time.time() - start
+    finally:
+        shutil.rmtree(outDir, ignore_errors=True)
+
+    return elapsed
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Measure ntuplizer throughput for job splitting.')
+
+    parser.add_argument('cfg', type=str,
+                        help='CMS config file to run.')
+    parser.add_argument('inputFiles', type=str,
+                        help='Comma-separated input files (at least '
+                        '--nLarge events).')
+    parser.add_argument('--profile', type=str, default='throughput.json',
+                        help='Throughput profile to add this to. Default: %(default)s.')
+    parser.add_argument('--key', type=str, default='',
+                        help='Configuration key to store this under '
+                        '(default: the channels argument to cmsRun).')
+    parser.add_argument('--nSmall', type=int, default=100,
+                        help='Events in the short run.')
+    parser.add_argument('--nLarge', type=int, default=2000,
+                        help='Events in the long run.')
+    parser.add_argument('cmsRunArgs', nargs=argparse.REMAINDER,
+                        help="Arguments to cmsRun.")
+
+    args = parser.parse_args()
+
+    if args.nLarge <= args.nSmall:
+        raise ValueError("--nLarge must be more than --nSmall")
+
+    key = args.key if args.key else configKey(args.cmsRunArgs)
+
+    tSmall = timeCmsRun(args.cfg, args.inputFiles, args.nSmall, args.cmsRunArgs)
+    tLarge = timeCmsRun(args.cfg, args.inputFiles, args.nLarge, args.cmsRunArgs)
+
+    if tLarge <= tSmall:
+        raise RuntimeError("Long run ({:.1f} s) wasn't longer than the short "
+                           "one ({:.1f} s); use more events".format(tLarge, tSmall))
+
+    eventsPerSecond = (args.nLarge - args.nSmall) / (tLarge - tSmall)
+    startupSeconds = max(0., tSmall - args.nSmall / eventsPerSecond)
+
+    log.info("%s: %.2f events/s, %.1f s startup", key, eventsPerSecond,
+             startupSeconds)
+
+    writeThroughput(args.profile, key, eventsPerSecond, startupSeconds)
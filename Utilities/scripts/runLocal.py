@@ -0,0 +1,362 @@
+#!/usr/bin/env python
+
+'''
+
+Run the ntuplizer over a list of files on one machine with no batch
+system, with N cmsRun processes at a time, and merge the outputs.
+
+Input files are split into chunks, biggest first, which are dealt out to
+the workers' queues. A worker with nothing left takes the last chunk from
+the longest queue of another worker, so the workers finish together even
+when some chunks take much longer than others. Failed chunks are retried
+(by whichever worker is free). The outputs are merged with
+uwvvMergeNtuples (or hadd if it isn't built), which copies the trees
+basket by basket.
+
+At the end, a table of per-chunk timing and the aggregate event rate are
+printed. Event counts come from the metaInfo tree in each chunk's output.
+
+Example:
+    runLocal.py -j 64 --input=@files.txt --output=ntuples.root \\
+        $CMSSW_BASE/src/UWVV/Ntuplizer/test/ntuplize_cfg.py channels=zz isMC=1
+
+Nate Woods, U. Wisconsin
+
+'''
+
+
+import argparse
+import logging
+import os
+import subprocess
+import sys
+import time
+from collections import deque
+from distutils.spawn import find_executable
+from glob import glob
+
+
+log = logging.getLogger("runLocal")
+logging.basicConfig(level=logging.INFO, stream=sys.stdout,
+                    format='%(message)s')
+
+
+def expandInput(inputs):
+    '''
+    Comma-separated list of files, which may contain wildcards (expanded
+    in sorted order) or "@list.txt" for a file with one input per line.
+    Remote files (with a protocol, e.g. root://) are passed through.
+    '''
+    files = []
+    for item in inputs.split(','):
+        if not item:
+            continue
+        if item.startswith('@'):
+            with open(item[1:]) as f:
+                for line in f:
+                    line = line.strip()
+                    if line and not line.startswith('#'):
+                        files += expandInput(line)
+        elif '://' in item or item.startswith('/store/'):
+            files.append(item)
+        else:
+            matches = sorted(glob(item))
+            if not matches:
+                log.warning("No files found matching %s", item)
+            files += matches
+
+    return files
+
+
+def fileSize(f):
+    try:
+        return os.path.getsize(f)
+    except OSError:
+        return 0
+
+
+def makeChunks(files, filesPerChunk):
+    '''
+    Group files into chunks, numbered in input order (which is the order the
+    outputs are merged in) and returned biggest first for dispatch (remote
+    files count as empty).
+    '''
+    chunks = [Chunk(i, files[j:j+filesPerChunk])
+              for i, j in enumerate(range(0, len(files), filesPerChunk))]
+    return sorted(chunks, key=lambda c: sum(fileSize(f) for f in c.files),
+                  reverse=True)
+
+
+def countEvents(fileName):
+    '''
+    Events processed, from the metaInfo tree, or None if it can't be read.
+    '''
+    try:
+        import ROOT
+    except ImportError:
+        return None
+
+    f = ROOT.TFile.Open(fileName)
+    if not f or f.IsZombie():
+        return None
+
+    t = f.Get('metaInfo/metaInfo')
+    if not t:
+        f.Close()
+        return None
+
+    n = 0
+    for row in t:
+        n += row.nevents
+    f.Close()
+
+    return n
+
+
+class Chunk(object):
+    def __init__(self, index, files):
+        self.index = index
+        self.files = files
+        self.attempts = 0
+        self.seconds = 0. # successful attempt
+        self.busySeconds = 0. # all attempts
+        self.nEvents = None
+        self.done = False
+        self.worker = None
+        self.outputFile = None
+
+    def output(self, workDir):
+        '''
+        The output cmsRun is told to write. VarParsing tags the name with
+        some options (e.g. chunk3_numEvent100.root with maxEvents), so use
+        findOutput() for the file that was really written.
+        '''
+        return os.path.join(workDir, 'chunk{}.root'.format(self.index))
+
+    def findOutput(self, workDir):
+        base = os.path.splitext(self.output(workDir))[0]
+        found = glob(base + '.root') + sorted(glob(base + '_*.root'))
+        return found[0] if found else None
+
+    def logFile(self, workDir):
+        return os.path.join(workDir, 'chunk{}.log'.format(self.index))
+
+
+class Worker(object):
+    def __init__(self, index):
+        self.index = index
+        self.queue = deque()
+        self.chunk = None
+        self.process = None
+        self.start = 0.
+        self.logFile = None
+        self.nStolen = 0
+
+    def busy(self):
+        return self.process is not None
+
+    def launch(self, chunk, cfg, cmsRunArgs, workDir):
+        chunk.attempts += 1
+        chunk.worker = self.index
+
+        cmd = ['cmsRun', cfg,
+               'inputFiles={}'.format(','.join(chunk.files)),
+               'outputFile={}'.format(chunk.output(workDir))] + cmsRunArgs
+
+        self.logFile = open(chunk.logFile(workDir), 'w')
+        self.logFile.write(' '.join(cmd) + '\n')
+        self.logFile.flush()
+
+        self.chunk = chunk
+        self.start = time.time()
+        self.process = subprocess.Popen(cmd, stdout=self.logFile,
+                                        stderr=subprocess.STDOUT)
+
+    def poll(self):
+        '''
+        If the running chunk finished, returns (chunk, exit code, seconds)
+        and frees the worker. Otherwise None.
+        '''
+        if self.process is None:
+            return None
+
+        status = self.process.poll()
+        if status is None:
+            return None
+
+        seconds = time.time() - self.start
+        self.logFile.close()
+
+        chunk = self.chunk
+        self.chunk = None
+        self.process = None
+
+        return (chunk, status, seconds)
+
+
+def nextChunk(worker, workers):
+    '''
+    The worker's own next chunk, or one stolen from the back of the longest
+    other queue.
+    '''
+    if worker.queue:
+        return worker.queue.popleft()
+
+    victim = max(workers, key=lambda w: len(w.queue))
+    if victim.queue:
+        worker.nStolen += 1
+        return victim.queue.pop()
+
+    return None
+
+
+def run(chunks, nWorkers, cfg, cmsRunArgs, workDir, maxAttempts):
+    workers = [Worker(i) for i in range(min(nWorkers, len(chunks)))]
+    for i, chunk in enumerate(chunks):
+        workers[i % len(workers)].queue.append(chunk)
+
+    nLeft = len(chunks)
+    while nLeft:
+        for w in workers:
+            finished = w.poll()
+            if finished:
+                chunk, status, seconds = finished
+                chunk.busySeconds += seconds
+                if status == 0:
+                    chunk.outputFile = chunk.findOutput(workDir)
+                    if chunk.outputFile is None:
+                        log.warning("Chunk %d finished but its output isn't "
+                                    "in %s", chunk.index, workDir)
+                        status = -1
+                if status == 0:
+                    chunk.done = True
+                    chunk.seconds = seconds
+                    chunk.nEvents = countEvents(chunk.outputFile)
+                    nLeft -= 1
+                    log.info("Chunk %d done in %.0f s (%d left)", chunk.index,
+                             seconds, nLeft)
+                elif chunk.attempts < maxAttempts:
+                    log.warning("Chunk %d failed with status %d, retrying "
+                                "(see %s)", chunk.index, status,
+                                chunk.logFile(workDir))
+                    w.queue.append(chunk)
+                else:
+                    log.error("Chunk %d failed %d times, giving up (see %s)",
+                              chunk.index, chunk.attempts,
+                              chunk.logFile(workDir))
+                    nLeft -= 1
+
+            if not w.busy():
+                chunk = nextChunk(w, workers)
+                if chunk:
+                    w.launch(chunk, cfg, cmsRunArgs, workDir)
+
+        time.sleep(0.2)
+
+    return workers
+
+
+def report(chunks, workers, wallSeconds):
+    print ''
+    print '{:>6} {:>6} {:>6} {:>9} {:>10} {:>9} {:>8}'.format(
+        'chunk', 'files', 'worker', 'seconds', 'events', 'events/s',
+        'attempts')
+    for c in sorted(chunks, key=lambda c: c.index):
+        if not c.done:
+            print '{:>6} {:>6} {:>6} {:>9} {:>10} {:>9} {:>8}'.format(
+                c.index, len(c.files), c.worker, 'FAILED', '', '', c.attempts)
+            continue
+
+        events = c.nEvents if c.nEvents is not None else '?'
+        rate = ('{:.1f}'.format(c.nEvents / c.seconds)
+                if c.nEvents is not None and c.seconds else '?')
+        print '{:>6} {:>6} {:>6} {:>9.1f} {:>10} {:>9} {:>8}'.format(
+            c.index, len(c.files), c.worker, c.seconds, events, rate,
+            c.attempts)
+
+    done = [c for c in chunks if c.done]
+    busySeconds = sum(c.busySeconds for c in chunks)
+    nEvents = sum(c.nEvents for c in done if c.nEvents is not None)
+
+    print ''
+    print '{} of {} chunks done in {:.0f} s with {} workers ({} chunks stolen)'.format(
+        len(done), len(chunks), wallSeconds, len(workers),
+        sum(w.nStolen for w in workers))
+    if wallSeconds > 0:
+        print 'Aggregate: {:.1f} events/s; workers busy {:.0f}% of the time'.format(
+            nEvents / wallSeconds,
+            100. * busySeconds / (wallSeconds * max(1, len(workers))))
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Run cmsRun over many files locally with several processes.')
+
+    parser.add_argument('-j', '--nWorkers', type=int, default=0,
+                        help='Number of cmsRun processes at once (default: number of cores).')
+    parser.add_argument('--input', type=str, required=True,
+                        help='Comma-separated input files. May contain '
+                        'wildcards or @fileList.txt.')
+    parser.add_argument('--output', type=str, required=True,
+                        help='Merged output file.')
+    parser.add_argument('--filesPerChunk', type=int, default=1,
+                        help='Input files per cmsRun process.')
+    parser.add_argument('--maxAttempts', type=int, default=3,
+                        help='Times to try each chunk before giving up.')
+    parser.add_argument('--workDir', type=str, default='',
+                        help='Where to put chunk outputs and logs (default: '
+                        'next to the output). Kept if anything fails.')
+    parser.add_argument('cfg', type=str,
+                        help='CMS config file to run.')
+    parser.add_argument('cmsRunArgs', nargs=argparse.REMAINDER,
+                        help="Arguments to cmsRun.")
+
+    args = parser.parse_args()
+
+    nWorkers = args.nWorkers
+    if nWorkers <= 0:
+        import multiprocessing
+        nWorkers = multiprocessing.cpu_count()
+
+    files = expandInput(args.input)
+    if not files:
+        raise IOError("No input files found in {}".format(args.input))
+
+    workDir = args.workDir
+    if not workDir:
+        workDir = os.path.splitext(os.path.abspath(args.output))[0] + '_chunks'
+    if not os.path.isdir(workDir):
+        os.makedirs(workDir)
+
+    chunks = makeChunks(files, args.filesPerChunk)
+    log.info("%d files in %d chunks, %d workers", len(files), len(chunks),
+             nWorkers)
+
+    start = time.time()
+    workers = run(chunks, nWorkers, args.cfg, args.cmsRunArgs, workDir,
+                  args.maxAttempts)
+    wallSeconds = time.time() - start
+
+    report(chunks, workers, wallSeconds)
+
+    outputs = [c.outputFile for c in sorted(chunks, key=lambda c: c.index)
+               if c.done]
+    if not outputs:
+        sys.exit(1)
+
+    log.info("Merging %d outputs into %s", len(outputs), args.output)
+    if find_executable('uwvvMergeNtuples'):
+        subprocess.check_call(['uwvvMergeNtuples', '-j', str(nWorkers),
+                               args.output] + outputs)
+    else:
+        subprocess.check_call(['hadd', '-f', args.output] + outputs)
+
+    if len(outputs) == len(chunks):
+        for c in chunks:
+            os.remove(c.outputFile)
+            os.remove(c.logFile(workDir))
+        if not os.listdir(workDir):
+            os.rmdir(workDir)
+    else:
+        log.error("%d chunks failed; their logs are in %s",
+                  len(chunks) - len(outputs), workDir)
+        sys.exit(1)
@@ -18,6 +18,9 @@ from socket import gethostname
 import logging
 import fnmatch
 from UWVV.Utilities.dbsinterface import get_das_info
+from UWVV.Utilities.jobPlanner import configKey, fixedJobs, formatSummary, \
+    groupByNFiles, parseFileLine, planJobs, readFileList, readThroughput, \
+    summarize
 import datetime
 from re import compile as _compileRE
 
@@ -37,6 +40,11 @@ def writeFarmoutCommand(cfg, jobid, dataset, fullDataset,
     fullDataset (str): full dataset name with path
     outdir (str): where to put the output
     args: command line arguments
+        If args['throughput'] is (events/second, startup seconds), jobs are
+        made to take about args['targetJobHours'] each instead of having
+        args['filesPerJob'] files, using the number of events in each file.
+        Since farmout needs the same number of files in every job, there is
+        one submission per job size if they're not all the same.
     '''
     user = os.environ['USER']
 
@@ -45,19 +53,18 @@ def writeFarmoutCommand(cfg, jobid, dataset, fullDataset,
     else:
         scratchDir = '/nfs_scratch'
 
-    submitDir = os.path.join(scratchDir, user, jobid, dataset, 'submit')
-
     cmsRunArgs = list(args.get('cmsRunArgs', []))
 
-    if os.path.exists(submitDir):
+    if os.path.exists(os.path.join(scratchDir, user, jobid, dataset, 'submit')):
         log.warning("Submit directory for sample %s already exists, skipping", dataset)
         return "# Submit directory for sample {} already exists, skipping".format(dataset)
 
-    log.info("Building submit files for sample %s", dataset)
-
-    dagDir = '/' + os.path.join(*(submitDir.split('/')[:-1]+['dags', 'dag']))
+    throughput = args.get('throughput', None)
 
-    dasFilesCmd = 'file dataset={}'.format(fullDataset)
+    if throughput:
+        dasFilesCmd = 'file dataset={} | grep file.name, file.nevents'.format(fullDataset)
+    else:
+        dasFilesCmd = 'file dataset={}'.format(fullDataset)
 
     # das throws a lot of exceptions, but they're usually transient, so try a
     # few times if needed
@@ -72,47 +79,78 @@ def writeFarmoutCommand(cfg, jobid, dataset, fullDataset,
         raise RuntimeError("Failed to get file list from DAS with exception {}."
                            " Check connection to client.".format(ex.message))
 
-    mkdirCmd = "mkdir -p {}inputs".format(dagDir)
-    os.system(mkdirCmd)
-    inputListFile = os.path.join(dagDir+"inputs", '{}_inputFiles.txt'.format(dataset))
-    with open(inputListFile, 'w') as f:
-        f.write('\n'.join(dasFiles))
-
-    cmds = [
-        'farmoutAnalysisJobs',
-        '--infer-cmssw-path',
-        '"--submit-dir={}"'.format(submitDir),
-        '"--output-dag-file={}"'.format(dagDir),
-        '"--output-dir={}"'.format(outdir.format(user=user, jobid=jobid, dataset=dataset)),
-        '--input-files-per-job={}'.format(args.get('filesPerJob', 1)),
-        '--input-file-list={}'.format(inputListFile),
-        '--assume-input-files-exist',
-        '--input-dir=/',
-        ]
-
-    if args.get('extraUsercodeFiles', []):
-        cmds.append('--extra-usercode-files="{}"'.format(' '.join(args.get('extraUsercodeFiles'))))
-
-    cmds.append('{}-{}'.format(jobid, dataset))
-    cmds.append(cfg)
-    cmds.append("'inputFiles=$inputFileNames'")
-    cmds.append("'outputFile=$outputFileName'")
-
-    if args.get('applyLumiMask', False):
-        lumiMask = args.get('lumiMaskJSON')
-
-        # Prepend with the standard JSON repository. If lumiMask is a full path
-        # (starting with '/'), path.join will ignore the first argument.
-        defaultJSONPath = '/afs/cern.ch/cms/CAF/CMSCOMM/COMM_DQM/certification/Collisions16/13TeV'
-        lumiMask = os.path.join(defaultJSONPath,
-                                lumiMask)
-        cmds.append('lumiMask={}'.format(lumiMask))
-
-    cmds += cmsRunArgs
-
-    command = '# Submit file for sample {}\n'.format(dataset)
-    command += 'mkdir -p {}\n'.format(os.path.dirname(dagDir))
-    command += ' '.join(cmds) + '\n'
+    # Each task is one farmout submission: (name, files, files per job)
+    if throughput:
+        eventsPerSecond, startupSeconds = throughput
+        jobs = planJobs([parseFileLine(l) for l in dasFiles], eventsPerSecond,
+                        args.get('targetJobHours', 4.) * 3600.,
+                        startupSeconds)
+        log.info(formatSummary(dataset, summarize(jobs, eventsPerSecond,
+                                                  startupSeconds)))
+
+        groups = groupByNFiles(jobs)
+        if len(groups) == 1:
+            tasks = [(dataset, groups.values()[0], groups.keys()[0])]
+        else:
+            tasks = [('{}_{}files'.format(dataset, n), files, n)
+                     for n, files in sorted(groups.items())]
+    else:
+        tasks = [(dataset, dasFiles, args.get('filesPerJob', 1))]
+
+    command = ''
+    for name, files, filesPerJob in tasks:
+        submitDir = os.path.join(scratchDir, user, jobid, name, 'submit')
+
+        if os.path.exists(submitDir):
+            log.warning("Submit directory for sample %s already exists, skipping", name)
+            command += "# Submit directory for sample {} already exists, skipping\n".format(name)
+            continue
+
+        log.info("Building submit files for sample %s", name)
+
+        dagDir = '/' + os.path.join(*(submitDir.split('/')[:-1]+['dags', 'dag']))
+
+        mkdirCmd = "mkdir -p {}inputs".format(dagDir)
+        os.system(mkdirCmd)
+        inputListFile = os.path.join(dagDir+"inputs", '{}_inputFiles.txt'.format(name))
+        with open(inputListFile, 'w') as f:
+            f.write('\n'.join(files))
+
+        cmds = [
+            'farmoutAnalysisJobs',
+            '--infer-cmssw-path',
+            '"--submit-dir={}"'.format(submitDir),
+            '"--output-dag-file={}"'.format(dagDir),
+            '"--output-dir={}"'.format(outdir.format(user=user, jobid=jobid, dataset=dataset)),
+            '--input-files-per-job={}'.format(filesPerJob),
+            '--input-file-list={}'.format(inputListFile),
+            '--assume-input-files-exist',
+            '--input-dir=/',
+            ]
+
+        if args.get('extraUsercodeFiles', []):
+            cmds.append('--extra-usercode-files="{}"'.format(' '.join(args.get('extraUsercodeFiles'))))
+
+        cmds.append('{}-{}'.format(jobid, name))
+        cmds.append(cfg)
+        cmds.append("'inputFiles=$inputFileNames'")
+        cmds.append("'outputFile=$outputFileName'")
+
+        if args.get('applyLumiMask', False):
+            lumiMask = args.get('lumiMaskJSON')
+
+            # Prepend with the standard JSON repository. If lumiMask is a full path
+            # (starting with '/'), path.join will ignore the first argument.
+            defaultJSONPath = '/afs/cern.ch/cms/CAF/CMSCOMM/COMM_DQM/certification/Collisions16/13TeV'
+            lumiMask = os.path.join(defaultJSONPath,
+                                    lumiMask)
+            cmds.append('lumiMask={}'.format(lumiMask))
+
+        cmds += cmsRunArgs
+
+        command += '# Submit file for sample {}\n'.format(name)
+        command += 'mkdir -p {}\n'.format(os.path.dirname(dagDir))
+        command += ' '.join(cmds) + '\n'
 
     return command
 
@@ -224,6 +262,21 @@ if __name__ == '__main__':
                         help = 'Where to put the output.  Default: %(default)s.')
     parser.add_argument('--filesPerJob', type=int, default=1,
                         help="Number of input files to pass to each job.")
+    parser.add_argument('--throughputProfile', type=str, default='',
+                        help='Throughput profile (from calibrateThroughput.py). '
+                        'If given, jobs are split to take about '
+                        '--targetJobHours each instead of by --filesPerJob.')
+    parser.add_argument('--throughputKey', type=str, default='',
+                        help='Configuration to use from the throughput '
+                        'profile (default: the channels argument to cmsRun).')
+    parser.add_argument('--targetJobHours', type=float, default=4.,
+                        help='Target wall time per job with --throughputProfile.')
+    parser.add_argument('--fileList', type=str, default='',
+                        help='With --planOnly, a local list of "file nEvents" '
+                        'lines to plan jobs for instead of querying DAS.')
+    parser.add_argument('--planOnly', action='store_true',
+                        help='Print the job plan for --fileList (compared to '
+                        '--filesPerJob files per job) and exit.')
     parser.add_argument('--extraUsercodeFiles', nargs='*', type=str,
                         help='List of extra directories that need to be '
                         'included in the user_code tarball sent with the job. '
@@ -235,10 +288,34 @@ if __name__ == '__main__':
 
     args = parser.parse_args()
 
+    throughput = None
+    if args.throughputProfile:
+        key = args.throughputKey if args.throughputKey else configKey(args.cmsRunArgs)
+        throughput = readThroughput(args.throughputProfile, key)
+        log.info("Using %.2f events/s, %.1f s startup for %s", throughput[0],
+                 throughput[1], key)
+
+    if args.planOnly:
+        if not (args.fileList and throughput):
+            parser.error("--planOnly needs --fileList and --throughputProfile")
+
+        files = readFileList(args.fileList)
+        jobs = planJobs(files, throughput[0], args.targetJobHours * 3600.,
+                        throughput[1])
+
+        print formatSummary('{} files per job'.format(args.filesPerJob),
+                            summarize(fixedJobs(files, args.filesPerJob),
+                                      *throughput))
+        print formatSummary('planned', summarize(jobs, *throughput))
+        for n, groupFiles in sorted(groupByNFiles(jobs).items()):
+            print '    {} jobs with {} files'.format(len(groupFiles) / n, n)
+        sys.exit(0)
+
     buildScript(args.cfg, args.jobid, args.scriptFile, args.outdir,
                 *args.samples, applyLumiMask=args.applyLumiMask,
                 lumiMaskJSON=args.lumiMaskJSON, campaign=args.campaign,
                 dataEra=args.dataEra, filesPerJob=args.filesPerJob,
                 extraUsercodeFiles=args.extraUsercodeFiles,
-                cmsRunArgs=args.cmsRunArgs)
+                cmsRunArgs=args.cmsRunArgs, throughput=throughput,
+                targetJobHours=args.targetJobHours)
 
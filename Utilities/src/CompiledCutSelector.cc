@@ -0,0 +1,396 @@
+#include "UWVV/Utilities/interface/CompiledCutSelector.h"
+
+#include <cctype>
+#include <cstdlib>
+
+
+namespace uwvv
+{
+
+  namespace cut
+  {
+    namespace
+    {
+      enum class Tok {Ident, Number, String, LParen, RParen, Dot, Comma,
+                      And, Or, Not, Compare, End};
+
+      struct Token
+      {
+        Tok type;
+        std::string text;
+        double number;
+        Op op;
+      };
+
+      bool tokenize(const std::string& s, std::vector<Token>& out)
+      {
+        size_t i = 0;
+        while(i < s.size())
+          {
+            char c = s[i];
+            Token t;
+            t.number = 0.;
+            t.op = Op::NE;
+
+            if(std::isspace(static_cast<unsigned char>(c)))
+              {
+                ++i;
+                continue;
+              }
+
+            if(std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+              {
+                size_t j = i;
+                while(j < s.size() &&
+                      (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '_'))
+                  ++j;
+                t.type = Tok::Ident;
+                t.text = s.substr(i, j - i);
+                i = j;
+              }
+            else if(std::isdigit(static_cast<unsigned char>(c)) || c == '.' ||
+                    // sign of a number right after a comparison
+                    ((c == '-' || c == '+') && !out.empty() &&
+                     out.back().type == Tok::Compare))
+              {
+                // A dot followed by a letter is an accessor, not a number
+                if(c == '.' &&
+                   (i + 1 >= s.size() || !std::isdigit(static_cast<unsigned char>(s[i+1]))))
+                  {
+                    t.type = Tok::Dot;
+                    ++i;
+                  }
+                else
+                  {
+                    const char* begin = s.c_str() + i;
+                    char* end = 0;
+                    t.type = Tok::Number;
+                    t.number = std::strtod(begin, &end);
+                    if(end == begin)
+                      return false;
+                    i += end - begin;
+                  }
+              }
+            else if(c == '"' || c == '\'')
+              {
+                size_t j = s.find(c, i + 1);
+                if(j == std::string::npos)
+                  return false;
+                t.type = Tok::String;
+                t.text = s.substr(i + 1, j - i - 1);
+                i = j + 1;
+              }
+            else
+              {
+                std::string two = s.substr(i, 2);
+                size_t len = 1;
+                if(two == "&&")
+                  {
+                    t.type = Tok::And;
+                    len = 2;
+                  }
+                else if(two == "||")
+                  {
+                    t.type = Tok::Or;
+                    len = 2;
+                  }
+                else if(two == "<=" || two == ">=" || two == "==" || two == "!=")
+                  {
+                    t.type = Tok::Compare;
+                    t.op = (two == "<=" ? Op::LE :
+                            two == ">=" ? Op::GE :
+                            two == "==" ? Op::EQ : Op::NE);
+                    len = 2;
+                  }
+                else if(c == '<' || c == '>' || c == '=')
+                  {
+                    t.type = Tok::Compare;
+                    t.op = (c == '<' ? Op::LT : c == '>' ? Op::GT : Op::EQ);
+                  }
+                else if(c == '!')
+                  t.type = Tok::Not;
+                else if(c == '(')
+                  t.type = Tok::LParen;
+                else if(c == ')')
+                  t.type = Tok::RParen;
+                else if(c == ',')
+                  t.type = Tok::Comma;
+                else
+                  return false; // arithmetic, ternary, etc.
+
+                i += len;
+              }
+
+            out.push_back(t);
+          }
+
+        Token end;
+        end.type = Tok::End;
+        end.number = 0.;
+        end.op = Op::NE;
+        out.push_back(end);
+
+        return true;
+      }
+
+
+      // number op value is the same as value flip(op) number
+      Op flip(Op op)
+      {
+        switch(op)
+          {
+          case Op::LT:
+            return Op::GT;
+          case Op::LE:
+            return Op::GE;
+          case Op::GT:
+            return Op::LT;
+          case Op::GE:
+            return Op::LE;
+          default:
+            return op;
+          }
+      }
+
+
+      // Recursive descent over the token list. Every method returns false
+      // as soon as it sees something it doesn't handle.
+      class Parser
+      {
+       public:
+        Parser(const std::vector<Token>& tokens) : toks(tokens), pos(0) {;}
+
+        bool parseAll(Node& out)
+        {
+          if(toks[pos].type == Tok::End)
+            {
+              out.kind = Node::And;
+              return true;
+            }
+
+          return parseOr(out) && toks[pos].type == Tok::End;
+        }
+
+       private:
+        const Token& peek() const {return toks[pos];}
+        bool accept(Tok type)
+        {
+          if(toks[pos].type != type)
+            return false;
+          ++pos;
+          return true;
+        }
+
+        bool parseOr(Node& out)
+        {
+          return parseList(out, Node::Or, Tok::Or);
+        }
+
+        bool parseAnd(Node& out)
+        {
+          return parseList(out, Node::And, Tok::And);
+        }
+
+        bool parseList(Node& out, Node::Kind kind, Tok sep)
+        {
+          Node first;
+          if(!(kind == Node::Or ? parseAnd(first) : parseUnary(first)))
+            return false;
+
+          if(peek().type != sep)
+            {
+              out = first;
+              return true;
+            }
+
+          out = Node();
+          out.kind = kind;
+          out.children.push_back(first);
+          while(accept(sep))
+            {
+              Node next;
+              if(!(kind == Node::Or ? parseAnd(next) : parseUnary(next)))
+                return false;
+              out.children.push_back(next);
+            }
+
+          return true;
+        }
+
+        bool parseUnary(Node& out)
+        {
+          if(accept(Tok::Not))
+            {
+              Node inner;
+              if(!parseUnary(inner))
+                return false;
+              out = Node();
+              out.kind = Node::Not;
+              out.children.push_back(inner);
+              return true;
+            }
+
+          if(accept(Tok::LParen))
+            return parseOr(out) && accept(Tok::RParen);
+
+          return parseComparison(out);
+        }
+
+        // value, value op number, number op value, or number op value op number
+        bool parseComparison(Node& out)
+        {
+          bool firstIsNumber = (peek().type == Tok::Number);
+          double firstNumber = peek().number;
+          Value value;
+
+          if(firstIsNumber)
+            ++pos;
+          else if(!parseValue(value))
+            return false;
+
+          if(peek().type != Tok::Compare)
+            {
+              if(firstIsNumber)
+                return false;
+              out = Node();
+              out.kind = Node::Truth;
+              out.value = value;
+              return true;
+            }
+
+          Op op1 = peek().op;
+          ++pos;
+
+          if(!firstIsNumber)
+            {
+              if(peek().type != Tok::Number)
+                return false;
+              out = Node();
+              out.kind = Node::Compare;
+              out.value = value;
+              out.op = op1;
+              out.number = peek().number;
+              ++pos;
+              return true;
+            }
+
+          if(!parseValue(value))
+            return false;
+
+          Node lower;
+          lower.kind = Node::Compare;
+          lower.value = value;
+          lower.op = flip(op1);
+          lower.number = firstNumber;
+
+          if(peek().type != Tok::Compare)
+            {
+              out = lower;
+              return true;
+            }
+
+          Op op2 = peek().op;
+          ++pos;
+          if(peek().type != Tok::Number)
+            return false;
+
+          Node upper;
+          upper.kind = Node::Compare;
+          upper.value = value;
+          upper.op = op2;
+          upper.number = peek().number;
+          ++pos;
+
+          out = Node();
+          out.kind = Node::And;
+          out.children.push_back(lower);
+          out.children.push_back(upper);
+          return true;
+        }
+
+        bool parseValue(Value& out)
+        {
+          if(peek().type == Tok::Ident && peek().text == "abs" &&
+             toks[pos+1].type == Tok::LParen)
+            {
+              pos += 2;
+              if(!parseValue(out) || !accept(Tok::RParen))
+                return false;
+              // abs(abs(x)) is fine, anything fancier isn't expected
+              out.abs = true;
+              return true;
+            }
+
+          while(true)
+            {
+              if(peek().type != Tok::Ident)
+                return false;
+              std::string name = peek().text;
+              ++pos;
+
+              bool hasArg = false;
+              Token arg;
+              if(accept(Tok::LParen))
+                {
+                  if(peek().type == Tok::String || peek().type == Tok::Number)
+                    {
+                      arg = peek();
+                      hasArg = true;
+                      ++pos;
+                    }
+                  if(!accept(Tok::RParen))
+                    return false;
+                }
+
+              if(name == "daughter")
+                {
+                  if(!hasArg)
+                    return false;
+
+                  DaughterStep step;
+                  step.byName = (arg.type == Tok::String);
+                  step.name = arg.text;
+                  step.index = 0;
+                  if(!step.byName)
+                    {
+                      if(arg.number < 0. || arg.number != unsigned(arg.number))
+                        return false;
+                      step.index = unsigned(arg.number);
+                    }
+                  out.path.push_back(step);
+
+                  // a daughter on its own isn't a number
+                  if(!accept(Tok::Dot))
+                    return false;
+                  continue;
+                }
+
+              if(hasArg && arg.type != Tok::String)
+                return false;
+
+              out.method = name;
+              out.arg = (hasArg ? arg.text : "");
+
+              // Methods of methods (e.g. superCluster.eta) need reflection
+              return peek().type != Tok::Dot;
+            }
+        }
+
+        const std::vector<Token>& toks;
+        size_t pos;
+      };
+    } // namespace
+
+
+    bool parse(const std::string& cut, Node& out)
+    {
+      std::vector<Token> tokens;
+      if(!tokenize(cut, tokens))
+        return false;
+
+      Parser parser(tokens);
+      return parser.parseAll(out);
+    }
+  } // namespace cut
+
+} // namespace uwvv
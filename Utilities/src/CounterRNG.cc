@@ -0,0 +1,120 @@
+#include "UWVV/Utilities/interface/CounterRNG.h"
+
+#include <cmath>
+
+
+namespace uwvv
+{
+
+  namespace random
+  {
+    namespace
+    {
+      // Constants from the Random123 reference implementation
+      const uint32_t philoxM0 = 0xD2511F53;
+      const uint32_t philoxM1 = 0xCD9E8D57;
+      const uint32_t philoxW0 = 0x9E3779B9;
+      const uint32_t philoxW1 = 0xBB67AE85;
+
+      inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+      {
+        uint64_t product = uint64_t(a) * uint64_t(b);
+        hi = uint32_t(product >> 32);
+        lo = uint32_t(product);
+      }
+
+      inline void philoxRound(PhiloxCounter& ctr, const PhiloxKey& key)
+      {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(philoxM0, ctr[0], hi0, lo0);
+        mulhilo(philoxM1, ctr[2], hi1, lo1);
+
+        ctr = {{hi1 ^ ctr[1] ^ key[0], lo1, hi0 ^ ctr[3] ^ key[1], lo0}};
+      }
+
+      // (0, 1], never 0 so it's safe to take the log
+      inline double toUniform(uint32_t x)
+      {
+        return (double(x) + 1.) * (1. / 4294967296.);
+      }
+
+      // Box-Muller on two pairs of words
+      inline void toGaussians(const PhiloxCounter& words, float* out)
+      {
+        const double twoPi = 2. * M_PI;
+
+        for(size_t i = 0; i < 2; ++i)
+          {
+            double r = std::sqrt(-2. * std::log(toUniform(words[2*i])));
+            double theta = twoPi * toUniform(words[2*i+1]);
+            out[2*i] = r * std::cos(theta);
+            out[2*i+1] = r * std::sin(theta);
+          }
+      }
+    } // anonymous namespace
+
+
+    PhiloxCounter philox4x32(PhiloxCounter ctr, PhiloxKey key)
+    {
+      for(size_t round = 0; round < 10; ++round)
+        {
+          if(round)
+            {
+              key[0] += philoxW0;
+              key[1] += philoxW1;
+            }
+          philoxRound(ctr, key);
+        }
+
+      return ctr;
+    }
+
+
+    EventRandom::EventRandom(uint32_t run, uint32_t lumi, uint64_t event,
+                             uint32_t seed) :
+      key({{run, seed}}),
+      lumi(lumi),
+      event(event)
+    {
+    }
+
+
+    PhiloxCounter EventRandom::block(uint32_t iBlock) const
+    {
+      PhiloxCounter ctr = {{uint32_t(event), uint32_t(event >> 32), lumi, iBlock}};
+      return philox4x32(ctr, key);
+    }
+
+
+    double EventRandom::uniform(uint32_t i) const
+    {
+      return toUniform(block(i / 4)[i % 4]);
+    }
+
+
+    float EventRandom::gaussian(uint32_t i) const
+    {
+      float out[4];
+      toGaussians(block(i / 4), out);
+      return out[i % 4];
+    }
+
+
+    void EventRandom::gaussians(size_t n, float* out) const
+    {
+      size_t i = 0;
+      for(; i + 4 <= n; i += 4)
+        toGaussians(block(i / 4), out + i);
+
+      if(i < n)
+        {
+          float tail[4];
+          toGaussians(block(i / 4), tail);
+          for(size_t j = 0; i + j < n; ++j)
+            out[i + j] = tail[j];
+        }
+    }
+
+  } // namespace random
+
+} // namespace uwvv
@@ -0,0 +1,155 @@
+#include "UWVV/Utilities/interface/CutflowTable.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#include "TTree.h"
+
+
+namespace uwvv
+{
+
+  namespace cutflow
+  {
+    void branchTree(TTree& tree, Row& row)
+    {
+      tree.Branch("step", &row.step);
+      tree.Branch("module", &row.module);
+      tree.Branch("object", &row.object);
+      tree.Branch("newObject", &row.newObject);
+      tree.Branch("nEvents", &row.counts.nEvents);
+      tree.Branch("nIn", &row.counts.nIn);
+      tree.Branch("nOut", &row.counts.nOut);
+      tree.Branch("nEventsIn", &row.counts.nEventsIn);
+      tree.Branch("nEventsOut", &row.counts.nEventsOut);
+      tree.Branch("nMissing", &row.counts.nMissing);
+    }
+
+
+    std::vector<Row> readTree(TTree& tree)
+    {
+      std::string* step = 0;
+      std::string* module = 0;
+      std::string* object = 0;
+      bool newObject = false;
+      Counts counts;
+
+      if(tree.SetBranchAddress("step", &step) < 0 ||
+         tree.SetBranchAddress("module", &module) < 0 ||
+         tree.SetBranchAddress("object", &object) < 0 ||
+         tree.SetBranchAddress("newObject", &newObject) < 0 ||
+         tree.SetBranchAddress("nEvents", &counts.nEvents) < 0 ||
+         tree.SetBranchAddress("nIn", &counts.nIn) < 0 ||
+         tree.SetBranchAddress("nOut", &counts.nOut) < 0 ||
+         tree.SetBranchAddress("nEventsIn", &counts.nEventsIn) < 0 ||
+         tree.SetBranchAddress("nEventsOut", &counts.nEventsOut) < 0 ||
+         tree.SetBranchAddress("nMissing", &counts.nMissing) < 0)
+        throw std::runtime_error(std::string("Tree ") + tree.GetName() +
+                                 " is not a cutflow tree");
+
+      std::vector<Row> out;
+      std::map<std::tuple<std::string, std::string, std::string>, size_t> positions;
+
+      const long long nEntries = tree.GetEntries();
+      for(long long i = 0; i < nEntries; ++i)
+        {
+          tree.GetEntry(i);
+
+          auto key = std::make_tuple(*step, *module, *object);
+          auto found = positions.find(key);
+          if(found == positions.end())
+            {
+              positions[key] = out.size();
+              out.push_back(Row{*step, *module, *object, newObject, counts});
+            }
+          else
+            out[found->second].counts.add(counts);
+        }
+
+      tree.ResetBranchAddresses();
+      delete step;
+      delete module;
+      delete object;
+
+      return out;
+    }
+
+
+    std::string makeTable(const std::vector<Row>& rows)
+    {
+      std::ostringstream out;
+
+      out << std::left << std::setw(28) << "step" << std::setw(36) << "module"
+          << std::setw(10) << "object" << std::right
+          << std::setw(12) << "in/evt" << std::setw(12) << "out/evt"
+          << std::setw(10) << "kept %" << std::setw(12) << "evts out %"
+          << std::endl;
+
+      // Objects dropped by a module after this many earlier modules had
+      // already worked on them, per module
+      std::map<std::string, unsigned> nModulesOnObject;
+      std::vector<std::pair<double, size_t> > wasted;
+      std::vector<std::pair<unsigned long long, size_t> > pruned;
+
+      for(size_t i = 0; i < rows.size(); ++i)
+        {
+          const Row& r = rows[i];
+          const Counts& c = r.counts;
+          const double nEvents = std::max(c.nEvents, 1ULL);
+
+          out << std::left << std::setw(28) << r.step << std::setw(36) << r.module
+              << std::setw(10) << r.object << std::right << std::fixed
+              << std::setprecision(3)
+              << std::setw(12) << c.nIn / nEvents
+              << std::setw(12) << c.nOut / nEvents
+              << std::setprecision(1);
+          if(!r.newObject && c.nIn)
+            out << std::setw(10) << 100. * c.nOut / c.nIn;
+          else
+            out << std::setw(10) << "new";
+          out << std::setw(12) << 100. * c.nEventsOut / nEvents << std::endl;
+
+          unsigned& nBefore = nModulesOnObject[r.object];
+          if(r.newObject)
+            nBefore = 0;
+
+          if(!r.newObject && c.nIn > c.nOut)
+            {
+              pruned.push_back(std::make_pair(c.nIn - c.nOut, i));
+              if(nBefore)
+                wasted.push_back(std::make_pair(double(c.nIn - c.nOut) * nBefore, i));
+            }
+
+          ++nBefore;
+        }
+
+      std::sort(pruned.rbegin(), pruned.rend());
+      std::sort(wasted.rbegin(), wasted.rend());
+
+      out << std::endl << "Modules removing the most objects:" << std::endl;
+      for(size_t i = 0; i < pruned.size() && i < 10; ++i)
+        {
+          const Row& r = rows[pruned[i].second];
+          out << "    " << r.module << " (" << r.object << "): removes "
+              << pruned[i].first << " of " << r.counts.nIn << std::endl;
+        }
+
+      out << std::endl << "Cuts that might go earlier (objects removed times "
+          << "earlier modules that processed them):" << std::endl;
+      for(size_t i = 0; i < wasted.size() && i < 10; ++i)
+        {
+          const Row& r = rows[wasted[i].second];
+          out << "    " << r.module << " (" << r.object << ", " << r.step
+              << "): " << std::setprecision(0) << wasted[i].first << std::endl;
+        }
+
+      return out.str();
+    }
+
+  } // namespace cutflow
+
+} // namespace uwvv
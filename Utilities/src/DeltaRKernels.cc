@@ -0,0 +1,205 @@
+#include "UWVV/Utilities/interface/DeltaRKernels.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UWVV_DELTAR_SSE2
+#endif
+
+
+namespace uwvv
+{
+
+  namespace deltaR
+  {
+
+#ifdef UWVV_DELTAR_SSE2
+    namespace
+    {
+      // deltaR^2 between (eta, phi) and four objects at once.
+      // Phi is wrapped by subtracting the nearest multiple of 2pi, which is
+      // the same thing reco::deltaPhi does for out-of-range values and is a
+      // no-op for values already in [-pi, pi].
+      inline __m128 deltaR2x4(const __m128 eta, const __m128 phi,
+                              const float* etas, const float* phis)
+      {
+        const __m128 o2pi = _mm_set1_ps(1. / (2. * M_PI));
+        const __m128 twoPi = _mm_set1_ps(2. * M_PI);
+
+        __m128 dEta = _mm_sub_ps(eta, _mm_loadu_ps(etas));
+        __m128 dPhi = _mm_sub_ps(phi, _mm_loadu_ps(phis));
+
+        __m128 nTurns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(dPhi, o2pi)));
+        dPhi = _mm_sub_ps(dPhi, _mm_mul_ps(nTurns, twoPi));
+
+        return _mm_add_ps(_mm_mul_ps(dEta, dEta), _mm_mul_ps(dPhi, dPhi));
+      }
+    } // anonymous namespace
+#endif
+
+
+    void deltaR2OneToMany(float eta, float phi,
+                          const float* etas, const float* phis, size_t n,
+                          float* out)
+    {
+      size_t i = 0;
+
+#ifdef UWVV_DELTAR_SSE2
+      const __m128 vEta = _mm_set1_ps(eta);
+      const __m128 vPhi = _mm_set1_ps(phi);
+
+      for(; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, deltaR2x4(vEta, vPhi, etas + i, phis + i));
+#endif
+
+      for(; i < n; ++i)
+        out[i] = deltaR2(eta, phi, etas[i], phis[i]);
+    }
+
+
+    void deltaROneToMany(float eta, float phi,
+                         const float* etas, const float* phis, size_t n,
+                         float* out)
+    {
+      size_t i = 0;
+
+#ifdef UWVV_DELTAR_SSE2
+      const __m128 vEta = _mm_set1_ps(eta);
+      const __m128 vPhi = _mm_set1_ps(phi);
+
+      for(; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(deltaR2x4(vEta, vPhi, etas + i, phis + i)));
+#endif
+
+      for(; i < n; ++i)
+        out[i] = std::sqrt(deltaR2(eta, phi, etas[i], phis[i]));
+    }
+
+
+    void deltaR2Matrix(const float* etasA, const float* phisA, size_t nA,
+                       const float* etasB, const float* phisB, size_t nB,
+                       float* out)
+    {
+      for(size_t iA = 0; iA < nA; ++iA)
+        deltaR2OneToMany(etasA[iA], phisA[iA], etasB, phisB, nB, out + iA * nB);
+    }
+
+
+    size_t markWithinDeltaR(float eta, float phi,
+                            const float* etas, const float* phis, size_t n,
+                            float dRMax, unsigned char* mask)
+    {
+      const float dR2Max = dRMax * dRMax;
+      size_t nMarked = 0;
+      size_t i = 0;
+
+#ifdef UWVV_DELTAR_SSE2
+      const __m128 vEta = _mm_set1_ps(eta);
+      const __m128 vPhi = _mm_set1_ps(phi);
+      const __m128 vCut = _mm_set1_ps(dR2Max);
+
+      for(; i + 4 <= n; i += 4)
+        {
+          int inCone = _mm_movemask_ps(_mm_cmplt_ps(deltaR2x4(vEta, vPhi, etas + i, phis + i),
+                                                    vCut));
+          if(!inCone)
+            continue;
+
+          for(size_t j = 0; j < 4; ++j)
+            {
+              if((inCone >> j) & 1 && !mask[i+j])
+                {
+                  mask[i+j] = 1;
+                  ++nMarked;
+                }
+            }
+        }
+#endif
+
+      for(; i < n; ++i)
+        {
+          if(!mask[i] && deltaR2(eta, phi, etas[i], phis[i]) < dR2Max)
+            {
+              mask[i] = 1;
+              ++nMarked;
+            }
+        }
+
+      return nMarked;
+    }
+
+
+    bool anyWithinDeltaR(float eta, float phi,
+                         const float* etas, const float* phis, size_t n,
+                         float dRMax)
+    {
+      const float dR2Max = dRMax * dRMax;
+      size_t i = 0;
+
+#ifdef UWVV_DELTAR_SSE2
+      const __m128 vEta = _mm_set1_ps(eta);
+      const __m128 vPhi = _mm_set1_ps(phi);
+      const __m128 vCut = _mm_set1_ps(dR2Max);
+
+      for(; i + 4 <= n; i += 4)
+        {
+          if(_mm_movemask_ps(_mm_cmplt_ps(deltaR2x4(vEta, vPhi, etas + i, phis + i), vCut)))
+            return true;
+        }
+#endif
+
+      for(; i < n; ++i)
+        {
+          if(deltaR2(eta, phi, etas[i], phis[i]) < dR2Max)
+            return true;
+        }
+
+      return false;
+    }
+
+
+    namespace scalar
+    {
+      void deltaR2OneToMany(float eta, float phi,
+                            const float* etas, const float* phis, size_t n,
+                            float* out)
+      {
+        for(size_t i = 0; i < n; ++i)
+          out[i] = deltaR2(eta, phi, etas[i], phis[i]);
+      }
+
+
+      void deltaR2Matrix(const float* etasA, const float* phisA, size_t nA,
+                         const float* etasB, const float* phisB, size_t nB,
+                         float* out)
+      {
+        for(size_t iA = 0; iA < nA; ++iA)
+          {
+            for(size_t iB = 0; iB < nB; ++iB)
+              out[iA * nB + iB] = deltaR2(etasA[iA], phisA[iA], etasB[iB], phisB[iB]);
+          }
+      }
+
+
+      size_t markWithinDeltaR(float eta, float phi,
+                              const float* etas, const float* phis, size_t n,
+                              float dRMax, unsigned char* mask)
+      {
+        const float dR2Max = dRMax * dRMax;
+        size_t nMarked = 0;
+
+        for(size_t i = 0; i < n; ++i)
+          {
+            if(!mask[i] && deltaR2(eta, phi, etas[i], phis[i]) < dR2Max)
+              {
+                mask[i] = 1;
+                ++nMarked;
+              }
+          }
+
+        return nMarked;
+      }
+    } // namespace scalar
+
+  } // namespace deltaR
+
+} // namespace uwvv
@@ -0,0 +1,254 @@
+#include "UWVV/Utilities/interface/DuplicateEventFinder.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+
+namespace uwvv
+{
+
+  namespace
+  {
+    // splitmix64 finalizer; packed keys are far from uniform
+    inline uint64_t mix(uint64_t x)
+    {
+      x ^= x >> 30;
+      x *= 0xbf58476d1ce4e5b9ULL;
+      x ^= x >> 27;
+      x *= 0x94d049bb133111ebULL;
+      x ^= x >> 31;
+      return x;
+    }
+
+    // Keep the table at most half full
+    size_t tableSize(size_t n)
+    {
+      size_t size = 16;
+      while(size < 2 * n)
+        size <<= 1;
+      return size;
+    }
+  }
+
+
+  size_t EventKeySet::memoryNeeded(size_t n)
+  {
+    return tableSize(n) * sizeof(uint64_t);
+  }
+
+
+  void EventKeySet::reserve(size_t n)
+  {
+    if(tableSize(n) > slots.size())
+      rehash(tableSize(n));
+  }
+
+
+  bool EventKeySet::insert(uint64_t key)
+  {
+    if(slots.empty() || 2 * (nKeys + 1) > slots.size())
+      rehash(tableSize(nKeys + 1));
+
+    for(size_t i = mix(key) & mask; ; i = (i + 1) & mask)
+      {
+        if(slots[i] == key)
+          return false;
+        if(!slots[i])
+          {
+            slots[i] = key;
+            ++nKeys;
+            return true;
+          }
+      }
+  }
+
+
+  void EventKeySet::rehash(size_t newSize)
+  {
+    std::vector<uint64_t> old;
+    old.swap(slots);
+
+    slots.assign(newSize, 0);
+    mask = newSize - 1;
+
+    for(uint64_t key : old)
+      {
+        if(!key)
+          continue;
+
+        size_t i = mix(key) & mask;
+        while(slots[i])
+          i = (i + 1) & mask;
+        slots[i] = key;
+      }
+  }
+
+
+  DuplicateEventFinder::DuplicateEventFinder(size_t nEntries,
+                                             size_t memoryLimit) :
+    external(memoryLimit && EventKeySet::memoryNeeded(nEntries) > memoryLimit),
+    chunkSize(external ?
+              std::max<size_t>(memoryLimit / sizeof(KeyAndEntry), 1024) :
+              0),
+    nKeptEntries(0)
+  {
+    keep.reserve(nEntries);
+
+    if(external)
+      chunk.reserve(std::min(chunkSize, nEntries));
+    else
+      keys.reserve(nEntries);
+  }
+
+
+  DuplicateEventFinder::~DuplicateEventFinder()
+  {
+    for(std::FILE* f : spilled)
+      std::fclose(f);
+  }
+
+
+  bool DuplicateEventFinder::pack(unsigned run, unsigned long long evt,
+                                  uint64_t& key)
+  {
+    if(run >= (1U << 19) || evt >= (1ULL << 45))
+      return false;
+
+    key = (uint64_t(run) << 45) | evt;
+    return key != 0; // zero marks an empty slot
+  }
+
+
+  void DuplicateEventFinder::add(unsigned run, unsigned long long evt)
+  {
+    uint64_t key;
+    if(!pack(run, evt, key))
+      {
+        bool isNew = unpackable.insert(std::make_pair(run, evt)).second;
+        keep.push_back(isNew);
+        nKeptEntries += isNew;
+        return;
+      }
+
+    if(!external)
+      {
+        bool isNew = keys.insert(key);
+        keep.push_back(isNew);
+        nKeptEntries += isNew;
+        return;
+      }
+
+    // decided in finish()
+    chunk.push_back(std::make_pair(key, uint64_t(keep.size())));
+    keep.push_back(false);
+
+    if(chunk.size() >= chunkSize)
+      spill();
+  }
+
+
+  void DuplicateEventFinder::spill()
+  {
+    std::sort(chunk.begin(), chunk.end());
+
+    std::FILE* f = std::tmpfile();
+    if(!f)
+      throw cms::Exception("FileOpenError")
+        << "Couldn't open a temporary file for sorting events" << std::endl;
+
+    if(std::fwrite(chunk.data(), sizeof(KeyAndEntry), chunk.size(), f) != chunk.size())
+      throw cms::Exception("FileWriteError")
+        << "Couldn't write sorted events to a temporary file" << std::endl;
+
+    std::rewind(f);
+    spilled.push_back(f);
+    spilledSizes.push_back(chunk.size());
+    chunk.clear();
+  }
+
+
+  void DuplicateEventFinder::finish()
+  {
+    if(!external)
+      return;
+
+    // The last chunk stays in memory
+    std::sort(chunk.begin(), chunk.end());
+
+    // Merge all the sorted runs; the first pair for each key has the
+    // lowest entry number
+    struct Source
+    {
+      std::FILE* file;
+      size_t left;
+      std::vector<KeyAndEntry> buffer;
+      size_t pos;
+    };
+
+    const size_t bufferSize = std::max<size_t>(chunkSize / (spilled.size() + 1), 256);
+
+    std::vector<Source> sources;
+    for(size_t i = 0; i < spilled.size(); ++i)
+      sources.push_back(Source{spilled[i], spilledSizes[i], std::vector<KeyAndEntry>(), 0});
+
+    auto refill = [bufferSize](Source& s) -> bool
+      {
+        if(s.pos < s.buffer.size())
+          return true;
+        if(!s.left)
+          return false;
+
+        s.buffer.resize(std::min(bufferSize, s.left));
+        if(std::fread(s.buffer.data(), sizeof(KeyAndEntry), s.buffer.size(), s.file) != s.buffer.size())
+          throw cms::Exception("FileReadError")
+            << "Couldn't read sorted events back from a temporary file"
+            << std::endl;
+        s.left -= s.buffer.size();
+        s.pos = 0;
+        return true;
+      };
+
+    typedef std::pair<KeyAndEntry, size_t> Head; // value, which source
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+
+    for(size_t i = 0; i < sources.size(); ++i)
+      {
+        if(refill(sources[i]))
+          heads.push(Head(sources[i].buffer[sources[i].pos++], i));
+      }
+    size_t chunkPos = 0;
+
+    bool first = true;
+    uint64_t lastKey = 0;
+    while(!heads.empty() || chunkPos < chunk.size())
+      {
+        KeyAndEntry next;
+        if(chunkPos < chunk.size() &&
+           (heads.empty() || chunk[chunkPos] < heads.top().first))
+          next = chunk[chunkPos++];
+        else
+          {
+            Head h = heads.top();
+            heads.pop();
+            next = h.first;
+
+            Source& s = sources[h.second];
+            if(refill(s))
+              heads.push(Head(s.buffer[s.pos++], h.second));
+          }
+
+        if(first || next.first != lastKey)
+          {
+            keep[next.second] = true;
+            ++nKeptEntries;
+          }
+        first = false;
+        lastKey = next.first;
+      }
+
+    std::vector<KeyAndEntry>().swap(chunk);
+  }
+
+} // namespace uwvv
@@ -0,0 +1,64 @@
+#include "UWVV/Utilities/interface/EtaSortedCandidates.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "DataFormats/Math/interface/deltaPhi.h"
+
+
+namespace uwvv
+{
+
+  void EtaSortedCandidates::add(float eta, float phi, float pt)
+  {
+    eta_.push_back(eta);
+    phi_.push_back(phi);
+    pt_.push_back(pt);
+  }
+
+
+  void EtaSortedCandidates::sort()
+  {
+    std::vector<size_t> order(eta_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) {return eta_[a] < eta_[b];});
+
+    std::vector<float> eta, phi, pt;
+    eta.reserve(order.size());
+    phi.reserve(order.size());
+    pt.reserve(order.size());
+    for(size_t i : order)
+      {
+        eta.push_back(eta_[i]);
+        phi.push_back(phi_[i]);
+        pt.push_back(pt_[i]);
+      }
+
+    eta_.swap(eta);
+    phi_.swap(phi);
+    pt_.swap(pt);
+  }
+
+
+  double EtaSortedCandidates::sumPtInCone(float eta, float phi, float dRMax,
+                                          float dRVeto) const
+  {
+    auto first = std::lower_bound(eta_.begin(), eta_.end(), eta - dRMax);
+    auto last = std::upper_bound(first, eta_.end(), eta + dRMax);
+
+    double sum = 0.;
+    for(size_t i = first - eta_.begin(); i < size_t(last - eta_.begin()); ++i)
+      {
+        float dEta = eta - eta_[i];
+        float dPhi = reco::deltaPhi(phi, phi_[i]);
+        float dR = std::sqrt(dEta * dEta + dPhi * dPhi);
+        if(dR < dRMax && dR > dRVeto)
+          sum += pt_[i];
+      }
+
+    return sum;
+  }
+
+} // namespace uwvv
@@ -0,0 +1,327 @@
+#include "UWVV/Utilities/interface/EventIndex.h"
+
+#include <algorithm>
+
+#include "TBranch.h"
+#include "TDirectory.h"
+#include "TTree.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+
+namespace uwvv
+{
+
+  namespace
+  {
+    void putVarint(std::vector<unsigned char>& out, uint64_t x)
+    {
+      while(x >= 0x80)
+        {
+          out.push_back((unsigned char)(x | 0x80));
+          x >>= 7;
+        }
+      out.push_back((unsigned char)x);
+    }
+
+    uint64_t getVarint(const unsigned char*& pos, const unsigned char* end)
+    {
+      uint64_t x = 0;
+      for(unsigned shift = 0; shift < 64; shift += 7)
+        {
+          if(pos == end)
+            throw cms::Exception("CorruptEventIndex")
+              << "Event index ends in the middle of a number" << std::endl;
+
+          const unsigned char byte = *pos++;
+          x |= uint64_t(byte & 0x7f) << shift;
+          if(!(byte & 0x80))
+            return x;
+        }
+
+      throw cms::Exception("CorruptEventIndex")
+        << "Event index has a number that's too long" << std::endl;
+    }
+
+    // Entry numbers are stored relative to the end of the previous range,
+    // which may be before or after
+    uint64_t zigzag(int64_t x) {return (uint64_t(x) << 1) ^ uint64_t(x >> 63);}
+    int64_t unzigzag(uint64_t x) {return int64_t(x >> 1) ^ -int64_t(x & 1);}
+  }
+
+
+  void EventIndex::add(const EventID& id, uint64_t entry)
+  {
+    if(!ranges.empty() && ranges.back().id == id &&
+       ranges.back().first + ranges.back().n == entry)
+      ++ranges.back().n;
+    else
+      {
+        ranges.push_back(Range{id, entry, 1});
+        if(ranges.size() > 1 && ranges.back() < ranges[ranges.size() - 2])
+          sorted = false;
+      }
+
+    nEntries = std::max(nEntries, entry + 1);
+  }
+
+
+  void EventIndex::sort()
+  {
+    if(!sorted)
+      std::sort(ranges.begin(), ranges.end());
+    sorted = true;
+  }
+
+
+  void EventIndex::checkSorted(const char* what) const
+  {
+    if(!sorted)
+      throw cms::Exception("UnsortedEventIndex")
+        << "EventIndex::" << what << " needs a sorted index; call sort() "
+        << "after adding events" << std::endl;
+  }
+
+
+  void EventIndex::append(const EventIndex& other)
+  {
+    checkSorted("append");
+    other.checkSorted("append");
+
+    const size_t nOld = ranges.size();
+    ranges.reserve(nOld + other.ranges.size());
+    for(const Range& r : other.ranges)
+      ranges.push_back(Range{r.id, r.first + nEntries, r.n});
+
+    std::inplace_merge(ranges.begin(), ranges.begin() + nOld, ranges.end());
+
+    nEntries += other.nEntries;
+  }
+
+
+  std::pair<EventIndex::const_iterator, EventIndex::const_iterator>
+  EventIndex::find(const EventID& id) const
+  {
+    checkSorted("find");
+
+    auto lower = std::lower_bound(ranges.begin(), ranges.end(), id,
+                                  [](const Range& r, const EventID& i)
+                                  {return r.id < i;});
+    auto upper = lower;
+    while(upper != ranges.end() && upper->id == id)
+      ++upper;
+
+    return std::make_pair(lower, upper);
+  }
+
+
+  bool EventIndex::contains(const EventID& id) const
+  {
+    auto found = find(id);
+    return found.first != found.second;
+  }
+
+
+  std::vector<uint64_t> EventIndex::entries(const EventID& id) const
+  {
+    std::vector<uint64_t> out;
+
+    auto found = find(id);
+    for(auto r = found.first; r != found.second; ++r)
+      {
+        for(uint64_t i = r->first; i < r->first + r->n; ++i)
+          out.push_back(i);
+      }
+
+    return out;
+  }
+
+
+  // For each range: run (delta), lumi (delta if same run), evt (delta if
+  // same lumi), first entry (relative to the end of the previous range),
+  // number of entries
+  void EventIndex::encode(std::vector<unsigned char>& out) const
+  {
+    checkSorted("encode");
+
+    out.clear();
+    out.reserve(8 * ranges.size() + 8);
+
+    putVarint(out, ranges.size());
+
+    EventID prev = {0, 0, 0};
+    uint64_t prevEnd = 0;
+    for(const Range& r : ranges)
+      {
+        const bool newRun = r.id.run != prev.run;
+        const bool newLumi = newRun || r.id.lumi != prev.lumi;
+
+        putVarint(out, r.id.run - prev.run);
+        putVarint(out, newRun ? r.id.lumi : r.id.lumi - prev.lumi);
+        putVarint(out, newLumi ? r.id.evt : r.id.evt - prev.evt);
+        putVarint(out, zigzag(int64_t(r.first) - int64_t(prevEnd)));
+        putVarint(out, r.n);
+
+        prev = r.id;
+        prevEnd = r.first + r.n;
+      }
+  }
+
+
+  EventIndex EventIndex::decode(const unsigned char* data, size_t size,
+                                uint64_t treeEntries)
+  {
+    const unsigned char* pos = data;
+    const unsigned char* end = data + size;
+
+    EventIndex out;
+    out.nEntries = treeEntries;
+
+    const uint64_t nRanges = getVarint(pos, end);
+    if(nRanges > size)
+      throw cms::Exception("CorruptEventIndex")
+        << "Event index claims " << nRanges << " events in " << size
+        << " bytes" << std::endl;
+    out.ranges.reserve(nRanges);
+
+    EventID prev = {0, 0, 0};
+    uint64_t prevEnd = 0;
+    for(uint64_t i = 0; i < nRanges; ++i)
+      {
+        Range r;
+
+        const uint64_t runDelta = getVarint(pos, end);
+        r.id.run = prev.run + runDelta;
+        r.id.lumi = getVarint(pos, end) + (runDelta ? 0 : prev.lumi);
+        const bool newLumi = runDelta || r.id.lumi != prev.lumi;
+        r.id.evt = getVarint(pos, end) + (newLumi ? 0 : prev.evt);
+        r.first = prevEnd + unzigzag(getVarint(pos, end));
+        r.n = getVarint(pos, end);
+
+        if(r.first + r.n > treeEntries)
+          throw cms::Exception("CorruptEventIndex")
+            << "Event index points past the end of its tree (entry "
+            << r.first + r.n - 1 << " of " << treeEntries << ")" << std::endl;
+
+        out.ranges.push_back(r);
+        prev = r.id;
+        prevEnd = r.first + r.n;
+      }
+
+    if(pos != end)
+      throw cms::Exception("CorruptEventIndex")
+        << "Event index has " << end - pos << " extra bytes" << std::endl;
+
+    return out;
+  }
+
+
+  void EventIndex::fill(TTree& tree) const
+  {
+    std::vector<unsigned char> bytes;
+    encode(bytes);
+
+    ULong64_t treeEntries = nEntries;
+    UInt_t nBytes = bytes.size();
+
+    if(!tree.GetBranch("bytes"))
+      {
+        tree.Branch("treeEntries", &treeEntries, "treeEntries/l");
+        tree.Branch("nBytes", &nBytes, "nBytes/i");
+        tree.Branch("bytes", bytes.data(), "bytes[nBytes]/b");
+      }
+    else
+      {
+        tree.SetBranchAddress("treeEntries", &treeEntries);
+        tree.SetBranchAddress("nBytes", &nBytes);
+        tree.SetBranchAddress("bytes", bytes.data());
+      }
+
+    tree.Fill();
+    tree.ResetBranchAddresses();
+  }
+
+
+  EventIndex EventIndex::build(TTree& tree)
+  {
+    TBranch* runBranch = tree.GetBranch("run");
+    TBranch* lumiBranch = tree.GetBranch("lumi");
+    TBranch* evtBranch = tree.GetBranch("evt");
+    if(!(runBranch && lumiBranch && evtBranch))
+      throw cms::Exception("MissingBranch")
+        << "Tree " << tree.GetName() << " needs run, lumi, and evt branches "
+        << "to be indexed" << std::endl;
+
+    EventID id = {0, 0, 0};
+    runBranch->SetAddress(&id.run);
+    lumiBranch->SetAddress(&id.lumi);
+    evtBranch->SetAddress(&id.evt);
+
+    // Only these three branches are read
+    EventIndex out;
+    for(Long64_t i = 0; i < tree.GetEntries(); ++i)
+      {
+        runBranch->GetEntry(i);
+        lumiBranch->GetEntry(i);
+        evtBranch->GetEntry(i);
+        out.add(id, i);
+      }
+    out.sort();
+
+    runBranch->ResetAddress();
+    lumiBranch->ResetAddress();
+    evtBranch->ResetAddress();
+
+    return out;
+  }
+
+
+  EventIndex EventIndex::read(TTree& tree)
+  {
+    TBranch* entriesBranch = tree.GetBranch("treeEntries");
+    TBranch* sizeBranch = tree.GetBranch("nBytes");
+    TBranch* bytesBranch = tree.GetBranch("bytes");
+    if(!(entriesBranch && sizeBranch && bytesBranch))
+      throw cms::Exception("CorruptEventIndex")
+        << "Tree " << tree.GetName() << " is not an event index" << std::endl;
+
+    ULong64_t treeEntries = 0;
+    UInt_t nBytes = 0;
+    std::vector<unsigned char> bytes(1);
+
+    entriesBranch->SetAddress(&treeEntries);
+    sizeBranch->SetAddress(&nBytes);
+
+    EventIndex out;
+    for(Long64_t i = 0; i < tree.GetEntries(); ++i)
+      {
+        entriesBranch->GetEntry(i);
+        sizeBranch->GetEntry(i);
+
+        if(nBytes > bytes.size())
+          bytes.resize(nBytes);
+        bytesBranch->SetAddress(bytes.data());
+        bytesBranch->GetEntry(i);
+
+        out.append(decode(bytes.data(), nBytes, treeEntries));
+      }
+
+    tree.ResetBranchAddresses();
+
+    return out;
+  }
+
+
+  bool EventIndex::read(TDirectory& dir, EventIndex& out,
+                        const std::string& name)
+  {
+    TTree* tree = 0;
+    dir.GetObject(name.c_str(), tree);
+    if(!tree)
+      return false;
+
+    out = read(*tree);
+    return true;
+  }
+
+} // namespace uwvv
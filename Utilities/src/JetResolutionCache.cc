@@ -0,0 +1,249 @@
+#include "UWVV/Utilities/interface/JetResolutionCache.h"
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace uwvv
+{
+
+  namespace jer
+  {
+    bool FlatBinning::build(const JME::JetResolutionObject& obj)
+    {
+      bins = obj.getDefinition().getBins();
+      lo.clear();
+      hi.clear();
+      usable = false;
+
+      if(bins.size() > 4)
+        return false;
+
+      for(const auto& b : bins)
+        {
+          if(b != JME::Binning::JetPt && b != JME::Binning::JetEta &&
+             b != JME::Binning::JetAbsEta && b != JME::Binning::Rho)
+            return false;
+        }
+
+      lo.reserve(obj.getRecords().size() * bins.size());
+      hi.reserve(obj.getRecords().size() * bins.size());
+      for(const auto& record : obj.getRecords())
+        {
+          for(const auto& range : record.getBinsRange())
+            {
+              lo.push_back(range.min);
+              hi.push_back(range.max);
+            }
+        }
+
+      usable = (lo.size() == obj.getRecords().size() * bins.size());
+      return usable;
+    }
+
+
+    bool FlatBinning::uses(JME::Binning b) const
+    {
+      return std::find(bins.begin(), bins.end(), b) != bins.end();
+    }
+
+
+    int FlatBinning::find(float pt, float eta, float rho) const
+    {
+      const size_t nBins = bins.size();
+
+      float values[4];
+      for(size_t b = 0; b < nBins; ++b)
+        {
+          switch(bins[b])
+            {
+            case JME::Binning::JetPt:
+              values[b] = pt;
+              break;
+            case JME::Binning::JetEta:
+              values[b] = eta;
+              break;
+            case JME::Binning::JetAbsEta:
+              values[b] = std::abs(eta);
+              break;
+            default:
+              values[b] = rho;
+            }
+        }
+
+      const size_t nRecords = (nBins ? lo.size() / nBins : 0);
+      for(size_t r = 0; r < nRecords; ++r)
+        {
+          const float* rLo = &lo[r * nBins];
+          const float* rHi = &hi[r * nBins];
+
+          size_t b = 0;
+          for(; b < nBins; ++b)
+            {
+              if(values[b] < rLo[b] || values[b] > rHi[b])
+                break;
+            }
+          if(b == nBins)
+            return int(r);
+        }
+
+      return -1;
+    }
+
+
+    JetResolutionCache::JetResolutionCache(const std::string& resolutionLabel,
+                                           const std::string& scaleFactorLabel) :
+      resLabel(resolutionLabel),
+      sfLabel(scaleFactorLabel),
+      sfTabulated(false)
+    {
+    }
+
+
+    bool JetResolutionCache::update(const edm::EventSetup& setup)
+    {
+      bool changed = false;
+
+      if(resWatcher.check(setup))
+        {
+          res.reset(new JME::JetResolution(JME::JetResolution::get(setup, resLabel)));
+          rebuildResolution();
+          changed = true;
+        }
+
+      if(sfWatcher.check(setup))
+        {
+          sf.reset(new JME::JetResolutionScaleFactor(JME::JetResolutionScaleFactor::get(setup, sfLabel)));
+          rebuildScaleFactor();
+          changed = true;
+        }
+
+      return changed;
+    }
+
+
+    void JetResolutionCache::set(const JME::JetResolution& resolution,
+                                 const JME::JetResolutionScaleFactor& scaleFactor)
+    {
+      res.reset(new JME::JetResolution(resolution));
+      rebuildResolution();
+      sf.reset(new JME::JetResolutionScaleFactor(scaleFactor));
+      rebuildScaleFactor();
+    }
+
+
+    void JetResolutionCache::rebuildResolution()
+    {
+      resBins.build(*res->getResolutionObject());
+    }
+
+
+    void JetResolutionCache::rebuildScaleFactor()
+    {
+      const JME::JetResolutionObject& obj = *sf->getResolutionObject();
+
+      sfNominal.clear();
+      sfDown.clear();
+      sfUp.clear();
+
+      // Scale factors are just three numbers per bin unless there is a
+      // formula, which hasn't been the case so far. They're looked up
+      // without the jet pt, so a payload binned in pt goes through JME and
+      // fails there the same way it always has.
+      sfTabulated = (sfBins.build(obj) && !sfBins.uses(JME::Binning::JetPt) &&
+                     obj.getDefinition().nVariables() == 0);
+
+      for(const auto& record : obj.getRecords())
+        {
+          if(!sfTabulated)
+            break;
+
+          const std::vector<float>& values = record.getParametersValues();
+          if(values.size() < 3)
+            {
+              sfTabulated = false;
+              break;
+            }
+
+          sfNominal.push_back(values[static_cast<size_t>(Variation::NOMINAL)]);
+          sfDown.push_back(values[static_cast<size_t>(Variation::DOWN)]);
+          sfUp.push_back(values[static_cast<size_t>(Variation::UP)]);
+        }
+    }
+
+
+    void JetResolutionCache::resolutions(size_t n, const float* pt,
+                                         const float* eta, float rho,
+                                         float* out) const
+    {
+      const JME::JetResolutionObject& obj = *res->getResolutionObject();
+
+      JME::JetParameters params;
+      params.setRho(rho);
+
+      if(!resBins.isUsable())
+        {
+          for(size_t i = 0; i < n; ++i)
+            {
+              params.setJetPt(pt[i]).setJetEta(eta[i]);
+              out[i] = res->getResolution(params);
+            }
+          return;
+        }
+
+      const std::vector<JME::JetResolutionObject::Record>& records = obj.getRecords();
+      for(size_t i = 0; i < n; ++i)
+        {
+          int r = resBins.find(pt[i], eta[i], rho);
+
+          // Same default as JME::JetResolution::getResolution()
+          if(r < 0)
+            {
+              out[i] = 1.;
+              continue;
+            }
+
+          params.setJetPt(pt[i]).setJetEta(eta[i]);
+          out[i] = obj.evaluateFormula(records[r], params);
+        }
+    }
+
+
+    void JetResolutionCache::scaleFactors(size_t n, const float* eta,
+                                          float rho, float* nominal,
+                                          float* down, float* up) const
+    {
+      if(!sfTabulated)
+        {
+          JME::JetParameters params;
+          params.setRho(rho);
+          for(size_t i = 0; i < n; ++i)
+            {
+              params.setJetEta(eta[i]);
+              nominal[i] = sf->getScaleFactor(params, Variation::NOMINAL);
+              down[i] = sf->getScaleFactor(params, Variation::DOWN);
+              up[i] = sf->getScaleFactor(params, Variation::UP);
+            }
+          return;
+        }
+
+      for(size_t i = 0; i < n; ++i)
+        {
+          int r = sfBins.find(0., eta[i], rho);
+
+          // Same default as JME::JetResolutionScaleFactor::getScaleFactor()
+          if(r < 0)
+            {
+              nominal[i] = down[i] = up[i] = 1.;
+              continue;
+            }
+
+          nominal[i] = sfNominal[r];
+          down[i] = sfDown[r];
+          up[i] = sfUp[r];
+        }
+    }
+
+  } // namespace jer
+
+} // namespace uwvv
@@ -0,0 +1,198 @@
+#include "UWVV/Utilities/interface/NtupleFiles.h"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <glob.h>
+
+#include "TChain.h"
+#include "TClass.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TTree.h"
+
+
+namespace uwvv
+{
+
+  namespace ntupleFiles
+  {
+    std::vector<std::string> expand(const std::string& patterns)
+    {
+      std::vector<std::string> out;
+
+      std::stringstream ss(patterns);
+      std::string pattern;
+      while(std::getline(ss, pattern, ','))
+        {
+          if(pattern.empty())
+            continue;
+
+          glob_t found;
+          if(glob(pattern.c_str(), 0, 0, &found) == 0)
+            {
+              for(size_t i = 0; i < found.gl_pathc; ++i)
+                out.push_back(found.gl_pathv[i]);
+            }
+          globfree(&found);
+        }
+
+      return out;
+    }
+
+
+    std::vector<std::string> directoriesWith(TFile& f,
+                                             const std::string& treeName)
+    {
+      std::vector<std::string> out;
+
+      TIter next(f.GetListOfKeys());
+      while(TKey* key = static_cast<TKey*>(next()))
+        {
+          TClass* cls = TClass::GetClass(key->GetClassName());
+          if(!(cls && cls->InheritsFrom(TDirectory::Class())))
+            continue;
+
+          TDirectory* d = f.GetDirectory(key->GetName());
+          TTree* t = 0;
+          if(d)
+            d->GetObject(treeName.c_str(), t);
+          if(t)
+            out.push_back(key->GetName());
+        }
+
+      return out;
+    }
+
+
+    std::vector<std::string> topDirectories(const std::vector<std::string>& files)
+    {
+      std::vector<std::string> out;
+      std::set<std::string> seen;
+
+      for(const auto& fileName : files)
+        {
+          TFile f(fileName.c_str());
+          if(f.IsZombie())
+            throw std::runtime_error("Can't open " + fileName);
+
+          TIter next(f.GetListOfKeys());
+          while(TKey* key = static_cast<TKey*>(next()))
+            {
+              TClass* cls = TClass::GetClass(key->GetClassName());
+              if(cls && cls->InheritsFrom(TDirectory::Class()) &&
+                 seen.insert(key->GetName()).second)
+                out.push_back(key->GetName());
+            }
+        }
+
+      return out;
+    }
+
+
+    void mergeDirectory(const std::vector<std::string>& inputs,
+                        const std::string& path, TDirectory& out)
+    {
+      // Everything in the directory in any input, in the order first seen
+      std::vector<std::string> names;
+      std::set<std::string> subdirectories;
+      std::map<std::string, std::vector<std::string> > treeFiles;
+      // Summed histograms, and other objects from the first input
+      std::map<std::string, std::unique_ptr<TObject> > objects;
+
+      for(const auto& fileName : inputs)
+        {
+          TFile f(fileName.c_str());
+          if(f.IsZombie())
+            throw std::runtime_error("Can't open " + fileName);
+
+          TDirectory* d = f.GetDirectory(path.c_str());
+          if(!d)
+            continue;
+
+          // Only the highest cycle of each name, which is listed first
+          std::set<std::string> seenHere;
+          TIter next(d->GetListOfKeys());
+          while(TKey* key = static_cast<TKey*>(next()))
+            {
+              const std::string name = key->GetName();
+              if(!seenHere.insert(name).second)
+                continue;
+
+              if(!(subdirectories.count(name) || treeFiles.count(name) ||
+                   objects.count(name)))
+                names.push_back(name);
+
+              TClass* cls = TClass::GetClass(key->GetClassName());
+              if(cls && cls->InheritsFrom(TDirectory::Class()))
+                subdirectories.insert(name);
+              else if(cls && cls->InheritsFrom(TTree::Class()))
+                treeFiles[name].push_back(fileName);
+              else if(cls && cls->InheritsFrom(TH1::Class()))
+                {
+                  std::unique_ptr<TH1> h(static_cast<TH1*>(key->ReadObj()));
+                  h->SetDirectory(0);
+
+                  auto found = objects.find(name);
+                  if(found == objects.end())
+                    {
+                      objects[name] = std::move(h);
+                      continue;
+                    }
+
+                  TList toAdd;
+                  toAdd.Add(h.get());
+                  if(static_cast<TH1*>(found->second.get())->Merge(&toAdd) < 0)
+                    throw std::runtime_error("Can't add " + fileName + ":" +
+                                             path + "/" + name);
+                }
+              else if(!objects.count(name))
+                {
+                  objects[name].reset(key->ReadObj());
+                  if(!objects[name])
+                    std::cerr << "Warning: can't read " << fileName << ":"
+                              << path << "/" << name << " ("
+                              << key->GetClassName() << "), not copied"
+                              << std::endl;
+                }
+            }
+        }
+
+      for(const auto& name : names)
+        {
+          if(subdirectories.count(name))
+            {
+              TDirectory* sub = out.mkdir(name.c_str());
+              mergeDirectory(inputs, path + "/" + name, *sub);
+              continue;
+            }
+
+          out.cd();
+
+          auto files = treeFiles.find(name);
+          if(files != treeFiles.end())
+            {
+              TChain chain((path + "/" + name).c_str());
+              for(const auto& f : files->second)
+                chain.Add(f.c_str());
+
+              TTree* merged = chain.CloneTree(-1, "fast");
+              if(!merged)
+                throw std::runtime_error("Can't merge " + path + "/" + name);
+              merged->SetDirectory(&out);
+              merged->Write();
+            }
+          else if(objects[name])
+            objects[name]->Write(name.c_str());
+        }
+    }
+  } // namespace ntupleFiles
+
+} // namespace uwvv
@@ -0,0 +1,823 @@
+#include "UWVV/Utilities/interface/NtupleReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+#include "TBranch.h"
+#include "TClass.h"
+#include "TDataType.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+
+namespace
+{
+  std::string trim(const std::string& s)
+  {
+    size_t start = s.find_first_not_of(" \t");
+    if(start == std::string::npos)
+      return "";
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(start, end + 1 - start);
+  }
+
+
+  uwvv::ntuple::Type branchType(TBranch& branch)
+  {
+    using uwvv::ntuple::Type;
+
+    TClass* cls = 0;
+    EDataType dataType = kOther_t;
+    if(branch.GetExpectedType(cls, dataType))
+      return Type::Unknown;
+
+    if(cls)
+      {
+        const std::string name = cls->GetName();
+        if(name == "vector<float>")
+          return Type::VFloat;
+        if(name == "vector<double>")
+          return Type::VDouble;
+        if(name == "vector<int>")
+          return Type::VInt;
+        if(name == "vector<unsigned int>")
+          return Type::VUInt;
+        return Type::Unknown;
+      }
+
+    switch(dataType)
+      {
+      case kFloat_t:
+        return Type::Float;
+      case kDouble_t:
+        return Type::Double;
+      case kInt_t:
+        return Type::Int;
+      case kUInt_t:
+        return Type::UInt;
+      case kBool_t:
+        return Type::Bool;
+      case kULong64_t:
+        return Type::ULong64;
+      case kLong64_t:
+        return Type::Long64;
+      default:
+        return Type::Unknown;
+      }
+  }
+
+
+  // Scalars go straight into a buffer
+  template<class T>
+  void readBranch(TTree& tree, const std::string& name, Long64_t first,
+                  size_t n, std::vector<T>& values)
+  {
+    TBranch* branch = tree.GetBranch(name.c_str());
+
+    T buffer;
+    branch->SetAddress(&buffer);
+
+    values.resize(n);
+    for(size_t i = 0; i < n; ++i)
+      {
+        branch->GetEntry(first + i);
+        values[i] = buffer;
+      }
+
+    branch->ResetAddress();
+  }
+
+  // Vectors need an object for ROOT to stream into
+  template<class T>
+  void readBranch(TTree& tree, const std::string& name, Long64_t first,
+                  size_t n, std::vector<std::vector<T> >& values)
+  {
+    TBranch* branch = tree.GetBranch(name.c_str());
+
+    std::vector<T>* buffer = 0;
+    tree.SetBranchAddress(name.c_str(), &buffer);
+
+    values.resize(n);
+    for(size_t i = 0; i < n; ++i)
+      {
+        branch->GetEntry(first + i);
+        values[i] = *buffer;
+      }
+
+    tree.ResetBranchAddress(branch);
+    delete buffer;
+  }
+
+
+  template<class T>
+  void toDouble(const std::vector<T>& values, std::vector<double>& out)
+  {
+    out.assign(values.begin(), values.end());
+  }
+
+  template<class T>
+  void toDouble(const std::vector<std::vector<T> >&, std::vector<double>&)
+  {
+    throw cms::Exception("BranchTypeMismatch")
+      << "Vector columns can't be used as numbers" << std::endl;
+  }
+
+
+  // Histograms belong to their kernel, not the current directory
+  template<class H, class... Args>
+  std::unique_ptr<H> makeHist(Args... args)
+  {
+    const bool addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(false);
+    std::unique_ptr<H> h(new H(args...));
+    TH1::AddDirectory(addDirectory);
+
+    return h;
+  }
+}
+
+
+namespace uwvv
+{
+
+  namespace ntuple
+  {
+    Layout::Layout(const std::string& channel) :
+      channel_(channel)
+    {
+      // Same as mapObjects in UWVV.Utilities.helpers
+      std::map<char, unsigned> nObjects;
+      for(char c : channel)
+        ++nObjects[c];
+
+      for(const auto& obj : nObjects)
+        {
+          if(obj.second == 1)
+            objects_.push_back(std::string(1, obj.first));
+          else
+            {
+              for(unsigned i = 1; i <= obj.second; ++i)
+                objects_.push_back(obj.first + std::to_string(i));
+            }
+        }
+      std::sort(objects_.begin(), objects_.end());
+
+      // Zs are the first daughters (see makeBranchSet); a lone Z is the
+      // top-level object, so its branches have no prefix
+      if(channel.size() == 2)
+        zPrefixes.push_back("");
+      else if(channel.size() == 3)
+        {
+          if(channel[0] == channel[1])
+            zPrefixes.push_back(objects_[0] + '_' + objects_[1] + '_');
+          else
+            zPrefixes.push_back(objects_[1] + '_' + objects_[2] + '_');
+        }
+      else if(channel.size() == 4)
+        {
+          zPrefixes.push_back(objects_[0] + '_' + objects_[1] + '_');
+          zPrefixes.push_back(objects_[2] + '_' + objects_[3] + '_');
+        }
+    }
+
+
+    std::string Layout::pair(const std::string& obj1, const std::string& obj2,
+                             const std::string& var) const
+    {
+      auto pos1 = std::find(objects_.begin(), objects_.end(), obj1);
+      auto pos2 = std::find(objects_.begin(), objects_.end(), obj2);
+      if(pos1 == objects_.end() || pos2 == objects_.end())
+        throw cms::Exception("InvalidObject")
+          << "Channel " << channel_ << " has no pair " << obj1 << ", "
+          << obj2 << std::endl;
+
+      if(pos2 < pos1)
+        std::swap(pos1, pos2);
+
+      return *pos1 + '_' + *pos2 + '_' + var;
+    }
+
+
+    std::string Layout::z(unsigned i, const std::string& var) const
+    {
+      if(i < 1 || i > zPrefixes.size())
+        throw cms::Exception("InvalidObject")
+          << "Channel " << channel_ << " has no Z" << i << std::endl;
+
+      return zPrefixes[i - 1] + var;
+    }
+
+
+    std::string Layout::resolve(const std::string& column) const
+    {
+      if(column.size() > 2 && column[0] == 'Z' &&
+         (column[1] == '1' || column[1] == '2'))
+        {
+          unsigned i = column[1] - '0';
+          if(i <= zPrefixes.size())
+            return z(i, column.substr(2));
+        }
+
+      return column;
+    }
+
+
+    const char* typeName(Type t)
+    {
+      switch(t)
+        {
+        case Type::Float:
+          return "float";
+        case Type::Double:
+          return "double";
+        case Type::Int:
+          return "int";
+        case Type::UInt:
+          return "unsigned int";
+        case Type::Bool:
+          return "bool";
+        case Type::ULong64:
+          return "unsigned long long";
+        case Type::Long64:
+          return "long long";
+        case Type::VFloat:
+          return "vector<float>";
+        case Type::VDouble:
+          return "vector<double>";
+        case Type::VInt:
+          return "vector<int>";
+        case Type::VUInt:
+          return "vector<unsigned int>";
+        default:
+          return "unknown";
+        }
+    }
+
+
+    namespace detail
+    {
+      template<class T>
+      void TypedColumnData<T>::read(TTree& tree, const std::string& branch,
+                                    Long64_t first, size_t n)
+      {
+        readBranch(tree, branch, first, n, values);
+      }
+
+      template<class T>
+      void TypedColumnData<T>::asDouble(std::vector<double>& out) const
+      {
+        toDouble(values, out);
+      }
+
+      template struct TypedColumnData<float>;
+      template struct TypedColumnData<double>;
+      template struct TypedColumnData<int>;
+      template struct TypedColumnData<unsigned>;
+      template struct TypedColumnData<bool>;
+      template struct TypedColumnData<ULong64_t>;
+      template struct TypedColumnData<Long64_t>;
+      template struct TypedColumnData<std::vector<float> >;
+      template struct TypedColumnData<std::vector<double> >;
+      template struct TypedColumnData<std::vector<int> >;
+      template struct TypedColumnData<std::vector<unsigned> >;
+
+
+      std::unique_ptr<ColumnData> makeColumnData(Type type)
+      {
+        switch(type)
+          {
+          case Type::Float:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<float>());
+          case Type::Double:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<double>());
+          case Type::Int:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<int>());
+          case Type::UInt:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<unsigned>());
+          case Type::Bool:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<bool>());
+          case Type::ULong64:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<ULong64_t>());
+          case Type::Long64:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<Long64_t>());
+          case Type::VFloat:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<std::vector<float> >());
+          case Type::VDouble:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<std::vector<double> >());
+          case Type::VInt:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<std::vector<int> >());
+          case Type::VUInt:
+            return std::unique_ptr<ColumnData>(new TypedColumnData<std::vector<unsigned> >());
+          default:
+            throw cms::Exception("BranchTypeMismatch")
+              << "Can't read branches of unknown type" << std::endl;
+          }
+      }
+    } // namespace detail
+
+
+    const detail::ColumnData& Block::find(const std::string& column) const
+    {
+      auto found = columns.find(layout.resolve(column));
+      if(found == columns.end())
+        throw cms::Exception("MissingColumn")
+          << "Column " << column << " wasn't read; add it to the kernel's "
+          << "columns()" << std::endl;
+
+      return *found->second;
+    }
+
+
+    Selection::Selection(const std::string& cut)
+    {
+      // Two-character operators first, so <= isn't taken for <
+      static const std::vector<std::pair<std::string, Op> > ops = {
+        {"<=", Op::LE}, {">=", Op::GE}, {"==", Op::EQ}, {"!=", Op::NE},
+        {"<", Op::LT}, {">", Op::GT},
+      };
+
+      if(cut.find("||") != std::string::npos)
+        throw cms::Exception("InvalidSelection")
+          << "Only && is supported, not ||: " << cut << std::endl;
+
+      size_t start = 0;
+      while(start <= cut.size())
+        {
+          size_t end = cut.find("&&", start);
+          if(end == std::string::npos)
+            end = cut.size();
+
+          const std::string term = trim(cut.substr(start, end - start));
+          start = end + 2;
+
+          if(term.empty())
+            continue;
+
+          Cut c;
+          size_t opPos = std::string::npos;
+          size_t opSize = 0;
+          for(const auto& op : ops)
+            {
+              opPos = term.find(op.first);
+              if(opPos != std::string::npos)
+                {
+                  c.op = op.second;
+                  opSize = op.first.size();
+                  break;
+                }
+            }
+          if(opPos == std::string::npos)
+            throw cms::Exception("InvalidSelection")
+              << "No comparison in '" << term << "'" << std::endl;
+
+          std::string lhs = trim(term.substr(0, opPos));
+          const std::string rhs = trim(term.substr(opPos + opSize));
+
+          c.abs = (lhs.size() > 4 && lhs.compare(0, 4, "abs(") == 0 &&
+                   lhs.back() == ')');
+          if(c.abs)
+            lhs = trim(lhs.substr(4, lhs.size() - 5));
+          c.column = lhs;
+
+          char* numberEnd = 0;
+          c.value = std::strtod(rhs.c_str(), &numberEnd);
+          if(lhs.empty() || rhs.empty() || *numberEnd)
+            throw cms::Exception("InvalidSelection")
+              << "Can't understand '" << term << "' (should be column, "
+              << "comparison, number)" << std::endl;
+
+          cuts.push_back(c);
+        }
+    }
+
+
+    void Selection::columns(std::vector<std::string>& out) const
+    {
+      for(const auto& c : cuts)
+        out.push_back(c.column);
+    }
+
+
+    void Selection::evaluate(const Block& block,
+                             std::vector<char>& pass) const
+    {
+      pass.assign(block.size(), 1);
+
+      for(const auto& c : cuts)
+        {
+          block.getAsDouble(c.column, buffer);
+          if(c.abs)
+            {
+              for(auto& x : buffer)
+                x = std::abs(x);
+            }
+
+          for(size_t i = 0; i < buffer.size(); ++i)
+            {
+              const double x = buffer[i];
+              bool ok = false;
+              switch(c.op)
+                {
+                case Op::LT:
+                  ok = x < c.value;
+                  break;
+                case Op::LE:
+                  ok = x <= c.value;
+                  break;
+                case Op::GT:
+                  ok = x > c.value;
+                  break;
+                case Op::GE:
+                  ok = x >= c.value;
+                  break;
+                case Op::EQ:
+                  ok = x == c.value;
+                  break;
+                case Op::NE:
+                  ok = x != c.value;
+                  break;
+                }
+              pass[i] &= ok;
+            }
+        }
+    }
+
+
+    Counter::Counter(const Selection& selection, const std::string& weight) :
+      selection(selection),
+      weight(weight),
+      count_(0),
+      sumW(0.)
+    {
+    }
+
+
+    void Counter::columns(std::vector<std::string>& out) const
+    {
+      selection.columns(out);
+      if(!weight.empty())
+        out.push_back(weight);
+    }
+
+
+    std::unique_ptr<Kernel> Counter::clone() const
+    {
+      return std::unique_ptr<Kernel>(new Counter(selection, weight));
+    }
+
+
+    void Counter::process(const Block& block)
+    {
+      selection.evaluate(block, pass);
+      if(weight.empty())
+        weights.assign(block.size(), 1.);
+      else
+        block.getAsDouble(weight, weights);
+
+      for(size_t i = 0; i < block.size(); ++i)
+        {
+          if(pass[i])
+            {
+              ++count_;
+              sumW += weights[i];
+            }
+        }
+    }
+
+
+    void Counter::merge(const Kernel& other)
+    {
+      const Counter& o = static_cast<const Counter&>(other);
+      count_ += o.count_;
+      sumW += o.sumW;
+    }
+
+
+    Hist1D::Hist1D(const std::string& name, const std::string& column,
+                   unsigned nBins, double low, double high,
+                   const Selection& selection, const std::string& weight) :
+      column(column),
+      selection(selection),
+      weight(weight),
+      hist_(makeHist<TH1D>(name.c_str(), "", nBins, low, high))
+    {
+      if(!weight.empty())
+        hist_->Sumw2();
+    }
+
+
+    void Hist1D::columns(std::vector<std::string>& out) const
+    {
+      out.push_back(column);
+      selection.columns(out);
+      if(!weight.empty())
+        out.push_back(weight);
+    }
+
+
+    std::unique_ptr<Kernel> Hist1D::clone() const
+    {
+      const TAxis* x = hist_->GetXaxis();
+      return std::unique_ptr<Kernel>(new Hist1D(hist_->GetName(), column,
+                                                x->GetNbins(), x->GetXmin(),
+                                                x->GetXmax(), selection,
+                                                weight));
+    }
+
+
+    void Hist1D::process(const Block& block)
+    {
+      selection.evaluate(block, pass);
+      block.getAsDouble(column, values);
+      if(weight.empty())
+        weights.assign(block.size(), 1.);
+      else
+        block.getAsDouble(weight, weights);
+
+      for(size_t i = 0; i < block.size(); ++i)
+        {
+          if(pass[i])
+            hist_->Fill(values[i], weights[i]);
+        }
+    }
+
+
+    void Hist1D::merge(const Kernel& other)
+    {
+      hist_->Add(&static_cast<const Hist1D&>(other).hist());
+    }
+
+
+    Hist2D::Hist2D(const std::string& name,
+                   const std::string& columnX, unsigned nBinsX, double lowX,
+                   double highX,
+                   const std::string& columnY, unsigned nBinsY, double lowY,
+                   double highY,
+                   const Selection& selection, const std::string& weight) :
+      columnX(columnX),
+      columnY(columnY),
+      selection(selection),
+      weight(weight),
+      hist_(makeHist<TH2D>(name.c_str(), "", nBinsX, lowX, highX,
+                           nBinsY, lowY, highY))
+    {
+      if(!weight.empty())
+        hist_->Sumw2();
+    }
+
+
+    void Hist2D::columns(std::vector<std::string>& out) const
+    {
+      out.push_back(columnX);
+      out.push_back(columnY);
+      selection.columns(out);
+      if(!weight.empty())
+        out.push_back(weight);
+    }
+
+
+    std::unique_ptr<Kernel> Hist2D::clone() const
+    {
+      const TAxis* x = hist_->GetXaxis();
+      const TAxis* y = hist_->GetYaxis();
+      return std::unique_ptr<Kernel>(new Hist2D(hist_->GetName(),
+                                                columnX, x->GetNbins(),
+                                                x->GetXmin(), x->GetXmax(),
+                                                columnY, y->GetNbins(),
+                                                y->GetXmin(), y->GetXmax(),
+                                                selection, weight));
+    }
+
+
+    void Hist2D::process(const Block& block)
+    {
+      selection.evaluate(block, pass);
+      block.getAsDouble(columnX, valuesX);
+      block.getAsDouble(columnY, valuesY);
+      if(weight.empty())
+        weights.assign(block.size(), 1.);
+      else
+        block.getAsDouble(weight, weights);
+
+      for(size_t i = 0; i < block.size(); ++i)
+        {
+          if(pass[i])
+            hist_->Fill(valuesX[i], valuesY[i], weights[i]);
+        }
+    }
+
+
+    void Hist2D::merge(const Kernel& other)
+    {
+      hist_->Add(&static_cast<const Hist2D&>(other).hist());
+    }
+
+
+    Processor::Processor(const std::vector<std::string>& files,
+                         const std::string& channel, unsigned nThreads) :
+      files(files),
+      treePath(channel + "/ntuple"),
+      layout_(channel),
+      nThreads(nThreads ? nThreads : std::thread::hardware_concurrency()),
+      blockSize(100000)
+    {
+      if(!this->nThreads)
+        this->nThreads = 1;
+    }
+
+
+    std::vector<Processor::Task>
+    Processor::makeTasks(const std::vector<std::string>& branches,
+                         std::vector<Type>& types) const
+    {
+      std::vector<Task> tasks;
+
+      for(size_t iFile = 0; iFile < files.size(); ++iFile)
+        {
+          std::unique_ptr<TFile> f(TFile::Open(files[iFile].c_str()));
+          if(!f || f->IsZombie())
+            throw cms::Exception("NtupleReadError")
+              << "Can't open " << files[iFile] << std::endl;
+
+          TTree* tree = 0;
+          f->GetObject(treePath.c_str(), tree);
+          if(!tree)
+            throw cms::Exception("NtupleReadError")
+              << files[iFile] << " has no " << treePath << std::endl;
+
+          if(types.empty())
+            {
+              for(const auto& name : branches)
+                {
+                  TBranch* branch = tree->GetBranch(name.c_str());
+                  if(!branch)
+                    throw cms::Exception("MissingBranch")
+                      << treePath << " has no branch " << name << std::endl;
+
+                  types.push_back(branchType(*branch));
+                  if(types.back() == Type::Unknown)
+                    throw cms::Exception("BranchTypeMismatch")
+                      << "Don't know how to read branch " << name
+                      << std::endl;
+                }
+            }
+
+          // Whole clusters, so no basket is in two blocks
+          const Long64_t nEntries = tree->GetEntries();
+          TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+          Long64_t blockStart = 0;
+          while(clusters.Next() < nEntries)
+            {
+              const Long64_t clusterEnd = std::min(clusters.GetNextEntry(),
+                                                   nEntries);
+              if(size_t(clusterEnd - blockStart) >= blockSize)
+                {
+                  tasks.push_back(Task{iFile, blockStart,
+                                       size_t(clusterEnd - blockStart)});
+                  blockStart = clusterEnd;
+                }
+            }
+          if(blockStart < nEntries)
+            tasks.push_back(Task{iFile, blockStart,
+                                 size_t(nEntries - blockStart)});
+        }
+
+      return tasks;
+    }
+
+
+    Processor::Stats Processor::run()
+    {
+      ROOT::EnableThreadSafety();
+
+      auto start = std::chrono::steady_clock::now();
+
+      std::vector<std::string> branches;
+      for(const Kernel* k : kernels)
+        k->columns(branches);
+      for(auto& b : branches)
+        b = layout_.resolve(b);
+      std::sort(branches.begin(), branches.end());
+      branches.erase(std::unique(branches.begin(), branches.end()),
+                     branches.end());
+
+      std::vector<Type> types;
+      const std::vector<Task> tasks = makeTasks(branches, types);
+
+      const size_t nWorkers = std::max(size_t(1),
+                                       std::min(size_t(nThreads),
+                                                tasks.size()));
+
+      // Made here, not on the workers, because making histograms isn't
+      // thread safe
+      std::vector<std::vector<std::unique_ptr<Kernel> > > clones(nWorkers);
+      for(auto& workerKernels : clones)
+        {
+          for(const Kernel* k : kernels)
+            workerKernels.push_back(k->clone());
+        }
+
+      std::vector<std::string> errors(nWorkers);
+      std::vector<long long> bytesRead(nWorkers, 0);
+      std::atomic<size_t> nextTask(0);
+
+      std::vector<std::thread> workers;
+      for(size_t iWorker = 0; iWorker < nWorkers; ++iWorker)
+        {
+          workers.emplace_back([&, iWorker]()
+            {
+              Block block(layout_);
+              for(size_t i = 0; i < branches.size(); ++i)
+                block.columns[branches[i]] = detail::makeColumnData(types[i]);
+
+              std::unique_ptr<TFile> file;
+              TTree* tree = 0;
+              size_t currentFile = files.size();
+
+              try
+                {
+                  for(size_t i = nextTask++; i < tasks.size(); i = nextTask++)
+                    {
+                      const Task& task = tasks[i];
+
+                      if(task.iFile != currentFile)
+                        {
+                          if(file)
+                            bytesRead[iWorker] += file->GetBytesRead();
+
+                          currentFile = task.iFile;
+                          file.reset(TFile::Open(files[currentFile].c_str()));
+                          if(!file || file->IsZombie())
+                            throw cms::Exception("NtupleReadError")
+                              << "Can't open " << files[currentFile]
+                              << std::endl;
+
+                          file->GetObject(treePath.c_str(), tree);
+                          tree->SetCacheSize(32 << 20);
+                          for(const auto& b : branches)
+                            tree->AddBranchToCache(b.c_str(), true);
+                        }
+
+                      tree->SetCacheEntryRange(task.first,
+                                               task.first + task.n);
+                      for(auto& column : block.columns)
+                        column.second->read(*tree, column.first, task.first,
+                                            task.n);
+
+                      block.file_ = &files[currentFile];
+                      block.first_ = task.first;
+                      block.size_ = task.n;
+
+                      for(auto& k : clones[iWorker])
+                        k->process(block);
+                    }
+                }
+              catch(const std::exception& e)
+                {
+                  errors[iWorker] = e.what();
+                  nextTask = tasks.size(); // stop the others too
+                }
+
+              if(file)
+                bytesRead[iWorker] += file->GetBytesRead();
+            });
+        }
+      for(auto& w : workers)
+        w.join();
+
+      for(const auto& e : errors)
+        {
+          if(!e.empty())
+            throw cms::Exception("NtupleReadError") << e;
+        }
+
+      for(const auto& workerKernels : clones)
+        {
+          for(size_t i = 0; i < kernels.size(); ++i)
+            kernels[i]->merge(*workerKernels[i]);
+        }
+
+      Stats stats;
+      stats.nFiles = files.size();
+      stats.nBlocks = tasks.size();
+      stats.nEntries = 0;
+      for(const auto& t : tasks)
+        stats.nEntries += t.n;
+      stats.bytesRead = 0;
+      for(long long b : bytesRead)
+        stats.bytesRead += b;
+      stats.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      return stats;
+    }
+
+  } // namespace ntuple
+
+} // namespace uwvv
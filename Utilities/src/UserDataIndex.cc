@@ -0,0 +1,54 @@
+#include "UWVV/Utilities/interface/UserDataIndex.h"
+
+#include <cstdlib>
+#include <regex>
+
+
+namespace uwvv
+{
+
+  namespace userData
+  {
+    bool parse(const std::string& s, Expression& out)
+    {
+      // userFloat("x")
+      static const std::regex plain("\\s*user(Float|Int)\\s*\\(\\s*[\"']([^\"']+)[\"']\\s*\\)\\s*");
+      // ? hasUserFloat("x") ? userFloat("x") : 123.
+      static const std::regex ternary("\\s*\\?\\s*hasUser(Float|Int)\\s*\\(\\s*[\"']([^\"']+)[\"']\\s*\\)"
+                                      "\\s*\\?\\s*user(Float|Int)\\s*\\(\\s*[\"']([^\"']+)[\"']\\s*\\)"
+                                      "\\s*:\\s*([-+]?[0-9]*\\.?[0-9]*(?:[eE][-+]?[0-9]+)?)\\s*");
+
+      std::smatch match;
+      if(std::regex_match(s, match, plain))
+        {
+          out.type = (match[1] == "Float" ? Type::Float : Type::Int);
+          out.name = match[2];
+          out.hasDefault = false;
+          out.defaultVal = 0.;
+          return true;
+        }
+
+      if(std::regex_match(s, match, ternary))
+        {
+          // must check for and read the same thing
+          if(match[1] != match[3] || match[2] != match[4])
+            return false;
+
+          const std::string number = match[5];
+          char* end = 0;
+          double val = std::strtod(number.c_str(), &end);
+          if(number.empty() || end != number.c_str() + number.size())
+            return false;
+
+          out.type = (match[1] == "Float" ? Type::Float : Type::Int);
+          out.name = match[2];
+          out.hasDefault = true;
+          out.defaultVal = val;
+          return true;
+        }
+
+      return false;
+    }
+  } // namespace userData
+
+} // namespace uwvv
@@ -46,16 +46,30 @@ namespace uwvv
     bool overlapWithAnyDaughter(const reco::Candidate& cand,
                                 const reco::Candidate& mother, float dR)
     {
-      if(!mother.numberOfDaughters()) // end recursion
-        return reco::deltaR(cand.p4(), mother.p4()) < dR;
+      deltaR::EtaPhiBuffer finalDaughters;
+      finalDaughterEtaPhi(mother, finalDaughters);
 
-      for(size_t i = 0; i < mother.numberOfDaughters(); ++i)
+      return overlapWithAnyDaughter(cand, finalDaughters, dR);
+    }
+
+    bool overlapWithAnyDaughter(const reco::Candidate& cand,
+                                const deltaR::EtaPhiBuffer& finalDaughters,
+                                float dR)
+    {
+      return deltaR::anyWithinDeltaR(cand.eta(), cand.phi(), finalDaughters, dR);
+    }
+
+    void finalDaughterEtaPhi(const reco::Candidate& mother,
+                             deltaR::EtaPhiBuffer& addTo)
+    {
+      if(!mother.numberOfDaughters()) // end recursion
         {
-          if(overlapWithAnyDaughter(cand, *mother.daughter(i), dR))
-            return true;
+          addTo.add(mother);
+          return;
         }
 
-      return false;
+      for(size_t i = 0; i < mother.numberOfDaughters(); ++i)
+        finalDaughterEtaPhi(*mother.daughter(i), addTo);
     }
     const edm::PtrVector<pat::Jet>* getCleanedJetCollection(const pat::CompositeCandidate& cand, 
         const std::string& variation, std::string collectionName/*="cleanedJets"*/)
@@ -71,6 +85,30 @@ namespace uwvv
             
         return cand.userData<edm::PtrVector<pat::Jet>>(collectionName.c_str());
       }
+
+
+    std::string jetVariationLabel(const std::string& variation)
+    {
+      return "p4Scale_" + variation;
+    }
+
+    float jetVariationScale(const pat::Jet& jet, const std::string& variation)
+    {
+      if(variation.empty())
+        return 1.;
+
+      const std::string label = jetVariationLabel(variation);
+      if(!jet.hasUserFloat(label))
+        throw cms::Exception("ProductNotFound")
+          << "Jet has no scale factor for variation " << variation;
+
+      return jet.userFloat(label);
+    }
+
+    math::XYZTLorentzVector jetP4(const pat::Jet& jet, const std::string& variation)
+    {
+      return jet.p4() * jetVariationScale(jet, variation);
+    }
   } // namespace helpers
 } // namespace uwvv
 